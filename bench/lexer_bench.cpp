@@ -0,0 +1,107 @@
+// Lexer throughput benchmark. Concatenates the given sources (the examples by
+// default) until the corpus reaches the target size, then reports the best of
+// several full tokenization runs in MB/s, serial and split across a thread
+// pool.
+//
+//   lexer_bench [--size-mb N] [--runs N] [--threads N] [files...]
+
+#include "../src/lexer/lexer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string read_all(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    std::exit(1);
+  }
+  return {std::istreambuf_iterator<char>(file),
+          std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t target_size = 64;
+  int runs = 5;
+  std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--size-mb" && i + 1 < argc) {
+      target_size = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--runs" && i + 1 < argc) {
+      runs = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max<std::size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+  if (paths.empty()) {
+    paths = {"examples/test.c0", "examples/semantic.c0", "examples/weird.c0",
+             "examples/zefinal.c0", "examples/util.c0"};
+  }
+  target_size *= 1024 * 1024;
+
+  std::string sample;
+  for (const auto &path : paths) {
+    sample += read_all(path);
+    sample += '\n';
+  }
+  std::string corpus;
+  corpus.reserve(target_size + sample.size());
+  while (corpus.size() < target_size) {
+    corpus += sample;
+  }
+
+  double best = 0.0;
+  std::size_t tokens = 0;
+  for (int run = 0; run < runs; ++run) {
+    Lexer lexer{1, corpus};
+    tokens = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (lexer.next_token().kind != token::TokenKind::Eof) {
+      ++tokens;
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::max(best, static_cast<double>(corpus.size()) /
+                              (1024.0 * 1024.0) / elapsed.count());
+  }
+
+  std::cout << "lexer: " << corpus.size() / (1024 * 1024) << " MB, " << tokens
+            << " tokens, best of " << runs << ": " << best << " MB/s"
+            << std::endl;
+
+  ThreadPool pool{threads};
+  double best_parallel = 0.0;
+  for (int run = 0; run < runs; ++run) {
+    Lexer lexer{1, corpus};
+    const auto start = std::chrono::steady_clock::now();
+    const auto stream = lexer.tokenize_parallel(pool);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    tokens = stream.size() - 1;
+    best_parallel = std::max(best_parallel,
+                             static_cast<double>(corpus.size()) /
+                                 (1024.0 * 1024.0) / elapsed.count());
+  }
+
+  std::cout << "lexer (" << threads << " threads): " << tokens
+            << " tokens, best of " << runs << ": " << best_parallel << " MB/s"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Parser scaling benchmark. Generates functions with N statements for a few
+// sizes up to --statements (100k by default) and reports the parse time per
+// statement. A linear parser keeps ns/statement flat as N grows.
+//
+//   parser_bench [--statements N] [--runs N]
+
+#include "../src/lexer/lexer.hpp"
+#include "../src/parser/parser.hpp"
+#include "../src/report/report_builder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+std::string generate_source(std::size_t statements) {
+  std::string source = "int main() {\n";
+  for (std::size_t i = 0; i < statements; ++i) {
+    switch (i % 4) {
+    case 0:
+      source += std::format("  int v{} = {} + 2 * v{};\n", i, i, i);
+      break;
+    case 1:
+      source += std::format("  v{} += v{} - 1;\n", i - 1, i - 1);
+      break;
+    case 2:
+      source += std::format("  if (v{} < 3) {{ v{}++; }}\n", i - 2, i - 2);
+      break;
+    default:
+      source += std::format("  v{} = f(v{}, {});\n", i - 3, i - 3, i);
+      break;
+    }
+  }
+  source += "  return 0;\n}\n";
+  return source;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t max_statements = 100000;
+  int runs = 3;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--statements" && i + 1 < argc) {
+      max_statements = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--runs" && i + 1 < argc) {
+      runs = std::max(1, std::atoi(argv[++i]));
+    }
+  }
+
+  for (std::size_t statements = max_statements / 8;
+       statements <= max_statements; statements *= 2) {
+    const auto source = generate_source(statements);
+    double best = 0.0;
+    for (int run = 0; run < runs; ++run) {
+      const auto diagnostics = std::make_shared<DiagnosticEmitter>();
+      const auto source_manager =
+          std::make_shared<SourceManager>(source, "bench");
+      Lexer lexer{source_manager->get_file_id(), source};
+
+      // Includes tokenize_all, the parser cannot start without the stream
+      const auto start = std::chrono::steady_clock::now();
+      Parser parser{lexer.tokenize_all(), diagnostics, source_manager};
+      parser.parse_translation_unit();
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+
+      if (diagnostics->has_errors()) {
+        diagnostics->print_all(*source_manager);
+        return 1;
+      }
+      const double seconds = elapsed.count();
+      best = run == 0 ? seconds : std::min(best, seconds);
+    }
+    std::cout << std::format("parser: {:>8} statements, {:>8.2f} ms, {:>7.1f} "
+                             "ns/statement",
+                             statements, best * 1e3,
+                             best * 1e9 / static_cast<double>(statements))
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include "allocation_stats.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replacements of the global operator new/delete that count the traffic.
+// The array, nothrow and sized forms of the standard library forward to
+// these. Over-aligned allocations are not counted.
+//
+// Counting is off until set_allocation_counting(true), so a normal run only
+// pays for one relaxed load per call.
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<std::size_t> allocations{0};
+std::atomic<std::size_t> deallocations{0};
+std::atomic<std::size_t> bytes{0};
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (counting.load(std::memory_order_relaxed)) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept {
+  if (p != nullptr && counting.load(std::memory_order_relaxed)) {
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+
+void arena::set_allocation_counting(bool enabled) noexcept {
+  counting.store(enabled, std::memory_order_relaxed);
+}
+
+arena::AllocationCounters arena::global_allocations() noexcept {
+  return {allocations.load(std::memory_order_relaxed),
+          deallocations.load(std::memory_order_relaxed),
+          bytes.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,65 @@
+#ifndef ALLOC_ALLOCATION_STATS_H
+#define ALLOC_ALLOCATION_STATS_H
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace arena {
+
+// Calls to the global operator new/delete, counted by the replacements in
+// allocation_stats.cpp while counting is enabled. Process wide, all threads
+// included.
+struct AllocationCounters {
+  std::size_t allocations = 0;
+  std::size_t deallocations = 0;
+  std::size_t bytes = 0; // requested through operator new
+
+  AllocationCounters operator-(const AllocationCounters &other) const {
+    return {allocations - other.allocations,
+            deallocations - other.deallocations, bytes - other.bytes};
+  }
+};
+
+// Off by default, nothing is counted until this is called with true
+void set_allocation_counting(bool enabled) noexcept;
+[[nodiscard]] AllocationCounters global_allocations() noexcept;
+
+struct PhaseAllocations {
+  std::string_view phase;
+  AllocationCounters counters;
+};
+
+// Heap traffic per compiler phase. A phase runs from enter() until the next
+// enter() or finish().
+class AllocationReport {
+private:
+  std::vector<PhaseAllocations> phases;
+  // Holds the counters at enter() while the phase runs
+  std::optional<PhaseAllocations> current;
+
+public:
+  AllocationReport() { phases.reserve(16); }
+
+  void enter(std::string_view phase) {
+    finish();
+    current = PhaseAllocations{phase, global_allocations()};
+  }
+
+  void finish() {
+    if (current) {
+      current->counters = global_allocations() - current->counters;
+      phases.push_back(*current);
+      current.reset();
+    }
+  }
+
+  [[nodiscard]] const std::vector<PhaseAllocations> &get_phases() const {
+    return phases;
+  }
+};
+
+} // namespace arena
+
+#endif // !ALLOC_ALLOCATION_STATS_H
@@ -1,81 +1,245 @@
 #ifndef ALLOC_ARENA_H
 #define ALLOC_ARENA_H
 
+#include "pool.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
-#include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <type_traits>
 #include <vector>
 
 namespace arena {
+
+class Arena;
+
+// Position in an arena, everything allocated after it is released by
+// Arena::rewind
+struct Marker {
+  std::size_t block;
+  std::size_t used;
+  std::size_t finalizers;
+};
+
+struct ArenaStats {
+  std::size_t allocations;    // since the last clear/reset
+  std::size_t bytes_used;     // handed out, including alignment padding
+  std::size_t bytes_reserved; // held in blocks
+  std::size_t peak_used;
+  std::size_t blocks;
+  std::size_t finalizers; // pending destructor calls
+  std::size_t recycled;   // allocations served from the free lists
+};
+
+// Lets std::pmr containers allocate from an arena. Deallocated small chunks
+// go back to the arena's size class pool, so node based containers (list,
+// unordered_map) reuse their nodes. Owned by the arena, see
+// Arena::resource().
+class ArenaResource final : public std::pmr::memory_resource {
+private:
+  Arena &arena;
+
+protected:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t alignment) override;
+  [[nodiscard]] bool
+  do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+public:
+  explicit ArenaResource(Arena &arena) : arena(arena) {}
+};
+
+// Bump allocator for objects that live as long as a phase. Blocks grow
+// geometrically from `block_size` up to max_block_size, allocations larger
+// than the next block get a block of their own.
+//
+// Not thread safe, share nothing between threads.
 class Arena {
 private:
+  static constexpr std::size_t max_block_size = std::size_t{1} << 20;
+
   struct Block {
     std::unique_ptr<std::uint8_t[]> data;
     std::size_t size;
     std::size_t used;
 
     explicit Block(std::size_t block_size) : size(block_size), used(0) {
-      data = std::make_unique<std::uint8_t[]>(block_size);
+      data = std::make_unique_for_overwrite<std::uint8_t[]>(block_size);
     }
   };
 
+  // Destructor of an object that is not trivially destructible
+  struct Finalizer {
+    void (*destroy)(void *);
+    void *object;
+  };
+
   std::vector<Block> blocks_;
+  std::vector<Finalizer> finalizers_;
+  SizeClassPool pool_;
+  ArenaResource resource_{*this};
   std::size_t block_size_;
+  std::size_t next_block_size_;
   std::size_t alignment_;
+  std::size_t allocations_ = 0;
+  std::size_t recycled_ = 0;
+  std::size_t used_ = 0;
+  std::size_t peak_used_ = 0;
+
+  [[nodiscard]] std::size_t grow(std::size_t size) const noexcept {
+    return std::min(size * 2, std::max(max_block_size, block_size_));
+  }
+
+  void note_allocation(std::size_t bytes) noexcept {
+    ++allocations_;
+    used_ += bytes;
+    if (used_ > peak_used_) {
+      peak_used_ = used_;
+    }
+  }
+
+  // Aligns the address, not the offset, so alignments above what operator
+  // new guarantees for the block hold as well
+  [[nodiscard]] void *bump(Block &block, std::size_t size,
+                           std::size_t alignment) noexcept {
+    const auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+    const auto aligned = (base + block.used + alignment - 1) & ~(alignment - 1);
+    const std::size_t offset = aligned - base;
+    if (offset + size > block.size) {
+      return nullptr;
+    }
+    note_allocation(offset + size - block.used);
+    block.used = offset + size;
+    return block.data.get() + offset;
+  }
+
+  // Runs the destructors registered after `count`, newest first
+  void finalize(std::size_t count) noexcept {
+    while (finalizers_.size() > count) {
+      const auto finalizer = finalizers_.back();
+      finalizers_.pop_back();
+      finalizer.destroy(finalizer.object);
+    }
+  }
 
-  [[nodiscard]] inline std::size_t align(std::size_t n) const noexcept {
-    return (n + alignment_ - 1) & ~(alignment_ - 1);
+  void reset_counters() noexcept {
+    allocations_ = 0;
+    recycled_ = 0;
+    used_ = 0;
+    next_block_size_ = grow(block_size_);
   }
 
 public:
   explicit Arena(std::size_t block_size = 16384, size_t alignment = 8)
-      : block_size_(block_size), alignment_(alignment) {
+      : block_size_(block_size), next_block_size_(grow(block_size)),
+        alignment_(alignment) {
     blocks_.emplace_back(block_size_);
   }
 
-  void *allocate(std::size_t size) {
+  void *allocate(std::size_t size) { return allocate(size, alignment_); }
+
+  // `alignment` must be a power of two
+  void *allocate(std::size_t size, std::size_t alignment) {
     if (size == 0)
       return nullptr;
 
-    // Allocate a dedicated block if the size exceedes the standard blocksize
-    // (So we dont end up in a loop of generating blocks)
-    if (size > block_size_) {
-      blocks_.emplace_back(size);
-      auto &block = blocks_.back();
-      block.used = size;
-      return block.data.get();
+    if (void *ptr = bump(blocks_.back(), size, alignment)) {
+      return ptr;
     }
 
-    auto &current_block = blocks_.back();
-    size_t align_used = align(current_block.used);
+    // Allocate a dedicated block if the size exceedes the next blocksize
+    // (So we dont end up in a loop of generating blocks)
+    const std::size_t needed = size + alignment - 1;
+    if (needed > next_block_size_) {
+      blocks_.emplace_back(needed);
+    } else {
+      blocks_.emplace_back(next_block_size_);
+      next_block_size_ = grow(next_block_size_);
+    }
+    return bump(blocks_.back(), size, alignment);
+  }
 
-    // Check if enough space in current block
-    if (align_used + size <= current_block.size) {
-      void *ptr = current_block.data.get() + align_used;
-      current_block.used = align_used + size;
-      return ptr;
+  // Like allocate, but small chunks come from and go back to the size class
+  // pool. Chunks must be returned with the size and alignment they were
+  // requested with.
+  void *allocate_pooled(std::size_t size, std::size_t alignment) {
+    const auto size_class = SizeClassPool::size_class(size, alignment);
+    if (!size_class) {
+      return allocate(size, alignment);
     }
+    if (void *chunk = pool_.pop(*size_class)) {
+      ++recycled_;
+      return chunk;
+    }
+    return allocate(SizeClassPool::chunk_size(*size_class),
+                    SizeClassPool::chunk_alignment);
+  }
 
-    // Not enough space, create new block
-    blocks_.emplace_back(block_size_);
-    auto &new_block = blocks_.back();
-    new_block.used = size;
-    return new_block.data.get();
+  // Large chunks stay allocated until the arena is cleared
+  void deallocate(void *p, std::size_t size, std::size_t alignment) noexcept {
+    if (const auto size_class = SizeClassPool::size_class(size, alignment)) {
+      pool_.push(p, *size_class);
+    }
   }
 
+  // Objects with a non-trivial destructor are destroyed by clear, reset,
+  // rewind or the arena's destructor, in reverse order of creation
   template <typename T, typename... Args>
   [[nodiscard]] T *create(Args &&...args) {
-    void *mem = allocate(sizeof(T));
+    void *mem = allocate(sizeof(T), alignof(T));
     if (!mem)
       return nullptr;
-    return new (mem) T(std::forward<Args>(args)...);
+    if constexpr (std::is_trivially_destructible_v<T>) {
+      return new (mem) T(std::forward<Args>(args)...);
+    } else {
+      // Reserve first, so a throwing push_back cant leak a live object.
+      // Doubling keeps it amortized O(1) per object.
+      if (finalizers_.size() == finalizers_.capacity()) {
+        finalizers_.reserve(
+            std::max<std::size_t>(16, 2 * finalizers_.capacity()));
+      }
+      T *object = new (mem) T(std::forward<Args>(args)...);
+      finalizers_.push_back(
+          {[](void *p) { static_cast<T *>(p)->~T(); }, object});
+      return object;
+    }
+  }
+
+  // For std::pmr containers, valid as long as the arena
+  [[nodiscard]] std::pmr::memory_resource *resource() noexcept {
+    return &resource_;
+  }
+
+  [[nodiscard]] Marker mark() const noexcept {
+    return {blocks_.size() - 1, blocks_.back().used, finalizers_.size()};
+  }
+
+  // Destroys and releases everything allocated since `marker`. Blocks added
+  // since then are dropped, the marked block is cut back to its old fill.
+  // The pooled chunks are forgotten, as some may lie in released memory.
+  void rewind(const Marker &marker) noexcept {
+    finalize(marker.finalizers);
+    pool_.clear();
+    while (blocks_.size() > marker.block + 1) {
+      used_ -= blocks_.back().used;
+      blocks_.pop_back();
+    }
+    auto &block = blocks_.back();
+    used_ -= block.used - marker.used;
+    block.used = marker.used;
   }
 
   // Reset but dont free
   void reset() noexcept {
+    finalize(0);
+    pool_.clear();
+    reset_counters();
     if (!blocks_.empty()) {
       // Take ownership
       auto first_block = std::move(blocks_.front());
@@ -87,7 +251,9 @@ public:
   }
 
   void clear() noexcept {
-    std::cout << "Freeing arena of " << used() << " bytes" << std::endl;
+    finalize(0);
+    pool_.clear();
+    reset_counters();
     blocks_.clear();
     blocks_.emplace_back(block_size_);
   }
@@ -100,21 +266,33 @@ public:
     return total;
   }
 
-  [[nodiscard]] std::size_t used() const {
-    std::size_t total = 0;
-    for (const auto &block : blocks_) {
-      total += block.used;
-    }
-    return total;
+  [[nodiscard]] std::size_t used() const noexcept { return used_; }
+
+  [[nodiscard]] ArenaStats stats() const noexcept {
+    return {allocations_,   used_,
+            size(),         peak_used_,
+            blocks_.size(), finalizers_.size(),
+            recycled_};
   }
 
-  ~Arena() { clear(); };
+  ~Arena() { finalize(0); };
 
   Arena(const Arena &) = delete;
   Arena &operator=(const Arena &) = delete;
   Arena(Arena &&) = delete;
   Arena &operator=(Arena &&) = delete;
 };
+
+inline void *ArenaResource::do_allocate(std::size_t bytes,
+                                        std::size_t alignment) {
+  return arena.allocate_pooled(bytes == 0 ? 1 : bytes, alignment);
+}
+
+inline void ArenaResource::do_deallocate(void *p, std::size_t bytes,
+                                         std::size_t alignment) {
+  arena.deallocate(p, bytes == 0 ? 1 : bytes, alignment);
+}
+
 } // namespace arena
 
-#endif // !DEBUG
+#endif // !ALLOC_ARENA_H
@@ -0,0 +1,68 @@
+#ifndef ALLOC_POOL_H
+#define ALLOC_POOL_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <optional>
+
+namespace arena {
+
+// Free lists for small chunks, one per power of two size class from 16 to
+// 256 bytes. Freed chunks are threaded through their own first word, the
+// pool never owns memory itself.
+class SizeClassPool {
+private:
+  struct FreeChunk {
+    FreeChunk *next;
+  };
+
+  static constexpr std::size_t min_class_bits = 4;
+  static constexpr std::size_t class_count = 5;
+
+  std::array<FreeChunk *, class_count> free_lists{};
+
+public:
+  static constexpr std::size_t min_chunk = std::size_t{1} << min_class_bits;
+  static constexpr std::size_t max_chunk = min_chunk << (class_count - 1);
+  // Every chunk is aligned to this, larger alignments are not pooled
+  static constexpr std::size_t chunk_alignment = alignof(std::max_align_t);
+
+  // Index of the class serving `size`, nullopt if it is not pooled
+  [[nodiscard]] static std::optional<std::size_t>
+  size_class(std::size_t size, std::size_t alignment) noexcept {
+    if (size > max_chunk || alignment > chunk_alignment) {
+      return std::nullopt;
+    }
+    const std::size_t bits = std::bit_width(
+        std::bit_ceil(size < min_chunk ? min_chunk : size) - 1);
+    return bits - min_class_bits;
+  }
+
+  [[nodiscard]] static constexpr std::size_t
+  chunk_size(std::size_t size_class) noexcept {
+    return min_chunk << size_class;
+  }
+
+  // A recycled chunk of the class or nullptr
+  [[nodiscard]] void *pop(std::size_t size_class) noexcept {
+    FreeChunk *chunk = free_lists[size_class];
+    if (chunk != nullptr) {
+      free_lists[size_class] = chunk->next;
+    }
+    return chunk;
+  }
+
+  void push(void *chunk, std::size_t size_class) noexcept {
+    auto *free_chunk = static_cast<FreeChunk *>(chunk);
+    free_chunk->next = free_lists[size_class];
+    free_lists[size_class] = free_chunk;
+  }
+
+  // Forgets all chunks, for when their memory is released
+  void clear() noexcept { free_lists.fill(nullptr); }
+};
+
+} // namespace arena
+
+#endif // !ALLOC_POOL_H
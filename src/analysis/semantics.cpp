@@ -1,30 +1,64 @@
 #include "semantics.hpp"
+#include "../defs/flat_ast.hpp"
+#include "type_check.hpp"
+
+#include <atomic>
+#include <future>
+
+std::optional<std::reference_wrapper<Symbol>>
+semantic::SemanticVisitor::resolve(ident::Ident name,
+                                   const SourceLocation &loc) {
+  const auto lookup = symbol_table.lookup(name);
+  if (lookup && lookup->get().get_kind() != Symbol::Kind::Variable &&
+      lookup->get().get_source_location().begin > loc.begin) {
+    return std::nullopt;
+  }
+  return lookup;
+}
+
+void semantic::SemanticVisitor::bind(SymbolReference &node, SymbolId symbol) {
+  node.set_symbol(symbol);
+  if (symbol_table.get_parent() != nullptr && symbol_table.is_local(symbol)) {
+    local_references.push_back(&node);
+  }
+}
+
+void semantic::SemanticVisitor::declare_globals(TranslationUnit &unit) {
+  for (const auto &declaration : unit.get_declarations()) {
+    walk(declaration);
+  }
+}
 
 void semantic::SemanticVisitor::visit(TranslationUnit &unit) {
+  declare_globals(unit);
   for (const auto &declaration : unit.get_declarations()) {
-    declaration->accept(*this);
+    if (declaration->get_kind() == Declaration::Kind::Function) {
+      check_function(static_cast<FunctionDeclaration &>(*declaration));
+    }
   }
 }
 
 void semantic::SemanticVisitor::visit(FunctionDeclaration &decl) {
   auto fs =
-      FunctionSymbol{decl.get_name(), decl.get_location(),
+      FunctionSymbol{decl.get_ident(), decl.get_location(),
                      symbol_table.next_id(), decl.get_body() ? true : false};
   symbol_table.define(fs);
+}
 
+void semantic::SemanticVisitor::check_function(FunctionDeclaration &decl) {
   // Enter scope and handle statements
-  symbol_table.enter_scope(std::format("Scope_{}", decl.get_name()));
+  symbol_table.enter_scope(decl.get_name());
 
   // Add parameter symbols
   for (const auto &param : decl.get_parameter_declarations()) {
-    auto vs = VariableSymbol{param->get_name(), param->get_location(),
+    auto vs = VariableSymbol{param->get_ident(), param->get_location(),
                              symbol_table.next_id(), true};
     symbol_table.define(vs);
   }
 
   const auto body = decl.get_body();
   if (body) {
-    body->accept(*this);
+    walk(body);
   }
 
   // Exit scope again
@@ -35,13 +69,13 @@ void semantic::SemanticVisitor::visit(CompoundStmt &stmt) {
 
   for (const auto &statement : stmt.get_statements()) {
 
-    statement->accept(*this);
+    walk(statement);
   }
 #ifdef L1
   if (!has_return_statement) {
     diagnostics->emit_error(stmt.get_location(), "Missing return statement");
     diagnostics->add_source_context(
-        source_manager->get_line(stmt.get_location().start_line()));
+        source_manager->get_snippet(stmt.get_location()));
     diagnostics->suggest_fix("This is only present in L1");
   }
 #endif
@@ -49,146 +83,138 @@ void semantic::SemanticVisitor::visit(CompoundStmt &stmt) {
 
 void semantic::SemanticVisitor::visit(AssignmentStatement &stmt) {
   if (stmt.get_lvalue()->get_kind() == LValue::Kind::Variable) {
-    const auto var_l_val = dynamic_cast<VariableLValue *>(stmt.get_lvalue());
-    auto lookup = symbol_table.lookup(var_l_val->get_name());
+    const auto var_l_val = static_cast<VariableLValue *>(stmt.get_lvalue());
+    auto lookup =
+        resolve(var_l_val->get_ident(), var_l_val->get_location());
     if (!lookup) {
       diagnostics->emit_error(
           var_l_val->get_location(),
-          std::format("Unresolved reference {}", var_l_val->get_name()));
+          "Unresolved reference {}", var_l_val->get_name());
       diagnostics->add_source_context(
-          source_manager->get_line(var_l_val->get_location().start_line()));
+          source_manager->get_snippet(var_l_val->get_location()));
     }
     else if (!lookup->get().is_initialized() &&
         stmt.get_op() != AssignmentOperator::Equals) {
-      diagnostics->emit_error(
-          var_l_val->get_location(),
-          std::format("Referencing uninitialized variable {} ",
-                      var_l_val->get_name()));
+      diagnostics->emit_error(var_l_val->get_location(),
+                              "Referencing uninitialized variable {} ",
+                              var_l_val->get_name());
       diagnostics->add_source_context(
-          source_manager->get_line(var_l_val->get_location().start_line()));
-      diagnostics->suggest_fix(
-          std::format("Try initializing {}", lookup->get().get_name()));
+          source_manager->get_snippet(var_l_val->get_location()));
+      diagnostics->suggest_fix("Try initializing {}", lookup->get().get_name());
 
       diagnostics->emit_note(
           lookup->get().get_source_location(),
-          std::format("Variable {} declared here", lookup->get().get_name()));
+          "Variable {} declared here", lookup->get().get_name());
       diagnostics->add_source_context(
           source_manager->get_snippet(lookup->get().get_source_location()));
     } else {
       lookup->get().set_initialized(true);
-      var_l_val->set_symbol(std::make_shared<Symbol>(lookup.value()));
+      bind(*var_l_val, lookup->get().get_id());
     }
   }
-  stmt.get_expr()->accept(*this);
+  walk(stmt.get_expr());
 }
 
 void semantic::SemanticVisitor::visit(VariableLValue &val) {
-  auto lookup = symbol_table.lookup(val.get_name());
+  auto lookup = resolve(val.get_ident(), val.get_location());
   if(!lookup) {
-    diagnostics->emit_error(
-        val.get_location(),
-        std::format("Unresolved reference {}", val.get_name()));
+    diagnostics->emit_error(val.get_location(), "Unresolved reference {}",
+                            val.get_name());
     diagnostics->add_source_context(
-        source_manager->get_line(val.get_location().start_line()));
+        source_manager->get_snippet(val.get_location()));
   } else {
     lookup->get().set_initialized(true);
-    val.set_symbol(std::make_shared<Symbol>(lookup.value()));
+    bind(val, lookup->get().get_id());
   }
 }
 
 void semantic::SemanticVisitor::visit(VariableDeclarationStatement &stmt) {
   bool initialized = false;
   if (stmt.get_initializer()) {
-    stmt.get_initializer()->accept(*this);
+    walk(stmt.get_initializer());
     initialized = true;
   }
-  auto vs = VariableSymbol{stmt.get_identifier(), stmt.get_location(),
+  auto vs = VariableSymbol{stmt.get_ident(), stmt.get_location(),
                            symbol_table.next_id(), initialized};
   if (!symbol_table.define(vs)) {
-    const auto previous_def = symbol_table.lookup(stmt.get_identifier());
-    diagnostics->emit_error(
-        stmt.get_location(),
-        std::format("Redefinition of variable {} ", stmt.get_identifier()));
+    const auto previous_def = symbol_table.lookup(stmt.get_ident());
+    diagnostics->emit_error(stmt.get_location(), "Redefinition of variable {} ",
+                            stmt.get_identifier());
     diagnostics->add_source_context(
-        source_manager->get_line(stmt.get_location().start_line()));
+        source_manager->get_snippet(stmt.get_location()));
     diagnostics->emit_note(previous_def->get().get_source_location(),
                            "Previously defined here:");
-    diagnostics->add_source_context(source_manager->get_line(
-        previous_def->get().get_source_location().start_line()));
+    diagnostics->add_source_context(source_manager->get_snippet(
+        previous_def->get().get_source_location()));
   } else {
-    stmt.set_symbol(std::make_shared<Symbol>(vs));
+    bind(stmt, vs.get_id());
   }
 }
 
 void semantic::SemanticVisitor::visit(VarExpr &expr) {
-  const auto lookup = symbol_table.lookup(expr.get_variable_name());
+  const auto lookup = resolve(expr.get_ident(), expr.get_location());
   if (!lookup) {
-    diagnostics->emit_error(
-        expr.get_location(),
-        std::format("Unresolved reference {}", expr.get_variable_name()));
+    diagnostics->emit_error(expr.get_location(), "Unresolved reference {}",
+                            expr.get_variable_name());
     diagnostics->add_source_context(
-        source_manager->get_line(expr.get_location().start_line()));
+        source_manager->get_snippet(expr.get_location()));
   } else if (!lookup->get().is_initialized()) {
-    diagnostics->emit_error(
-        expr.get_location(),
-        std::format("Referencing uninitialized variable {} ",
-                    expr.get_variable_name()));
+    diagnostics->emit_error(expr.get_location(),
+                            "Referencing uninitialized variable {} ",
+                            expr.get_variable_name());
     diagnostics->add_source_context(
-        source_manager->get_line(expr.get_location().start_line()));
-    diagnostics->suggest_fix(
-        std::format("Try initializing {}", lookup->get().get_name()));
+        source_manager->get_snippet(expr.get_location()));
+    diagnostics->suggest_fix("Try initializing {}", lookup->get().get_name());
 
     diagnostics->emit_note(
         lookup->get().get_source_location(),
-        std::format("Variable {} declared here", lookup->get().get_name()));
+        "Variable {} declared here", lookup->get().get_name());
     diagnostics->add_source_context(
         source_manager->get_snippet(lookup->get().get_source_location()));
   } else {
-    expr.set_symbol(std::make_shared<Symbol>(lookup.value()));
+    bind(expr, lookup->get().get_id());
   }
 }
 
 void semantic::SemanticVisitor::visit(CallExpr &expr) {
-  const auto lookup = symbol_table.lookup(expr.get_function_name());
+  const auto lookup =
+      resolve(expr.get_function_ident(), expr.get_location());
   if (!lookup) {
     diagnostics->emit_error(expr.get_location(),
-                            std::format("Unresolved method reference {}",
-                                        expr.get_function_name()));
+                            "Unresolved method reference {}",
+                            expr.get_function_name());
     diagnostics->add_source_context(
-        source_manager->get_line(expr.get_location().start_line()));
+        source_manager->get_snippet(expr.get_location()));
   } else if (!lookup->get().is_initialized()) {
     diagnostics->emit_error(
         expr.get_location(),
-        std::format("Referencing function declaration {} with no function body",
-                    expr.get_function_name()));
+        "Referencing function declaration {} with no function body",
+        expr.get_function_name());
     diagnostics->add_source_context(
-        source_manager->get_line(expr.get_location().start_line()));
-    diagnostics->suggest_fix(
-        std::format("Try giving {} a body", lookup->get().get_name()));
+        source_manager->get_snippet(expr.get_location()));
+    diagnostics->suggest_fix("Try giving {} a body", lookup->get().get_name());
 
     diagnostics->emit_note(
         lookup->get().get_source_location(),
-        std::format("Function {} declared here", lookup->get().get_name()));
+        "Function {} declared here", lookup->get().get_name());
     diagnostics->add_source_context(
         source_manager->get_snippet(lookup->get().get_source_location()));
   }
   for (const auto &param : expr.get_params()) {
-    param->accept(*this);
+    walk(param);
   }
 }
 
 void semantic::SemanticVisitor::visit(IfStatement &stmt) {
-  stmt.get_condition()->accept(*this);
+  walk(stmt.get_condition());
 
-  symbol_table.enter_scope(
-      std::format("Scope_if_{}", std::get<0>(stmt.get_location().begin)));
-  stmt.get_then_branch()->accept(*this);
+  symbol_table.enter_scope("Scope_if", stmt.get_location().begin);
+  walk(stmt.get_then_branch());
   symbol_table.exit_scope();
 
   if (stmt.get_else_branch()) {
-    symbol_table.enter_scope(
-        std::format("Scope_else_{}", std::get<0>(stmt.get_location().begin)));
-    stmt.get_else_branch()->accept(*this);
+    symbol_table.enter_scope("Scope_else", stmt.get_location().begin);
+    walk(stmt.get_else_branch());
     symbol_table.exit_scope();
   }
 }
@@ -197,70 +223,64 @@ void semantic::SemanticVisitor::visit(ReturnStmt &stmt) {
 #ifdef L1
   has_return_statement = true;
 #endif
-  stmt.get_expression()->accept(*this);
+  walk(stmt.get_expression());
 }
 
 void semantic::SemanticVisitor::visit(BinaryOperatorExpression &expr) {
-  expr.get_left_expression()->accept(*this);
-  expr.get_right_expression()->accept(*this);
+  walk(expr.get_left_expression());
+  walk(expr.get_right_expression());
 }
 
 void semantic::SemanticVisitor::visit(FieldAccessLValue &val) {}
-void semantic::SemanticVisitor::visit(Typedef &typedef_) {
-  ASTVisitor::visit(typedef_);
-}
 void semantic::SemanticVisitor::visit(StructDeclaration &decl) {
   auto ss =
-      StructSymbol{decl.get_name(), decl.get_location(), symbol_table.next_id(),
+      StructSymbol{decl.get_ident(), decl.get_location(), symbol_table.next_id(),
                    decl.get_fields() ? true : false};
   symbol_table.define(ss);
 }
 void semantic::SemanticVisitor::visit(AssertStmt &stmt) {
-  stmt.get_expression()->accept(*this);
+  walk(stmt.get_expression());
 }
 void semantic::SemanticVisitor::visit(UnaryMutationStatement &stmt) {
-  stmt.get_target()->accept(*this);
+  walk(stmt.get_target());
 }
 void semantic::SemanticVisitor::visit(ExpressionStatement &stmt) {
-  stmt.get_expression()->accept(*this);
+  walk(stmt.get_expression());
 }
 void semantic::SemanticVisitor::visit(ForStatement &stmt) {
-  symbol_table.enter_scope(
-      std::format("for_{}_head", std::get<0>(stmt.get_location().begin)));
-  stmt.get_init()->accept(*this);
-  stmt.get_condition()->accept(*this);
-  stmt.get_increment()->accept(*this);
-
-  symbol_table.enter_scope(
-      std::format("for_{}_body", std::get<0>(stmt.get_location().begin)));
-  stmt.get_body()->accept(*this);
+  symbol_table.enter_scope("for_head", stmt.get_location().begin);
+  walk(stmt.get_init());
+  walk(stmt.get_condition());
+  walk(stmt.get_increment());
+
+  symbol_table.enter_scope("for_body", stmt.get_location().begin);
+  walk(stmt.get_body());
   symbol_table.exit_scope();
   symbol_table.exit_scope();
 }
 void semantic::SemanticVisitor::visit(WhileStatement &stmt) {
-  stmt.get_condition()->accept(*this);
-  symbol_table.enter_scope(
-      std::format("while_{}", std::get<0>(stmt.get_location().begin)));
-  stmt.get_body()->accept(*this);
+  walk(stmt.get_condition());
+  symbol_table.enter_scope("while", stmt.get_location().begin);
+  walk(stmt.get_body());
   symbol_table.exit_scope();
 }
 void semantic::SemanticVisitor::visit(ErrorStatement &stmt) {
-  stmt.get_expr()->accept(*this);
+  walk(stmt.get_expr());
 }
 void semantic::SemanticVisitor::visit(ParenthesisExpression &expr) {
-  expr.get_expression()->accept(*this);
+  walk(expr.get_expression());
 }
 void semantic::SemanticVisitor::visit(UnaryOperatorExpression &expr) {
-  expr.get_expression()->accept(*this);
+  walk(expr.get_expression());
 }
 void semantic::SemanticVisitor::visit(ArrayAccessExpr &expr) {
-  expr.get_array()->accept(*this);
+  walk(expr.get_array());
 }
 void semantic::SemanticVisitor::visit(PointerAccessExpr &expr) {
-  expr.get_struct_pointer()->accept(*this);
+  walk(expr.get_struct_pointer());
 }
 void semantic::SemanticVisitor::visit(FieldAccessExpr &expr) {
-  expr.get_struct()->accept(*this);
+  walk(expr.get_struct());
   // TODO: Check for struct reference? somehow i guess
 }
 void semantic::SemanticVisitor::visit(AllocExpression &expr) {
@@ -270,28 +290,27 @@ void semantic::SemanticVisitor::visit(AllocArrayExpression &expr) {
   // TODO: Typechecking here too
 }
 void semantic::SemanticVisitor::visit(TernaryExpression &expr) {
-  expr.get_condition()->accept(*this);
-  expr.get_then()->accept(*this);
-  expr.get_else()->accept(*this);
+  walk(expr.get_condition());
+  walk(expr.get_then());
+  walk(expr.get_else());
 }
 void semantic::SemanticVisitor::visit(ArrayAccessLValue &val) {
-  val.get_base()->accept(*this);
-  val.get_index()->accept(*this);
+  walk(val.get_base());
+  walk(val.get_index());
 }
 void semantic::SemanticVisitor::visit(PointerAccessLValue &val) {
-  const auto lookup = symbol_table.lookup(val.get_field());
+  const auto lookup = resolve(val.get_field_ident(), val.get_location());
   if (!lookup) {
-    diagnostics->emit_error(
-        val.get_location(),
-        std::format("Unresolved reference {}", val.get_field()));
+    diagnostics->emit_error(val.get_location(), "Unresolved reference {}",
+                            val.get_field());
 
     diagnostics->add_source_context(
-        source_manager->get_line(val.get_location().start_line()));
+        source_manager->get_snippet(val.get_location()));
   }
-  val.get_base()->accept(*this);
+  walk(val.get_base());
 }
 void semantic::SemanticVisitor::visit(DereferenceLValue &val) {
-  val.get_operand()->accept(*this);
+  walk(val.get_operand());
 }
 
 constexpr std::uint32_t MAX_INT = 0x80000000;
@@ -301,11 +320,96 @@ void semantic::SemanticVisitor::visit(NumericExpr &expr) {
   if (!value || (expr.get_base() == NumericExpr::Base::Decimal && value > MAX_INT)) {
     diagnostics->emit_error(
         expr.get_location(),
-        std::format("Integer literal out of bounds {}", expr.get_value()));
+        "Integer literal out of bounds {}", expr.get_value());
 
     diagnostics->add_source_context(
-        source_manager->get_line(expr.get_location().start_line()));
+        source_manager->get_snippet(expr.get_location()));
 
     diagnostics->suggest_fix("The bounds are -2^31 < c < 2^31");
   }
 }
+
+namespace {
+
+// What one function body task hands back to be merged
+struct CheckedFunction {
+  std::shared_ptr<DiagnosticEmitter> diagnostics;
+  SymbolTable symbols;
+  std::vector<SymbolReference *> references;
+};
+
+} // namespace
+
+void semantic::analyze(TranslationUnit &unit,
+                       const std::shared_ptr<DiagnosticEmitter> &diagnostics,
+                       const std::shared_ptr<SourceManager> &source_manager,
+                       ThreadPool &pool) {
+  // Phase one: everything a body may refer to, read-only from here on
+  auto global_diagnostics = std::make_shared<DiagnosticEmitter>();
+  SemanticVisitor globals{global_diagnostics, source_manager};
+  globals.declare_globals(unit);
+  // Type checking walks the flat form, its declarations are in the order of
+  // the unit's
+  const auto flat_unit = flat::flatten(unit, source_manager->get_file_id());
+  type::TypeContext types{};
+  type_check::TypeVisitor global_types{global_diagnostics, source_manager,
+                                       types};
+  global_types.walk(flat_unit);
+
+  // Phase two: the bodies are independent of each other. Once the error
+  // limit is reached the remaining ones are skipped.
+  const auto max_errors = diagnostics->get_max_errors();
+  std::atomic<std::size_t> errors =
+      diagnostics->count(DiagnosticSeverity::Error) +
+      global_diagnostics->count(DiagnosticSeverity::Error);
+  std::vector<std::future<CheckedFunction>> pending{};
+  const auto &declarations = unit.get_declarations();
+  for (std::size_t i = 0; i < declarations.size(); ++i) {
+    if (declarations[i]->get_kind() != Declaration::Kind::Function) {
+      continue;
+    }
+    auto *function = static_cast<FunctionDeclaration *>(declarations[i]);
+    if (function->get_body() == nullptr) {
+      continue;
+    }
+    const auto body =
+        flat_unit.get(flat_unit.get_declarations()[i]).child(3);
+    pending.push_back(pool.submit([&, function, body] {
+      auto shard = std::make_shared<DiagnosticEmitter>();
+      SemanticVisitor names{shard, source_manager,
+                            &globals.get_symbol_table()};
+      if (max_errors != 0 && errors.load() >= max_errors) {
+        return CheckedFunction{shard, std::move(names.get_symbol_table()), {}};
+      }
+      names.check_function(*function);
+      type_check::TypeVisitor body_types{shard, source_manager, types};
+      body_types.walk(flat_unit, body);
+      errors += shard->count(DiagnosticSeverity::Error);
+
+      const auto references = names.get_local_references();
+      return CheckedFunction{
+          shard, std::move(names.get_symbol_table()),
+          std::vector<SymbolReference *>(references.begin(), references.end())};
+    }));
+  }
+  // The global table is read by every task, adopt only after all finished
+  for (const auto &function : pending) {
+    function.wait();
+  }
+
+  // Sorted before they reach `diagnostics`, which may stream them right away
+  DiagnosticEmitter merged{};
+  merged.merge(std::move(*global_diagnostics));
+  auto &symbols = globals.get_symbol_table();
+  for (auto &result : pending) {
+    auto function = result.get();
+    const auto shift = symbols.adopt(function.symbols);
+    for (auto *reference : function.references) {
+      reference->set_symbol(
+          SymbolId{reference->get_symbol().get_id() + shift});
+    }
+    merged.merge(std::move(*function.diagnostics));
+  }
+  merged.sort_by_location();
+  diagnostics->merge(std::move(merged));
+}
@@ -1,65 +1,102 @@
 #ifndef ANALYSIS_SEMANTICS_H
 #define ANALYSIS_SEMANTICS_H
 
+#include <functional>
+#include <optional>
+#include <span>
 #include <utility>
+#include <vector>
 
 #include "../defs/ast.hpp"
+#include "../defs/ast_walker.hpp"
 #include "../report/report_builder.hpp"
+#include "../util/thread_pool.hpp"
 #include "symbol.hpp"
 
 namespace semantic {
 
-class SemanticVisitor : public ASTVisitor {
+// Checks a translation unit in two phases: declare_globals() defines the
+// functions and structs, then check_function() resolves the names in one
+// function body. Walking the unit runs both in order on one table, analyze()
+// runs the bodies in parallel.
+class SemanticVisitor : public ASTWalker<SemanticVisitor> {
 private:
-  SymbolTable symbol_table{};
+  SymbolTable symbol_table;
   std::shared_ptr<DiagnosticEmitter> diagnostics;
   std::shared_ptr<SourceManager> source_manager;
+  // Nodes bound to symbols of a layered table, see SymbolTable::adopt
+  std::vector<SymbolReference *> local_references;
+
+  // Globals are all defined before any body is checked, the ones declared
+  // after `loc` are not visible there yet
+  std::optional<std::reference_wrapper<Symbol>>
+  resolve(ident::Ident name, const SourceLocation &loc);
+  void bind(SymbolReference &node, SymbolId symbol);
 
 #ifdef L1
   bool has_return_statement = false;
 #endif
 
 public:
+  // A visitor for one function body layers its table on `globals`
   explicit SemanticVisitor(std::shared_ptr<DiagnosticEmitter> diagnostics,
-                           std::shared_ptr<SourceManager> source_manager)
-      : diagnostics(std::move(diagnostics)),
+                           std::shared_ptr<SourceManager> source_manager,
+                           const SymbolTable *globals = nullptr)
+      : symbol_table(globals), diagnostics(std::move(diagnostics)),
         source_manager(std::move(source_manager)) {}
 
-  void visit(TranslationUnit &unit) override;
-  void visit(CompoundStmt &stmt) override;
-  void visit(FunctionDeclaration &decl) override;
-  void visit(AssignmentStatement &stmt) override;
-  void visit(VariableLValue &val) override;
-  void visit(VariableDeclarationStatement &stmt) override;
-  void visit(VarExpr &expr) override;
-  void visit(CallExpr &expr) override;
-  void visit(IfStatement &stmt) override;
-  void visit(ReturnStmt &stmt) override;
-  void visit(BinaryOperatorExpression &expr) override;
-  void visit(FieldAccessLValue &val) override;
-  void visit(Typedef &typedef_) override;
-  void visit(StructDeclaration &decl) override;
-  void visit(AssertStmt &stmt) override;
-  void visit(UnaryMutationStatement &stmt) override;
-  void visit(ExpressionStatement &stmt) override;
-  void visit(ForStatement &stmt) override;
-  void visit(WhileStatement &stmt) override;
-  void visit(ErrorStatement &stmt) override;
-  void visit(ParenthesisExpression &expr) override;
-  void visit(UnaryOperatorExpression &expr) override;
-  void visit(ArrayAccessExpr &expr) override;
-  void visit(PointerAccessExpr &expr) override;
-  void visit(FieldAccessExpr &expr) override;
-  void visit(AllocExpression &expr) override;
-  void visit(AllocArrayExpression &expr) override;
-  void visit(TernaryExpression &expr) override;
-  void visit(ArrayAccessLValue &val) override;
-  void visit(PointerAccessLValue &val) override;
-  void visit(DereferenceLValue &val) override;
+  void declare_globals(TranslationUnit &unit);
+  void check_function(FunctionDeclaration &decl);
+
+  [[nodiscard]] SymbolTable &get_symbol_table() { return symbol_table; }
+  [[nodiscard]] std::span<SymbolReference *const>
+  get_local_references() const {
+    return local_references;
+  }
+
+  using ASTWalker<SemanticVisitor>::visit;
+  void visit(TranslationUnit &unit);
+  void visit(CompoundStmt &stmt);
+  void visit(FunctionDeclaration &decl);
+  void visit(AssignmentStatement &stmt);
+  void visit(VariableLValue &val);
+  void visit(VariableDeclarationStatement &stmt);
+  void visit(VarExpr &expr);
+  void visit(CallExpr &expr);
+  void visit(IfStatement &stmt);
+  void visit(ReturnStmt &stmt);
+  void visit(BinaryOperatorExpression &expr);
+  void visit(FieldAccessLValue &val);
+  void visit(StructDeclaration &decl);
+  void visit(AssertStmt &stmt);
+  void visit(UnaryMutationStatement &stmt);
+  void visit(ExpressionStatement &stmt);
+  void visit(ForStatement &stmt);
+  void visit(WhileStatement &stmt);
+  void visit(ErrorStatement &stmt);
+  void visit(ParenthesisExpression &expr);
+  void visit(UnaryOperatorExpression &expr);
+  void visit(ArrayAccessExpr &expr);
+  void visit(PointerAccessExpr &expr);
+  void visit(FieldAccessExpr &expr);
+  void visit(AllocExpression &expr);
+  void visit(AllocArrayExpression &expr);
+  void visit(TernaryExpression &expr);
+  void visit(ArrayAccessLValue &val);
+  void visit(PointerAccessLValue &val);
+  void visit(DereferenceLValue &val);
 
   // Literal checking
-  void visit(NumericExpr &expr) override;
+  void visit(NumericExpr &expr);
 };
 
+// Declares the globals of `unit` serially, then checks the function bodies
+// and their types on `pool`. Every task reports to its own emitter, the
+// shards are merged into `diagnostics` in source order.
+void analyze(TranslationUnit &unit,
+             const std::shared_ptr<DiagnosticEmitter> &diagnostics,
+             const std::shared_ptr<SourceManager> &source_manager,
+             ThreadPool &pool);
+
 } // namespace semantic
 #endif // !ANALYSIS_SEMANTICS_H
@@ -1,36 +1,57 @@
 #ifndef ANALYSIS_SYMBOL_H
 #define ANALYSIS_SYMBOL_H
 
-#include "../alloc/arena.hpp"
+#include "../defs/ident.hpp"
 #include "../defs/source_location.hpp"
+#include "../report/source_manager.hpp"
 #include <format>
 #include <functional>
 #include <iostream>
 #include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <utility>
+#include <vector>
+
+// Index of a symbol in the dense array of its SymbolTable. Resolved AST
+// references store this instead of a copy of the symbol.
+class SymbolId {
+private:
+  static constexpr uint32_t invalid_id = 0xFFFFFFFF;
+
+  uint32_t id = invalid_id;
+
+public:
+  constexpr SymbolId() = default;
+  constexpr explicit SymbolId(uint32_t id) : id(id) {}
+
+  [[nodiscard]] constexpr uint32_t get_id() const { return id; }
+  [[nodiscard]] constexpr bool is_valid() const { return id != invalid_id; }
+
+  constexpr auto operator<=>(const SymbolId &) const = default;
+};
 
 class Symbol {
 public:
   enum class Kind { Variable, Function, Struct };
 
 private:
-  size_t id;
-  std::string_view name;
+  SymbolId id;
+  ident::Ident name;
   Kind kind;
   bool initialized;
 
   SourceLocation location;
 
 public:
-  explicit Symbol(std::string_view name, SourceLocation loc, Kind kind,
-                  size_t id, bool initialized)
+  explicit Symbol(ident::Ident name, SourceLocation loc, Kind kind,
+                  SymbolId id, bool initialized)
       : name(name), location(std::move(loc)), kind(kind), id(id),
         initialized(initialized) {}
 
-  [[nodiscard]] std::string_view get_name() const { return name; }
+  [[nodiscard]] ident::Ident get_ident() const { return name; }
+  [[nodiscard]] std::string_view get_name() const { return ident::name(name); }
 
   [[nodiscard]] const SourceLocation &get_source_location() const {
     return location;
@@ -38,19 +59,20 @@ public:
 
   [[nodiscard]] Kind get_kind() const { return kind; }
 
-  [[nodiscard]] size_t get_id() const { return id; }
+  [[nodiscard]] SymbolId get_id() const { return id; }
 
-  void set_id(size_t id_) { id = id_; }
+  void set_id(SymbolId id_) { id = id_; }
 
   [[nodiscard]] bool is_initialized() const { return initialized; }
 
   void set_initialized(bool init) { initialized = init; }
 
-  [[nodiscard]] std::string to_string() const {
-    return std::format("[{}{}, <{}:{}:{} - {}:{}:{}>]", name, id,
-                       location.file_name, std::get<0>(location.begin),
-                       std::get<1>(location.begin), location.file_name,
-                       std::get<0>(location.end), std::get<1>(location.end));
+  [[nodiscard]] std::string to_string(const SourceManager &sources) const {
+    const auto begin = sources.get_line_column(location.begin);
+    const auto end = sources.get_line_column(location.end);
+    return std::format("[{}{}, <{}:{}:{} - {}:{}:{}>]", get_name(), id.get_id(),
+                       sources.get_filename(), begin.line, begin.column,
+                       sources.get_filename(), end.line, end.column);
   }
 };
 
@@ -58,150 +80,252 @@ class VariableSymbol : public Symbol {
   bool initialized = false;
 
 public:
-  explicit VariableSymbol(std::string_view name, SourceLocation loc, size_t id,
+  explicit VariableSymbol(ident::Ident name, SourceLocation loc, SymbolId id,
                           bool initialized)
       : Symbol(name, loc, Kind::Variable, id, initialized) {}
 };
 
 class FunctionSymbol : public Symbol {
 public:
-  explicit FunctionSymbol(std::string_view name, SourceLocation loc, size_t id,
+  explicit FunctionSymbol(ident::Ident name, SourceLocation loc, SymbolId id,
                           bool initialized)
       : Symbol(name, loc, Kind::Function, id, initialized) {}
 };
 
 class StructSymbol : public Symbol {
 public:
-  explicit StructSymbol(std::string_view name, SourceLocation loc, size_t id,
+  explicit StructSymbol(ident::Ident name, SourceLocation loc, SymbolId id,
                         bool initialized)
       : Symbol(name, loc, Kind::Struct, id, initialized) {}
 };
 
-class Scope {
+// Every visible name lives in one open-addressed table that maps the
+// identifier to its innermost binding. Bindings form a stack: each one links
+// to the binding it shadows, and leaving a scope pops the bindings made in
+// it and restores the shadowed ones. A lookup is one probe no matter how
+// deeply scopes are nested, and nothing is allocated per scope.
+//
+// A table can be layered on a parent that is no longer modified, e.g. one
+// per worker on top of the global declarations. Names it does not bind are
+// looked up in the parent, and its own ids continue after the parent's so
+// adopt() can move its symbols over later.
+class SymbolTable {
 private:
-  struct StringHash {
-    using is_transparent = void;
-    std::size_t operator()(std::string_view str) const noexcept {
-      return std::hash<std::string_view>{}(str);
-    }
+  static constexpr uint32_t no_binding = 0xFFFFFFFF;
+  static constexpr std::size_t initial_slots = 256;
+
+  struct Slot {
+    uint32_t name; // ident::Ident id, 0 marks an empty slot
+    uint32_t binding;
   };
 
-  struct StringEqual {
-    using is_transparent = void;
-    bool operator()(std::string_view lhs, std::string_view rhs) const noexcept {
-      return lhs == rhs;
-    }
+  struct Binding {
+    ident::Ident name;
+    SymbolId symbol;
+    uint32_t depth;
+    uint32_t shadowed; // previous binding of the same name
   };
 
-  std::unordered_map<std::string, Symbol, StringHash, StringEqual> symbols;
-  Scope *parent;
-  std::string scope_name;
+  // The label is only formatted by dump(), together with the offset of the
+  // node that opened the scope if there is one
+  struct Frame {
+    std::string_view label;
+    std::optional<uint32_t> offset;
+    std::size_t first_binding;
+  };
 
-public:
-  explicit Scope(std::string name = "unnamed", Scope *parent = nullptr)
-      : parent(parent), scope_name(std::move(name)) {}
+  std::vector<Slot> slots;
+  std::size_t used_slots = 0;
+  std::vector<Binding> bindings; // doubles as the undo log
+  std::vector<Frame> frames;
+  std::vector<Symbol> symbols;
 
-  [[nodiscard]] Scope *get_parent() const { return parent; }
+  const SymbolTable *parent = nullptr;
+  uint32_t first_id = 0; // ids below belong to the parent
+  std::optional<Symbol> parent_copy;
 
-  bool define(const Symbol &symbol) {
-    if (symbols.find(symbol.get_name()) != symbols.end()) {
-      return false;
-    }
-    symbols.emplace(symbol.get_name(), symbol);
-    return true;
+  static std::size_t hash(ident::Ident name) {
+    // Ident ids are dense, Fibonacci hashing spreads neighbours apart
+    return name.get_id() * 2654435769u;
   }
 
-  [[nodiscard]] std::optional<std::reference_wrapper<Symbol>>
-  lookup_local(std::string_view name) {
-    auto it = symbols.find(name);
-    if (it != symbols.end()) {
-      return std::reference_wrapper<Symbol>(it->second);
+  // Slot of `name`, or the empty slot where it would go
+  Slot &slot_for(ident::Ident name) {
+    const std::size_t mask = slots.size() - 1;
+    std::size_t i = hash(name) & mask;
+    while (slots[i].name != 0 && slots[i].name != name.get_id()) {
+      i = (i + 1) & mask;
     }
-
-    return std::nullopt;
+    return slots[i];
   }
 
-  [[nodiscard]] std::optional<std::reference_wrapper<Symbol>>
-  lookup(const std::string_view name) {
-    auto symbol = lookup_local(name);
-
-    if (symbol) {
-      return symbol;
+  [[nodiscard]] const Slot *find(ident::Ident name) const {
+    const std::size_t mask = slots.size() - 1;
+    std::size_t i = hash(name) & mask;
+    while (slots[i].name != 0) {
+      if (slots[i].name == name.get_id()) {
+        return &slots[i];
+      }
+      i = (i + 1) & mask;
     }
+    return nullptr;
+  }
 
-    auto parent = get_parent();
-    if (parent) {
-      return parent->lookup(name);
+  void grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot{0, no_binding});
+    for (const auto &slot : old) {
+      if (slot.name != 0) {
+        slot_for(ident::Ident{slot.name}) = slot;
+      }
     }
-
-    return std::nullopt;
   }
 
-  [[nodiscard]] std::unordered_map<std::string, Symbol, StringHash, StringEqual>
-  get_scoped_symbols() const {
-    return symbols;
+  [[nodiscard]] uint32_t depth() const {
+    return static_cast<uint32_t>(frames.size() - 1);
   }
 
-  [[nodiscard]] std::string_view get_name() const { return scope_name; }
-};
-
-class SymbolTable {
-private:
-  Scope *current_scope;
-  arena::Arena arena;
-  size_t id_counter = 0;
+  [[nodiscard]] const Symbol *find_symbol(ident::Ident name) const {
+    const auto *slot = find(name);
+    if (slot != nullptr && slot->binding != no_binding) {
+      return &get(bindings[slot->binding].symbol);
+    }
+    return parent != nullptr ? parent->find_symbol(name) : nullptr;
+  }
 
 public:
-  explicit SymbolTable() : arena(arena::Arena{}) {
-    current_scope = arena.create<Scope>("top_level");
+  explicit SymbolTable(const SymbolTable *parent = nullptr)
+      : slots(initial_slots, Slot{0, no_binding}), parent(parent),
+        first_id(parent != nullptr ? parent->next_id().get_id() : 0) {
+    frames.push_back(Frame{"top_level", std::nullopt, 0});
   }
 
-  void enter_scope(const std::string &name = "anonymous") {
-    auto new_scope = arena.create<Scope>(name, current_scope);
-    current_scope = new_scope;
+  // `label` has to outlive the scope, e.g. a literal or an interned name
+  void enter_scope(std::string_view label = "anonymous",
+                   std::optional<uint32_t> offset = std::nullopt) {
+    frames.push_back(Frame{label, offset, bindings.size()});
   }
 
   bool exit_scope() {
-
-    auto parent = current_scope->get_parent();
-
-    if (parent) {
-      current_scope = parent;
-      return true;
+    if (frames.size() == 1) {
+      return false;
+    }
+    const auto first = frames.back().first_binding;
+    while (bindings.size() > first) {
+      const auto &binding = bindings.back();
+      slot_for(binding.name).binding = binding.shadowed;
+      bindings.pop_back();
     }
-    return false;
+    frames.pop_back();
+    return true;
   }
 
-  bool define(const Symbol &symbol) { return current_scope->define(symbol); }
+  // Stores the symbol under next_id(), fails if its name is taken in the
+  // current scope
+  bool define(const Symbol &symbol) {
+    auto *slot = &slot_for(symbol.get_ident());
+    if (slot->name == 0) {
+      if ((used_slots + 1) * 2 > slots.size()) {
+        grow();
+        slot = &slot_for(symbol.get_ident());
+      }
+      slot->name = symbol.get_ident().get_id();
+      ++used_slots;
+    } else if (slot->binding != no_binding &&
+               bindings[slot->binding].depth == depth()) {
+      return false;
+    }
 
-  size_t next_id() { return id_counter++; }
+    const auto id = next_id();
+    bindings.push_back(Binding{symbol.get_ident(), id, depth(), slot->binding});
+    slot->binding = static_cast<uint32_t>(bindings.size() - 1);
+    symbols.push_back(symbol);
+    symbols.back().set_id(id);
+    return true;
+  }
 
-  [[nodiscard]] std::optional<std::reference_wrapper<Symbol>>
-  lookup(std::string_view name) {
-    return current_scope->lookup(name);
+  // Id the next successfully defined symbol gets
+  [[nodiscard]] SymbolId next_id() const {
+    return SymbolId{first_id + static_cast<uint32_t>(symbols.size())};
   }
 
-  [[nodiscard]] std::string dump() const {
-    std::string content{};
-    return dump_scope(content, current_scope, 0);
+  // Symbol count including the parent's, all ids are below this
+  [[nodiscard]] std::size_t size() const { return first_id + symbols.size(); }
+
+  [[nodiscard]] const SymbolTable *get_parent() const { return parent; }
+
+  // Whether `id` was defined in this table rather than in its parent
+  [[nodiscard]] bool is_local(SymbolId id) const {
+    return id.get_id() >= first_id;
   }
 
-private:
-  static std::string dump_scope(std::string &content, Scope *scope, int level) {
-    std::string indent(level * 2, ' ');
-    content += std::format("Scope: {} \n", scope->get_name());
+  // The parent is read-only, its symbols are only reachable through the
+  // const overload
+  [[nodiscard]] Symbol &get(SymbolId id) {
+    if (!is_local(id)) {
+      throw std::runtime_error("Symbol belongs to the parent table");
+    }
+    return symbols[id.get_id() - first_id];
+  }
+  [[nodiscard]] const Symbol &get(SymbolId id) const {
+    return is_local(id) ? symbols[id.get_id() - first_id] : parent->get(id);
+  }
 
-    auto symbols = scope->get_scoped_symbols();
-    for (const auto &pair : symbols) {
-      content += std::format("{}  {} \n", indent, pair.second.to_string());
+  // The returned reference is invalidated by the next define() or lookup().
+  // Symbols found in the parent are returned as a copy, so marking them
+  // initialized does not touch the shared table.
+  [[nodiscard]] std::optional<std::reference_wrapper<Symbol>>
+  lookup(ident::Ident name) {
+    const auto *slot = find(name);
+    if (slot != nullptr && slot->binding != no_binding) {
+      return std::reference_wrapper<Symbol>(
+          get(bindings[slot->binding].symbol));
     }
+    if (parent == nullptr) {
+      return std::nullopt;
+    }
+    const auto *symbol = parent->find_symbol(name);
+    if (symbol == nullptr) {
+      return std::nullopt;
+    }
+    return std::reference_wrapper<Symbol>(parent_copy.emplace(*symbol));
+  }
 
-    auto parent = scope->get_parent();
-    if (parent) {
-      content += std::format("{} Parent:\n", indent);
-      dump_scope(content, parent, level + 1);
+  // Appends the symbols of `layer`, a table layered on this one, with their
+  // ids moved past the ones already here. Returns the distance they moved,
+  // references to them have to be shifted by the same amount.
+  uint32_t adopt(SymbolTable &layer) {
+    const uint32_t shift = next_id().get_id() - layer.first_id;
+    symbols.reserve(symbols.size() + layer.symbols.size());
+    for (auto &symbol : layer.symbols) {
+      symbol.set_id(SymbolId{symbol.get_id().get_id() + shift});
+      symbols.push_back(std::move(symbol));
     }
+    layer.symbols.clear();
+    return shift;
+  }
 
+  // Visible symbols, innermost scope first
+  [[nodiscard]] std::string dump(const SourceManager &sources) const {
+    std::string content{};
+    std::size_t end = bindings.size();
+    for (std::size_t level = 0; level < frames.size(); ++level) {
+      const auto &frame = frames[frames.size() - 1 - level];
+      std::string indent(level * 2, ' ');
+      if (frame.offset) {
+        content += std::format("Scope: {}_{} \n", frame.label, *frame.offset);
+      } else {
+        content += std::format("Scope: {} \n", frame.label);
+      }
+      for (std::size_t i = frame.first_binding; i < end; ++i) {
+        content += std::format("{}  {} \n", indent,
+                               get(bindings[i].symbol).to_string(sources));
+      }
+      if (level + 1 < frames.size()) {
+        content += std::format("{} Parent:\n", indent);
+      }
+      end = frame.first_binding;
+    }
     return content;
   }
 };
@@ -1,135 +1,71 @@
 #include "type_check.hpp"
 
-void type_check::TypeVisitor::visit(Typedef &typedef_) {
-  ASTVisitor::visit(typedef_);
-}
-void type_check::TypeVisitor::visit(Declaration &decl) {
-  ASTVisitor::visit(decl);
-}
-void type_check::TypeVisitor::visit(FunctionDeclaration &decl) {
-  ASTVisitor::visit(decl);
-}
-void type_check::TypeVisitor::visit(ParameterDeclaration &decl) {
-  ASTVisitor::visit(decl);
-}
-void type_check::TypeVisitor::visit(StructDeclaration &decl) {
-  ASTVisitor::visit(decl);
-}
-void type_check::TypeVisitor::visit(Statement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(CompoundStmt &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(ReturnStmt &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(AssertStmt &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(VariableDeclarationStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(UnaryMutationStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(AssignmentStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(ExpressionStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(IfStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(ForStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(WhileStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(ErrorStatement &stmt) {
-  ASTVisitor::visit(stmt);
-}
-void type_check::TypeVisitor::visit(Expression &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(NumericExpr &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(CallExpr &expr) { ASTVisitor::visit(expr); }
-void type_check::TypeVisitor::visit(StringLiteralExpr &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(CharLiteralExpr &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(BoolConstExpr &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(NullExpr &expr) { ASTVisitor::visit(expr); }
-void type_check::TypeVisitor::visit(VarExpr &expr) { ASTVisitor::visit(expr); }
-void type_check::TypeVisitor::visit(ParenthesisExpression &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(BinaryOperatorExpression &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(UnaryOperatorExpression &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(ArrayAccessExpr &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(PointerAccessExpr &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(FieldAccessExpr &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(AllocExpression &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(AllocArrayExpression &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(TernaryExpression &expr) {
-  ASTVisitor::visit(expr);
-}
-void type_check::TypeVisitor::visit(TypeAnnotation &type) {
-  ASTVisitor::visit(type);
-}
-void type_check::TypeVisitor::visit(BuiltinTypeAnnotation &type) {
-  ASTVisitor::visit(type);
-}
-void type_check::TypeVisitor::visit(NamedTypeAnnotation &type) {
-  ASTVisitor::visit(type);
-}
-void type_check::TypeVisitor::visit(StructTypeAnnotation &type) {
-  ASTVisitor::visit(type);
-}
-void type_check::TypeVisitor::visit(PointerTypeAnnotation &type) {
-  ASTVisitor::visit(type);
-}
-void type_check::TypeVisitor::visit(ArrayTypeAnnotation &type) {
-  ASTVisitor::visit(type);
-}
-void type_check::TypeVisitor::visit(LValue &val) { ASTVisitor::visit(val); }
-void type_check::TypeVisitor::visit(VariableLValue &val) {
-  ASTVisitor::visit(val);
-}
-void type_check::TypeVisitor::visit(ArrayAccessLValue &val) {
-  ASTVisitor::visit(val);
-}
-void type_check::TypeVisitor::visit(PointerAccessLValue &val) {
-  ASTVisitor::visit(val);
-}
-void type_check::TypeVisitor::visit(FieldAccessLValue &val) {
-  ASTVisitor::visit(val);
-}
-void type_check::TypeVisitor::visit(DereferenceLValue &val) {
-  ASTVisitor::visit(val);
-}
-void type_check::TypeVisitor::visit(TranslationUnit &unit) {
-  ASTVisitor::visit(unit);
+using flat::NodeKind;
+
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::Typedef> typedef_) {
+  const ident::Ident name{typedef_.node.name};
+  if (!types.define_typedef(
+          name, types.from_annotation(ast, typedef_.node.child(0)))) {
+    const auto location = ast.location(typedef_.node);
+    diagnostics->emit_error(location, "Redefinition of type {}",
+                            ident::name(name));
+    diagnostics->add_source_context(source_manager->get_snippet(location));
+  }
+}
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::Struct> decl) {
+  const ident::Ident name{decl.node.name};
+  if (!(decl.node.flags & flat::Node::HasFields)) {
+    types.struct_type(name);
+    return;
+  }
+  const auto fields = ast.list(decl.node, 0);
+  std::vector<type::StructType::Field> field_types{};
+  field_types.reserve(fields.size());
+  for (const auto field : fields) {
+    const auto &node = ast.get(field);
+    field_types.emplace_back(ident::Ident{node.name},
+                             types.from_annotation(ast, node.child(0)));
+  }
+  types.define_struct(name, std::move(field_types));
+}
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::Function> decl) {
+  types.from_declaration(ast, decl.ref);
+}
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::Compound> stmt) {
+  walk(ast, ast.list(stmt.node, 0));
+}
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::If> stmt) {
+  walk(ast, stmt.node.child(1));
+  walk(ast, stmt.node.child(2));
+}
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::For> stmt) {
+  walk(ast, stmt.node.child(0));
+  walk(ast, stmt.node.child(3));
+}
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::While> stmt) {
+  walk(ast, stmt.node.child(1));
+}
+void type_check::TypeVisitor::visit(const flat::FlatAST &ast,
+                                    flat::Ref<NodeKind::VarDecl> stmt) {
+  const auto *type = types.from_annotation(ast, stmt.node.child(0));
+  while (type->get_kind() == type::Type::Kind::Pointer ||
+         type->get_kind() == type::Type::Kind::Array) {
+    type = type->get_kind() == type::Type::Kind::Pointer
+               ? static_cast<const type::PointerType *>(type)->get_pointee()
+               : static_cast<const type::ArrayType *>(type)->get_element();
+  }
+  if (type->get_kind() == type::Type::Kind::Named) {
+    const auto location = ast.location(stmt.node);
+    diagnostics->emit_error(
+        location, "Unknown type {}",
+        ident::name(static_cast<const type::NamedType *>(type)->get_ident()));
+    diagnostics->add_source_context(source_manager->get_snippet(location));
+  }
 }
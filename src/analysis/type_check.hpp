@@ -2,68 +2,49 @@
 #define COMPILER_TYPE_CHECK_H
 
 #include "../defs/ast.hpp"
+#include "../defs/ast_walker.hpp"
+#include "../defs/flat_ast.hpp"
+#include "../defs/type.hpp"
 #include "../report/report_builder.hpp"
 #include "symbol.hpp"
 
 namespace type_check {
 
-class TypeVisitor : public ASTVisitor {
+// Runs on the flat form of the tree. Walking the unit registers its
+// typedefs, structs and signatures, walking a function body checks the types
+// declared in it. Several visitors may share one context.
+class TypeVisitor : public ASTWalker<TypeVisitor> {
 private:
   std::shared_ptr<DiagnosticEmitter> diagnostics;
   std::shared_ptr<SourceManager> source_manager;
+  type::TypeContext &types;
+
 public:
   explicit TypeVisitor(std::shared_ptr<DiagnosticEmitter> diagnostics,
-                           std::shared_ptr<SourceManager> source_manager)
+                       std::shared_ptr<SourceManager> source_manager,
+                       type::TypeContext &types)
       : diagnostics(std::move(diagnostics)),
-        source_manager(std::move(source_manager)) {}
+        source_manager(std::move(source_manager)), types(types) {}
+
+  [[nodiscard]] type::TypeContext &get_types() { return types; }
+
+  // Expressions and the remaining statements declare nothing
+  template <flat::NodeKind K>
+  void visit(const flat::FlatAST &ast, flat::Ref<K> node) {}
+
+  void visit(const flat::FlatAST &ast,
+             flat::Ref<flat::NodeKind::Typedef> typedef_);
+  void visit(const flat::FlatAST &ast, flat::Ref<flat::NodeKind::Struct> decl);
+  void visit(const flat::FlatAST &ast,
+             flat::Ref<flat::NodeKind::Function> decl);
 
-  void visit(Typedef &typedef_) override;
-  void visit(Declaration &decl) override;
-  void visit(FunctionDeclaration &decl) override;
-  void visit(ParameterDeclaration &decl) override;
-  void visit(StructDeclaration &decl) override;
-  void visit(Statement &stmt) override;
-  void visit(CompoundStmt &stmt) override;
-  void visit(ReturnStmt &stmt) override;
-  void visit(AssertStmt &stmt) override;
-  void visit(VariableDeclarationStatement &stmt) override;
-  void visit(UnaryMutationStatement &stmt) override;
-  void visit(AssignmentStatement &stmt) override;
-  void visit(ExpressionStatement &stmt) override;
-  void visit(IfStatement &stmt) override;
-  void visit(ForStatement &stmt) override;
-  void visit(WhileStatement &stmt) override;
-  void visit(ErrorStatement &stmt) override;
-  void visit(Expression &expr) override;
-  void visit(NumericExpr &expr) override;
-  void visit(CallExpr &expr) override;
-  void visit(StringLiteralExpr &expr) override;
-  void visit(CharLiteralExpr &expr) override;
-  void visit(BoolConstExpr &expr) override;
-  void visit(NullExpr &expr) override;
-  void visit(VarExpr &expr) override;
-  void visit(ParenthesisExpression &expr) override;
-  void visit(BinaryOperatorExpression &expr) override;
-  void visit(UnaryOperatorExpression &expr) override;
-  void visit(ArrayAccessExpr &expr) override;
-  void visit(PointerAccessExpr &expr) override;
-  void visit(FieldAccessExpr &expr) override;
-  void visit(AllocExpression &expr) override;
-  void visit(AllocArrayExpression &expr) override;
-  void visit(TernaryExpression &expr) override;
-  void visit(TypeAnnotation &type) override;
-  void visit(BuiltinTypeAnnotation &type) override;
-  void visit(NamedTypeAnnotation &type) override;
-  void visit(StructTypeAnnotation &type) override;
-  void visit(PointerTypeAnnotation &type) override;
-  void visit(ArrayTypeAnnotation &type) override;
-  void visit(LValue &val) override;
-  void visit(VariableLValue &val) override;
-  void visit(ArrayAccessLValue &val) override;
-  void visit(PointerAccessLValue &val) override;
-  void visit(FieldAccessLValue &val) override;
-  void visit(DereferenceLValue &val) override;
-  void visit(TranslationUnit &unit) override;
+  void visit(const flat::FlatAST &ast,
+             flat::Ref<flat::NodeKind::Compound> stmt);
+  void visit(const flat::FlatAST &ast, flat::Ref<flat::NodeKind::If> stmt);
+  void visit(const flat::FlatAST &ast, flat::Ref<flat::NodeKind::For> stmt);
+  void visit(const flat::FlatAST &ast, flat::Ref<flat::NodeKind::While> stmt);
+  void visit(const flat::FlatAST &ast,
+             flat::Ref<flat::NodeKind::VarDecl> stmt);
 };
 
 } // namespace type_check
@@ -1,9 +1,13 @@
 #ifndef COMPILER_REGISTER_ALLOC_H
 #define COMPILER_REGISTER_ALLOC_H
 
+#include "../alloc/arena.hpp"
 #include "../analysis/liveness.hpp"
 #include "interference_graph.hpp"
 #include "target/target.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 class RegisterAllocation {
 private:
@@ -22,6 +26,41 @@ public:
         ig(InterferenceGraph{liveness.get_liveness(), rmap, function}),
         target(target), arena(arena::Arena{}) {}
 
+  // Every use or definition of a virtual register adds 10^depth to the cost
+  // of its color, where depth is the loop nesting of the block it is in
+  std::unordered_map<size_t, double>
+  spill_costs(const std::unordered_map<size_t, size_t> &color_map) {
+    std::unordered_map<size_t, double> costs{};
+    for (const auto &[live_id, color] : color_map) {
+      costs.emplace(color, 0.0);
+    }
+    double weight = 1.0;
+    const auto add_cost = [&](const mir::MachineOperand &operand) {
+      const auto *reg = std::get_if<mir::VirtualRegister>(&operand.get_op());
+      if (!reg) {
+        return;
+      }
+      if (const auto it =
+              color_map.find(rmap.from_virtual(reg->get_numeral()));
+          it != color_map.end()) {
+        costs.at(it->second) += weight;
+      }
+    };
+    for (const auto *inst : function.get_instructions()) {
+      if (inst->get_opcode() ==
+          mir::MachineInstruction::MachineOpcode::DEF_LABEL) {
+        const auto label =
+            std::get<mir::Immediate>(inst->get_ins().front().get_op()).value;
+        weight = std::pow(10.0, static_cast<double>(function.get_loop_depth(
+                                    static_cast<size_t>(label))));
+        continue;
+      }
+      std::ranges::for_each(inst->get_ins(), add_cost);
+      std::ranges::for_each(inst->get_outs(), add_cost);
+    }
+    return costs;
+  }
+
   // graph coloring, color to register/stack slot, also change Regs directly in
   // mir::MachineFunction?
   void allocate() {
@@ -44,7 +83,21 @@ public:
       unused_regs.remove(reg);
     }
 
-    for (const auto &[live_id, color] : color_map) {
+    // hand the remaining registers to the most expensive colors first, keep
+    // one register for reloading spilled values
+    const auto costs = spill_costs(color_map);
+    std::vector<size_t> colors{};
+    for (const auto &[color, cost] : costs) {
+      if (!color_to_physical_reg.contains(color)) {
+        colors.push_back(color);
+      }
+    }
+    std::ranges::sort(colors, [&costs](size_t a, size_t b) {
+      const auto cost_a = costs.at(a);
+      const auto cost_b = costs.at(b);
+      return cost_a != cost_b ? cost_a > cost_b : a < b;
+    });
+    for (const auto color : colors) {
       if (unused_regs.size() == 1) {
         break;
       }
@@ -4,10 +4,11 @@
 class Generator {
   // TODO: Add register_alloc information
 public:
-  virtual std::string generate_program(mir::MIRProgram program) = 0;
+  virtual std::string generate_program(mir::MIRProgram &program) = 0;
   virtual std::string
   translate_instruction(mir::MachineInstruction *instruction) = 0;
-  virtual std::string translate_function(mir::MachineFunction function) = 0;
+  virtual std::string
+  translate_function(const mir::MachineFunction &function) = 0;
 };
 
 #endif // !CODE_GEN_TARGET_GENERATOR_H
@@ -15,7 +15,7 @@ std::string X86Generator::add_assembly_prolouge() {
   return out.str();
 }
 
-std::string X86Generator::generate_program(mir::MIRProgram program) {
+std::string X86Generator::generate_program(mir::MIRProgram &program) {
   std::ostringstream out{};
   out << add_assembly_prolouge();
   for (const auto &function : program.get_functions()) {
@@ -23,7 +23,8 @@ std::string X86Generator::generate_program(mir::MIRProgram program) {
   }
   return out.str();
 }
-std::string X86Generator::translate_function(mir::MachineFunction function) {
+std::string
+X86Generator::translate_function(const mir::MachineFunction &function) {
   std::ostringstream out{};
   auto frame_size = function.get_frame_size() * 4;
   out << "push rbp" << std::endl;
@@ -51,8 +51,9 @@ private:
 public:
   X86Generator() : Generator() {}
 
-  std::string generate_program(mir::MIRProgram program) override;
-  std::string translate_function(mir::MachineFunction function) override;
+  std::string generate_program(mir::MIRProgram &program) override;
+  std::string
+  translate_function(const mir::MachineFunction &function) override;
   std::string
   translate_instruction(mir::MachineInstruction *instruction) override;
 };
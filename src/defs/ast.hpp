@@ -2,6 +2,7 @@
 #define DEFS_AST_H
 
 #include "../analysis/symbol.hpp"
+#include "ident.hpp"
 #include "source_location.hpp"
 #include "token.hpp"
 #include <charconv>
@@ -60,11 +61,7 @@ enum class Builtin { Int, Bool, String, Char, Void, Unknown };
 std::string binOp2String(BinaryOperator binOp);
 std::string unOp2String(UnaryOperator unOp);
 std::string assmtOp2String(AssignmentOperator assmtOp);
-BinaryOperator binOpFromToken(token::TokenKind token);
-UnaryOperator unOpFromToken(token::TokenKind token);
 AssignmentOperator assmtOpFromToken(token::TokenKind token);
-int precedenceFromBinOp(BinaryOperator binOp);
-int precedenceFromUnOp(UnaryOperator unOp);
 int precedenceFromAssmtOp(AssignmentOperator assmtOp);
 
 std::string builtin2String(Builtin type);
@@ -79,20 +76,35 @@ public:
   virtual ~ASTNode() = default;
 
   [[nodiscard]] const SourceLocation &get_location() const { return location; }
-  void set_source_location(std::string_view file, std::tuple<int, int> begin,
-                           std::tuple<int, int> end) {
-    this->location = SourceLocation{file, begin, end};
+  void set_source_location(uint32_t file_id, uint32_t begin, uint32_t end) {
+    this->location = SourceLocation{file_id, begin, end};
   }
+};
+
+// Base of the nodes name resolution binds to a symbol: variable uses,
+// assignment targets and declarations
+class SymbolReference {
+private:
+  SymbolId resolved_symbol;
 
-  virtual void accept(class ASTVisitor &visitor) = 0;
+public:
+  void set_symbol(SymbolId sym) { resolved_symbol = sym; }
+  [[nodiscard]] SymbolId get_symbol() const { return resolved_symbol; }
 };
 
 // ==== Types ====
 class TypeAnnotation : public ASTNode {
 public:
-  explicit TypeAnnotation(SourceLocation loc = {}) : ASTNode(std::move(loc)) {}
+  enum class Kind { Builtin, Named, Struct, Pointer, Array };
+
+private:
+  Kind kind;
+
+public:
+  explicit TypeAnnotation(Kind kind, SourceLocation loc = {})
+      : ASTNode(std::move(loc)), kind(kind) {}
+  [[nodiscard]] Kind get_kind() const { return kind; }
   [[nodiscard]] virtual std::string toString() const = 0;
-  void accept(class ASTVisitor &visitor) override = 0;
 };
 
 class BuiltinTypeAnnotation : public TypeAnnotation {
@@ -101,9 +113,8 @@ private:
 
 public:
   explicit BuiltinTypeAnnotation(Builtin type, SourceLocation loc = {})
-      : TypeAnnotation(std::move(loc)), type(type) {}
+      : TypeAnnotation(Kind::Builtin, std::move(loc)), type(type) {}
   [[nodiscard]] Builtin get_type() const { return type; };
-  void accept(class ASTVisitor &visitor) override;
   [[nodiscard]] std::string toString() const override {
     return builtin2String(type);
   }
@@ -111,29 +122,29 @@ public:
 
 class NamedTypeAnnotation : public TypeAnnotation {
 private:
-  std::string_view name; // typedef name
+  ident::Ident name; // typedef name
 public:
-  explicit NamedTypeAnnotation(std::string_view name, SourceLocation loc = {})
-      : TypeAnnotation(std::move(loc)), name(name) {}
-  [[nodiscard]] std::string_view get_name() const { return name; }
+  explicit NamedTypeAnnotation(ident::Ident name, SourceLocation loc = {})
+      : TypeAnnotation(Kind::Named, std::move(loc)), name(name) {}
+  [[nodiscard]] ident::Ident get_ident() const { return name; }
+  [[nodiscard]] std::string_view get_name() const { return ident::name(name); }
   [[nodiscard]] std::string toString() const override {
-    return std::string(name);
+    return std::string(get_name());
   }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class StructTypeAnnotation : public TypeAnnotation {
 private:
-  std::string_view name;
+  ident::Ident name;
 
 public:
-  explicit StructTypeAnnotation(std::string_view name, SourceLocation loc = {})
-      : TypeAnnotation(std::move(loc)), name(name) {}
-  [[nodiscard]] std::string_view get_name() const { return name; }
+  explicit StructTypeAnnotation(ident::Ident name, SourceLocation loc = {})
+      : TypeAnnotation(Kind::Struct, std::move(loc)), name(name) {}
+  [[nodiscard]] ident::Ident get_ident() const { return name; }
+  [[nodiscard]] std::string_view get_name() const { return ident::name(name); }
   [[nodiscard]] std::string toString() const override {
-    return std::format("struct {}", name);
+    return std::format("struct {}", get_name());
   }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class PointerTypeAnnotation : public TypeAnnotation {
@@ -142,12 +153,11 @@ private:
 
 public:
   explicit PointerTypeAnnotation(TypeAnnotation *type, SourceLocation loc = {})
-      : TypeAnnotation(std::move(loc)), type(type) {}
+      : TypeAnnotation(Kind::Pointer, std::move(loc)), type(type) {}
   [[nodiscard]] TypeAnnotation *get_type() const { return type; }
   [[nodiscard]] std::string toString() const override {
     return std::format("Pointer to <{}>", type->toString());
   }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class ArrayTypeAnnotation : public TypeAnnotation {
@@ -156,12 +166,11 @@ private:
 
 public:
   explicit ArrayTypeAnnotation(TypeAnnotation *type, SourceLocation loc = {})
-      : TypeAnnotation(std::move(loc)), type(type) {}
+      : TypeAnnotation(Kind::Array, std::move(loc)), type(type) {}
   [[nodiscard]] TypeAnnotation *get_type() const { return type; }
   [[nodiscard]] std::string toString() const override {
     return std::format("Array of <{}>", type->toString());
   }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 // ==== Expressions ====
@@ -183,7 +192,8 @@ public:
     FieldAccess,
     PointerAccess,
     Alloc,
-    Alloc_array
+    Alloc_array,
+    Invalid
   };
 
 private:
@@ -195,7 +205,6 @@ public:
       : ASTNode(loc), kind(k), name(n) {}
   [[nodiscard]] Kind get_kind() const { return kind; }
   [[nodiscard]] std::string_view get_name() const { return name; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class AllocExpression : public Expression {
@@ -206,7 +215,6 @@ public:
   explicit AllocExpression(TypeAnnotation *type, SourceLocation loc = {})
       : Expression(Expression::Kind::Alloc, "AllocExpr", loc), type(type) {}
   [[nodiscard]] TypeAnnotation *get_type() const { return type; };
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class AllocArrayExpression : public Expression {
@@ -221,39 +229,42 @@ public:
         type(type), size(size) {}
   [[nodiscard]] TypeAnnotation *get_type() const { return type; };
   [[nodiscard]] Expression *get_size() const { return size; };
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class PointerAccessExpr : public Expression {
 private:
   Expression *struct_pointer;
-  std::string_view field;
+  ident::Ident field;
 
 public:
-  PointerAccessExpr(Expression *struct_pointer, std::string_view field,
+  PointerAccessExpr(Expression *struct_pointer, ident::Ident field,
                     SourceLocation loc = {})
       : Expression(Expression::Kind::PointerAccess, "PointerAccessExpr", loc),
         struct_pointer(struct_pointer), field(field) {}
   [[nodiscard]] Expression *get_struct_pointer() const {
     return struct_pointer;
   };
-  [[nodiscard]] std::string_view get_field() const { return field; };
-  void accept(class ASTVisitor &visitor) override;
+  [[nodiscard]] ident::Ident get_field_ident() const { return field; }
+  [[nodiscard]] std::string_view get_field() const {
+    return ident::name(field);
+  }
 };
 
 class FieldAccessExpr : public Expression {
 private:
   Expression *struct_;
-  std::string_view field;
+  ident::Ident field;
 
 public:
-  FieldAccessExpr(Expression *struct_, std::string_view field,
+  FieldAccessExpr(Expression *struct_, ident::Ident field,
                   SourceLocation loc = {})
       : Expression(Expression::Kind::FieldAccess, "FieldAccessExpr", loc),
         struct_(struct_), field(field) {}
   [[nodiscard]] Expression *get_struct() const { return struct_; };
-  [[nodiscard]] std::string_view get_field() const { return field; };
-  void accept(class ASTVisitor &visitor) override;
+  [[nodiscard]] ident::Ident get_field_ident() const { return field; }
+  [[nodiscard]] std::string_view get_field() const {
+    return ident::name(field);
+  }
 };
 
 class ArrayAccessExpr : public Expression {
@@ -267,7 +278,6 @@ public:
         array(array), index(index) {}
   [[nodiscard]] Expression *get_array() const { return array; };
   [[nodiscard]] Expression *get_index() const { return index; };
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class NumericExpr : public Expression {
@@ -285,7 +295,6 @@ public:
         value(value), base(base) {}
   [[nodiscard]] std::string_view get_value() const { return value; }
   [[nodiscard]] Base get_base() const { return base; }
-  void accept(class ASTVisitor &visitor) override;
 
   template <typename IntType> std::optional<IntType> try_parse() {
     int format;
@@ -323,7 +332,6 @@ public:
       : Expression(Expression::Kind::Paren, "ParenExpr", loc),
         expression(expr) {}
   [[nodiscard]] Expression *get_expression() const { return expression; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class TernaryExpression : public Expression {
@@ -340,7 +348,6 @@ public:
   [[nodiscard]] Expression *get_condition() const { return condition; }
   [[nodiscard]] Expression *get_then() const { return then; }
   [[nodiscard]] Expression *get_else() const { return else_; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class BinaryOperatorExpression : public Expression {
@@ -365,7 +372,6 @@ public:
   [[nodiscard]] Expression *get_right_expression() const {
     return rightExpression;
   }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class UnaryOperatorExpression : public Expression {
@@ -382,28 +388,20 @@ public:
     return unaryOperator;
   }
   [[nodiscard]] Expression *get_expression() const { return expression; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
-class VarExpr : public Expression {
+class VarExpr : public Expression, public SymbolReference {
 private:
-  std::string_view variable_name;
-  std::shared_ptr<Symbol> resolved_symbol;
+  ident::Ident variable_name;
 
 public:
-  explicit VarExpr(std::string_view name, SourceLocation loc = {})
+  explicit VarExpr(ident::Ident name, SourceLocation loc = {})
       : Expression(Expression::Kind::Var, "VarExpr", loc), variable_name(name) {
   }
+  [[nodiscard]] ident::Ident get_ident() const { return variable_name; }
   [[nodiscard]] std::string_view get_variable_name() const {
-    return variable_name;
+    return ident::name(variable_name);
   }
-  void set_symbol(std::shared_ptr<Symbol> sym) {
-    resolved_symbol = std::move(sym);
-  }
-  [[nodiscard]] std::shared_ptr<Symbol> get_symbol() const {
-    return resolved_symbol;
-  }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class NullExpr : public Expression {
@@ -411,7 +409,6 @@ public:
   explicit NullExpr(SourceLocation loc = {})
       : Expression(Expression::Kind::Null, "NullExpr", loc) {}
   [[nodiscard]] std::string_view get_value() const { return "NULL"; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class CharLiteralExpr : public Expression {
@@ -422,7 +419,6 @@ public:
   explicit CharLiteralExpr(std::string_view value, SourceLocation loc = {})
       : Expression(Expression::Kind::Char, "CharLiteral", loc), value(value) {}
   [[nodiscard]] std::string_view get_value() const { return value; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class BoolConstExpr : public Expression {
@@ -442,7 +438,6 @@ public:
     }
   }
   [[nodiscard]] bool get_value() const { return value; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class StringLiteralExpr : public Expression {
@@ -454,27 +449,35 @@ public:
       : Expression(Expression::Kind::String, "StringLiteral", loc),
         value(value) {}
   [[nodiscard]] std::string_view get_value() const { return value; }
-  void accept(class ASTVisitor &visitor) override;
+};
+
+// Placeholder the parser inserts where an expression failed to parse
+class InvalidExpr : public Expression {
+public:
+  explicit InvalidExpr(SourceLocation loc = {})
+      : Expression(Expression::Kind::Invalid, "InvalidExpr", loc) {}
 };
 
 class CallExpr : public Expression {
 private:
-  std::string_view function_name;
+  ident::Ident function_name;
   std::vector<Expression *> params{};
 
 public:
-  explicit CallExpr(std::string_view name, SourceLocation loc = {})
+  explicit CallExpr(ident::Ident name, SourceLocation loc = {})
       : Expression(Kind::Call, "Call", loc), function_name(name) {}
 
   [[nodiscard]] const std::vector<Expression *> &get_params() const {
     return params;
   }
 
-  [[nodiscard]] std::string_view get_function_name() const {
+  [[nodiscard]] ident::Ident get_function_ident() const {
     return function_name;
   }
+  [[nodiscard]] std::string_view get_function_name() const {
+    return ident::name(function_name);
+  }
   void add_param(Expression *param) { params.push_back(param); }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 // ==== LValues ====
@@ -494,28 +497,20 @@ private:
 public:
   explicit LValue(Kind kind, SourceLocation loc = {})
       : ASTNode(loc), kind(kind) {}
-  void accept(class ASTVisitor &visitor) override = 0;
 
   [[nodiscard]] Kind get_kind() const { return kind; }
 };
 
-class VariableLValue : public LValue {
+class VariableLValue : public LValue, public SymbolReference {
 private:
-  std::string_view name;
-  std::shared_ptr<Symbol> resolved_symbol;
+  ident::Ident name;
 
 public:
-  explicit VariableLValue(std::string_view name, SourceLocation loc = {})
+  explicit VariableLValue(ident::Ident name, SourceLocation loc = {})
       : LValue(Kind::Variable, loc), name(name) {}
 
-  [[nodiscard]] std::string_view get_name() const { return name; }
-  void set_symbol(std::shared_ptr<Symbol> sym) {
-    resolved_symbol = std::move(sym);
-  }
-  [[nodiscard]] std::shared_ptr<Symbol> get_symbol() const {
-    return resolved_symbol;
-  }
-  void accept(class ASTVisitor &visitor) override;
+  [[nodiscard]] ident::Ident get_ident() const { return name; }
+  [[nodiscard]] std::string_view get_name() const { return ident::name(name); }
 };
 
 class DereferenceLValue : public LValue {
@@ -527,37 +522,40 @@ public:
       : LValue(Kind::Dereference, loc), operand(operand) {}
 
   [[nodiscard]] LValue *get_operand() const { return operand; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class FieldAccessLValue : public LValue {
 private:
   LValue *base;
-  std::string_view field;
+  ident::Ident field;
 
 public:
-  FieldAccessLValue(LValue *base, std::string_view field,
+  FieldAccessLValue(LValue *base, ident::Ident field,
                     SourceLocation loc = {})
       : LValue(Kind::Field, loc), base(base), field(field) {}
 
   [[nodiscard]] LValue *get_base() const { return base; }
-  [[nodiscard]] std::string_view get_field() const { return field; }
-  void accept(class ASTVisitor &visitor) override;
+  [[nodiscard]] ident::Ident get_field_ident() const { return field; }
+  [[nodiscard]] std::string_view get_field() const {
+    return ident::name(field);
+  }
 };
 
 class PointerAccessLValue : public LValue {
 private:
   LValue *base;
-  std::string_view field;
+  ident::Ident field;
 
 public:
-  PointerAccessLValue(LValue *base, std::string_view field,
+  PointerAccessLValue(LValue *base, ident::Ident field,
                       SourceLocation loc = {})
       : LValue(Kind::Pointer, loc), base(base), field(field) {}
 
   [[nodiscard]] LValue *get_base() const { return base; }
-  [[nodiscard]] std::string_view get_field() const { return field; }
-  void accept(class ASTVisitor &visitor) override;
+  [[nodiscard]] ident::Ident get_field_ident() const { return field; }
+  [[nodiscard]] std::string_view get_field() const {
+    return ident::name(field);
+  }
 };
 
 class ArrayAccessLValue : public LValue {
@@ -571,14 +569,33 @@ public:
 
   [[nodiscard]] LValue *get_base() const { return base; }
   [[nodiscard]] Expression *get_index() const { return index; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 // ==== Statements ====
 class Statement : public ASTNode {
 public:
-  explicit Statement(SourceLocation loc = {}) : ASTNode(loc) {}
-  void accept(class ASTVisitor &visitor) override;
+  enum class Kind {
+    Compound,
+    Return,
+    Assert,
+    VariableDeclaration,
+    UnaryMutation,
+    Assignment,
+    Expression,
+    If,
+    For,
+    While,
+    Error,
+    Invalid
+  };
+
+private:
+  Kind kind;
+
+public:
+  explicit Statement(Kind kind, SourceLocation loc = {})
+      : ASTNode(loc), kind(kind) {}
+  [[nodiscard]] Kind get_kind() const { return kind; }
 };
 
 class ErrorStatement : public Statement {
@@ -587,10 +604,16 @@ private:
 
 public:
   explicit ErrorStatement(Expression *expr, SourceLocation loc = {})
-      : Statement(loc), expr(expr) {}
+      : Statement(Kind::Error, loc), expr(expr) {}
 
   [[nodiscard]] Expression *get_expr() const { return expr; }
-  void accept(ASTVisitor &visitor) override;
+};
+
+// Placeholder the parser inserts where a statement failed to parse
+class InvalidStatement : public Statement {
+public:
+  explicit InvalidStatement(SourceLocation loc = {})
+      : Statement(Kind::Invalid, loc) {}
 };
 
 class WhileStatement : public Statement {
@@ -600,12 +623,10 @@ private:
 
 public:
   WhileStatement(Expression *cond, Statement *body, SourceLocation loc = {})
-      : Statement(loc), condition(cond), body(body) {}
+      : Statement(Kind::While, loc), condition(cond), body(body) {}
 
   [[nodiscard]] Expression *get_condition() const { return condition; }
   [[nodiscard]] Statement *get_body() const { return body; }
-
-  void accept(ASTVisitor &visitor) override;
 };
 
 class IfStatement : public Statement {
@@ -617,14 +638,12 @@ private:
 public:
   IfStatement(Expression *cond, Statement *then_stmt,
               Statement *else_stmt = nullptr, SourceLocation loc = {})
-      : Statement(loc), condition(cond), then_branch(then_stmt),
+      : Statement(Kind::If, loc), condition(cond), then_branch(then_stmt),
         else_branch(else_stmt) {}
 
   [[nodiscard]] Expression *get_condition() const { return condition; }
   [[nodiscard]] Statement *get_then_branch() const { return then_branch; }
   [[nodiscard]] Statement *get_else_branch() const { return else_branch; }
-
-  void accept(ASTVisitor &visitor) override;
 };
 
 class ForStatement : public Statement {
@@ -637,15 +656,13 @@ private:
 public:
   ForStatement(Statement *init, Expression *cond, Statement *incr,
                Statement *body, SourceLocation loc = {})
-      : Statement(loc), init(init), condition(cond), increment(incr),
-        body(body) {}
+      : Statement(Kind::For, loc), init(init), condition(cond),
+        increment(incr), body(body) {}
 
   [[nodiscard]] Statement *get_init() const { return init; }
   [[nodiscard]] Expression *get_condition() const { return condition; }
   [[nodiscard]] Statement *get_increment() const { return increment; }
   [[nodiscard]] Statement *get_body() const { return body; }
-
-  void accept(ASTVisitor &visitor) override;
 };
 
 class AssignmentStatement : public Statement {
@@ -657,13 +674,11 @@ private:
 public:
   AssignmentStatement(LValue *lValue, AssignmentOperator op, Expression *expr,
                       SourceLocation loc = {})
-      : Statement(loc), lValue(lValue), op(op), expr(expr) {}
+      : Statement(Kind::Assignment, loc), lValue(lValue), op(op), expr(expr) {}
 
   [[nodiscard]] LValue *get_lvalue() const { return lValue; }
   [[nodiscard]] AssignmentOperator get_op() const { return op; }
   [[nodiscard]] Expression *get_expr() const { return expr; }
-
-  void accept(ASTVisitor &visitor) override;
 };
 
 class UnaryMutationStatement : public Statement {
@@ -676,12 +691,10 @@ private:
 
 public:
   UnaryMutationStatement(LValue *target, Op op, SourceLocation loc = {})
-      : Statement(loc), target(target), operation(op) {}
+      : Statement(Kind::UnaryMutation, loc), target(target), operation(op) {}
 
   [[nodiscard]] LValue *get_target() const { return target; }
   [[nodiscard]] Op get_operation() const { return operation; }
-
-  void accept(ASTVisitor &visitor) override;
 };
 
 class ExpressionStatement : public Statement {
@@ -690,36 +703,32 @@ private:
 
 public:
   explicit ExpressionStatement(Expression *expr, SourceLocation loc = {})
-      : Statement(loc), expr(expr) {}
+      : Statement(Kind::Expression, loc), expr(expr) {}
 
   [[nodiscard]] Expression *get_expression() const { return expr; }
-
-  void accept(ASTVisitor &visitor) override;
 };
 
-class VariableDeclarationStatement : public Statement {
+class VariableDeclarationStatement : public Statement,
+                                     public SymbolReference {
 private:
   TypeAnnotation *type;
-  std::string_view identifier;
+  ident::Ident identifier;
   Expression *initializer;
-  std::shared_ptr<Symbol> resolved_symbol;
 
 public:
   VariableDeclarationStatement(TypeAnnotation *type,
-                               std::string_view identifier,
+                               ident::Ident identifier,
                                Expression *init = nullptr,
                                SourceLocation loc = {})
-      : Statement(loc), type(type), identifier(identifier), initializer(init) {}
+      : Statement(Kind::VariableDeclaration, loc), type(type),
+        identifier(identifier), initializer(init) {}
 
   [[nodiscard]] TypeAnnotation *get_type() const { return type; }
-  [[nodiscard]] std::string_view get_identifier() const { return identifier; }
-  [[nodiscard]] Expression *get_initializer() const { return initializer; }
-  void set_symbol(const std::shared_ptr<Symbol> &sym) { resolved_symbol = sym; }
-  [[nodiscard]] std::shared_ptr<Symbol> get_symbol() const {
-    return resolved_symbol;
+  [[nodiscard]] ident::Ident get_ident() const { return identifier; }
+  [[nodiscard]] std::string_view get_identifier() const {
+    return ident::name(identifier);
   }
-
-  void accept(ASTVisitor &visitor) override;
+  [[nodiscard]] Expression *get_initializer() const { return initializer; }
 };
 
 class AssertStmt : public Statement {
@@ -727,11 +736,11 @@ private:
   Expression *expression{};
 
 public:
-  explicit AssertStmt(SourceLocation loc = {}) : Statement(loc) {}
+  explicit AssertStmt(SourceLocation loc = {})
+      : Statement(Kind::Assert, loc) {}
 
   void set_expression(Expression *expr) { this->expression = expr; }
   [[nodiscard]] Expression *get_expression() const { return this->expression; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class CompoundStmt : public Statement {
@@ -740,7 +749,7 @@ private:
 
 public:
   explicit CompoundStmt(std::vector<Statement *> stmts, SourceLocation loc = {})
-      : Statement(loc), statements(std::move(stmts)) {}
+      : Statement(Kind::Compound, loc), statements(std::move(stmts)) {}
   [[nodiscard]] const std::vector<Statement *> &get_statements() const {
     return statements;
   }
@@ -748,8 +757,6 @@ public:
   void add_statement(Statement *statement) {
     this->statements.push_back(statement);
   }
-
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class ReturnStmt : public Statement {
@@ -757,10 +764,10 @@ private:
   Expression *expr{};
 
 public:
-  explicit ReturnStmt(SourceLocation loc = {}) : Statement(loc) {}
+  explicit ReturnStmt(SourceLocation loc = {})
+      : Statement(Kind::Return, loc) {}
   void set_expression(Expression *expression) { this->expr = expression; }
   [[nodiscard]] Expression *get_expression() const { return expr; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 // ==== Declarations ====
@@ -771,77 +778,66 @@ public:
 
 private:
   Kind kind;
-  std::string_view name;
+  ident::Ident name;
 
 public:
-  Declaration(Kind k, std::string_view n, SourceLocation loc = {})
+  Declaration(Kind k, ident::Ident n, SourceLocation loc = {})
       : ASTNode(loc), kind(k), name(n) {}
 
   [[nodiscard]] Kind get_kind() const { return kind; }
-  [[nodiscard]] std::string_view get_name() const { return name; }
-  void accept(class ASTVisitor &visitor) override;
+  [[nodiscard]] ident::Ident get_ident() const { return name; }
+  [[nodiscard]] std::string_view get_name() const { return ident::name(name); }
 };
 
 class Typedef : public Declaration {
 private:
   TypeAnnotation *type;
-  std::string_view name;
 
 public:
-  Typedef(TypeAnnotation *type, std::string_view name, SourceLocation loc = {})
-      : Declaration(Declaration::Kind::Typedef, name, loc), type(type),
-        name(name) {}
+  Typedef(TypeAnnotation *type, ident::Ident name, SourceLocation loc = {})
+      : Declaration(Declaration::Kind::Typedef, name, loc), type(type) {}
   [[nodiscard]] TypeAnnotation *get_type() const { return type; }
-  void accept(class ASTVisitor &visitor) override;
 };
 
 class StructDeclaration : public Declaration {
 private:
-  std::string_view name;
   std::optional<std::vector<VariableDeclarationStatement *>> fields;
 
 public:
-  explicit StructDeclaration(std::string_view name, SourceLocation loc = {})
-      : Declaration(Kind::Struct, name, loc), name(name) {}
-  StructDeclaration(std::string_view name,
+  explicit StructDeclaration(ident::Ident name, SourceLocation loc = {})
+      : Declaration(Kind::Struct, name, loc) {}
+  StructDeclaration(ident::Ident name,
                     std::vector<VariableDeclarationStatement *> fields,
                     SourceLocation loc = {})
-      : Declaration(Kind::Struct, name, loc), name(name),
-        fields(std::move(fields)) {}
+      : Declaration(Kind::Struct, name, loc), fields(std::move(fields)) {}
 
   [[nodiscard]] std::optional<std::vector<VariableDeclarationStatement *>>
   get_fields() const {
     return fields;
   }
-  void accept(ASTVisitor &visitor) override;
 };
 
 class ParameterDeclaration : public Declaration {
 private:
-  std::string_view name;
   TypeAnnotation *type;
 
 public:
-  ParameterDeclaration(std::string_view name, TypeAnnotation *type,
+  ParameterDeclaration(ident::Ident name, TypeAnnotation *type,
                        SourceLocation loc = {})
-      : Declaration(Kind::Parameter, name, loc), name(name), type(type) {}
+      : Declaration(Kind::Parameter, name, loc), type(type) {}
   [[nodiscard]] TypeAnnotation *get_type() const { return type; }
-  void accept(ASTVisitor &visitor) override;
 };
 
 class FunctionDeclaration : public Declaration {
 private:
-  std::string_view name;
   TypeAnnotation *ret_type;
   std::vector<ParameterDeclaration *> parameters;
   CompoundStmt *body{};
 
 public:
-  FunctionDeclaration(std::string_view name, TypeAnnotation *ret_type,
+  FunctionDeclaration(ident::Ident name, TypeAnnotation *ret_type,
                       SourceLocation loc = {})
-      : Declaration(Kind::Function, name, loc), name(name), ret_type(ret_type) {
-  }
-  void accept(ASTVisitor &visitor) override;
+      : Declaration(Kind::Function, name, loc), ret_type(ret_type) {}
 
   void add_parameter_declaration(ParameterDeclaration *paramDecl) {
     parameters.push_back(paramDecl);
@@ -870,65 +866,6 @@ public:
   [[nodiscard]] const std::vector<Declaration *> &get_declarations() const {
     return declarations;
   }
-
-  void accept(ASTVisitor &visitor) override;
-};
-
-class ASTVisitor {
-public:
-  virtual void visit(Typedef &typedef_) {}
-
-  virtual void visit(Declaration &decl) {}
-  virtual void visit(FunctionDeclaration &decl) {}
-  virtual void visit(ParameterDeclaration &decl) {}
-  virtual void visit(StructDeclaration &decl) {}
-
-  virtual void visit(Statement &stmt) {}
-  virtual void visit(CompoundStmt &stmt) {}
-  virtual void visit(ReturnStmt &stmt) {}
-  virtual void visit(AssertStmt &stmt) {}
-  virtual void visit(VariableDeclarationStatement &stmt) {}
-  virtual void visit(UnaryMutationStatement &stmt) {}
-  virtual void visit(AssignmentStatement &stmt) {}
-  virtual void visit(ExpressionStatement &stmt) {}
-  virtual void visit(IfStatement &stmt) {}
-  virtual void visit(ForStatement &stmt) {}
-  virtual void visit(WhileStatement &stmt) {}
-  virtual void visit(ErrorStatement &stmt) {}
-
-  virtual void visit(Expression &expr) {}
-  virtual void visit(NumericExpr &expr) {}
-  virtual void visit(CallExpr &expr) {}
-  virtual void visit(StringLiteralExpr &expr) {}
-  virtual void visit(CharLiteralExpr &expr) {}
-  virtual void visit(BoolConstExpr &expr) {}
-  virtual void visit(NullExpr &expr) {}
-  virtual void visit(VarExpr &expr) {}
-  virtual void visit(ParenthesisExpression &expr) {}
-  virtual void visit(BinaryOperatorExpression &expr) {}
-  virtual void visit(UnaryOperatorExpression &expr) {}
-  virtual void visit(ArrayAccessExpr &expr) {}
-  virtual void visit(PointerAccessExpr &expr) {}
-  virtual void visit(FieldAccessExpr &expr) {}
-  virtual void visit(AllocExpression &expr) {}
-  virtual void visit(AllocArrayExpression &expr) {}
-  virtual void visit(TernaryExpression &expr) {}
-
-  virtual void visit(TypeAnnotation &type) {}
-  virtual void visit(BuiltinTypeAnnotation &type) {}
-  virtual void visit(NamedTypeAnnotation &type) {}
-  virtual void visit(StructTypeAnnotation &type) {}
-  virtual void visit(PointerTypeAnnotation &type) {}
-  virtual void visit(ArrayTypeAnnotation &type) {}
-
-  virtual void visit(LValue &val) {}
-  virtual void visit(VariableLValue &val) {}
-  virtual void visit(ArrayAccessLValue &val) {}
-  virtual void visit(PointerAccessLValue &val) {}
-  virtual void visit(FieldAccessLValue &val) {}
-  virtual void visit(DereferenceLValue &val) {}
-
-  virtual void visit(TranslationUnit &unit) {}
 };
 
 #endif // !DEFS_AST_H
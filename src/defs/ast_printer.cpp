@@ -9,9 +9,9 @@ void ClangStylePrintVisitor::visit(WhileStatement &stmt) {
 
   depth++;
   content += indent();
-  stmt.get_condition()->accept(*this);
+  walk(stmt.get_condition());
   content += indent();
-  stmt.get_body()->accept(*this);
+  walk(stmt.get_body());
   depth--;
 }
 
@@ -28,7 +28,7 @@ void ClangStylePrintVisitor::visit(VariableDeclarationStatement &stmt) {
   if (stmt.get_initializer() != nullptr) {
     depth++;
     content += indent();
-    stmt.get_initializer()->accept(*this);
+    walk(stmt.get_initializer());
     depth--;
   }
 }
@@ -44,9 +44,9 @@ void ClangStylePrintVisitor::visit(AssignmentStatement &stmt) {
 
   depth++;
   content += indent();
-  stmt.get_lvalue()->accept(*this);
+  walk(stmt.get_lvalue());
   content += indent();
-  stmt.get_expr()->accept(*this);
+  walk(stmt.get_expr());
   depth--;
 }
 
@@ -64,7 +64,7 @@ void ClangStylePrintVisitor::visit(UnaryMutationStatement &stmt) {
 
   depth++;
   content += indent();
-  stmt.get_target()->accept(*this);
+  walk(stmt.get_target());
   depth--;
 }
 
@@ -78,7 +78,7 @@ void ClangStylePrintVisitor::visit(ExpressionStatement &stmt) {
 
   depth++;
   content += indent();
-  stmt.get_expression()->accept(*this);
+  walk(stmt.get_expression());
   depth--;
 }
 
@@ -95,7 +95,7 @@ void ClangStylePrintVisitor::visit(CallExpr &expr) {
   depth++;
   for (const auto &param : expr.get_params()) {
     content += indent();
-    param->accept(*this);
+    walk(param);
   }
   depth--;
 }
@@ -148,6 +148,15 @@ void ClangStylePrintVisitor::visit(NullExpr &expr) {
       " " + formatRange(expr.get_location()) + " 'void' NULL \n";
 }
 
+void ClangStylePrintVisitor::visit(InvalidExpr &expr) {
+  content +=
+      color("InvalidExpr", GREEN) + " " +
+      color(std::format("{:#x}",
+                        reinterpret_cast<std::size_t>(std::addressof(expr))),
+            YELLOW) +
+      " " + formatRange(expr.get_location()) + "\n";
+}
+
 void ClangStylePrintVisitor::visit(ParenthesisExpression &expr) {
   content +=
       color("ParenExpr", GREEN) + " " +
@@ -158,7 +167,7 @@ void ClangStylePrintVisitor::visit(ParenthesisExpression &expr) {
 
   depth++;
   content += indent();
-  expr.get_expression()->accept(*this);
+  walk(expr.get_expression());
   depth--;
 }
 
@@ -183,7 +192,7 @@ void ClangStylePrintVisitor::visit(UnaryOperatorExpression &expr) {
 
   depth++;
   content += indent();
-  expr.get_expression()->accept(*this);
+  walk(expr.get_expression());
   depth--;
 }
 
@@ -198,9 +207,9 @@ void ClangStylePrintVisitor::visit(BinaryOperatorExpression &expr) {
 
   depth++;
   content += indent();
-  expr.get_left_expression()->accept(*this);
+  walk(expr.get_left_expression());
   content += indent();
-  expr.get_right_expression()->accept(*this);
+  walk(expr.get_right_expression());
   depth--;
 }
 
@@ -214,11 +223,11 @@ void ClangStylePrintVisitor::visit(TernaryExpression &expr) {
 
   depth++;
   content += indent();
-  expr.get_condition()->accept(*this);
+  walk(expr.get_condition());
   content += indent();
-  expr.get_then()->accept(*this);
+  walk(expr.get_then());
   content += indent();
-  expr.get_else()->accept(*this);
+  walk(expr.get_else());
   depth--;
 }
 
@@ -232,9 +241,9 @@ void ClangStylePrintVisitor::visit(ArrayAccessExpr &expr) {
 
   depth++;
   content += indent();
-  expr.get_array()->accept(*this);
+  walk(expr.get_array());
   content += indent();
-  expr.get_index()->accept(*this);
+  walk(expr.get_index());
   depth--;
 }
 
@@ -249,7 +258,7 @@ void ClangStylePrintVisitor::visit(FieldAccessExpr &expr) {
 
   depth++;
   content += indent();
-  expr.get_struct()->accept(*this);
+  walk(expr.get_struct());
   depth--;
 }
 
@@ -264,7 +273,7 @@ void ClangStylePrintVisitor::visit(PointerAccessExpr &expr) {
 
   depth++;
   content += indent();
-  expr.get_struct_pointer()->accept(*this);
+  walk(expr.get_struct_pointer());
   depth--;
 }
 
@@ -289,7 +298,7 @@ void ClangStylePrintVisitor::visit(AllocArrayExpression &expr) {
 
   depth++;
   content += indent();
-  expr.get_size()->accept(*this);
+  walk(expr.get_size());
   depth--;
 }
 
@@ -333,7 +342,7 @@ void ClangStylePrintVisitor::visit(PointerTypeAnnotation &type) {
 
   depth++;
   content += indent();
-  type.get_type()->accept(*this);
+  walk(type.get_type());
   depth--;
 }
 
@@ -347,7 +356,7 @@ void ClangStylePrintVisitor::visit(ArrayTypeAnnotation &type) {
 
   depth++;
   content += indent();
-  type.get_type()->accept(*this);
+  walk(type.get_type());
   depth--;
 }
 
@@ -370,7 +379,7 @@ void ClangStylePrintVisitor::visit(DereferenceLValue &val) {
       " " + formatRange(val.get_location()) + "\n";
   depth++;
   content += indent();
-  val.get_operand()->accept(*this);
+  walk(val.get_operand());
   depth--;
 }
 
@@ -384,7 +393,7 @@ void ClangStylePrintVisitor::visit(FieldAccessLValue &val) {
       std::string(val.get_field()) + "\n";
   depth++;
   content += indent();
-  val.get_base()->accept(*this);
+  walk(val.get_base());
   depth--;
 }
 
@@ -398,7 +407,7 @@ void ClangStylePrintVisitor::visit(PointerAccessLValue &val) {
       std::string(val.get_field()) + "\n";
   depth++;
   content += indent();
-  val.get_base()->accept(*this);
+  walk(val.get_base());
   depth--;
 }
 
@@ -411,9 +420,9 @@ void ClangStylePrintVisitor::visit(ArrayAccessLValue &val) {
       " " + formatRange(val.get_location()) + "\n";
   depth++;
   content += indent();
-  val.get_base()->accept(*this);
+  walk(val.get_base());
   content += indent();
-  val.get_index()->accept(*this);
+  walk(val.get_index());
   depth--;
 }
 
@@ -428,16 +437,16 @@ void ClangStylePrintVisitor::visit(ForStatement &stmt) {
   depth++;
   if (stmt.get_init() != nullptr) {
     content += indent();
-    stmt.get_init()->accept(*this);
+    walk(stmt.get_init());
   }
   content += indent();
-  stmt.get_condition()->accept(*this);
+  walk(stmt.get_condition());
   if (stmt.get_increment() != nullptr) {
     content += indent();
-    stmt.get_increment()->accept(*this);
+    walk(stmt.get_increment());
   }
   content += indent();
-  stmt.get_body()->accept(*this);
+  walk(stmt.get_body());
   depth--;
 }
 
@@ -462,7 +471,7 @@ void ClangStylePrintVisitor::visit(TranslationUnit &unit) {
   depth++;
   for (const auto &decl : unit.get_declarations()) {
     content += indent();
-    decl->accept(*this);
+    walk(decl);
   }
   depth--;
 }
@@ -474,7 +483,8 @@ void ClangStylePrintVisitor::visit(FunctionDeclaration &decl) {
                         reinterpret_cast<std::size_t>(std::addressof(decl))),
             YELLOW) +
       " " + formatRange(decl.get_location()) + " " +
-      color(std::format("line:{}", std::get<0>(decl.get_location().begin)),
+      color(std::format("line:{}",
+                        sources.get_line_column(decl.get_location().begin).line),
             CYAN) +
       " " + color(std::string(decl.get_name()), MAGENTA) + " " + "'" +
       decl.get_return_type()->toString() + " (";
@@ -493,13 +503,13 @@ void ClangStylePrintVisitor::visit(FunctionDeclaration &decl) {
   // Function parameters
   for (const auto &param : decl.get_parameter_declarations()) {
     content += indent();
-    param->accept(*this);
+    walk(param);
   }
 
   // Function body
   if (decl.get_body() != nullptr) {
     content += indent();
-    decl.get_body()->accept(*this);
+    walk(decl.get_body());
   }
   depth--;
 }
@@ -511,7 +521,9 @@ void ClangStylePrintVisitor::visit(ParameterDeclaration &decl) {
                         reinterpret_cast<std::size_t>(std::addressof(decl))),
             YELLOW) +
       " " + formatRange(decl.get_location()) + " " +
-      color(std::format("col:{}", std::get<1>(decl.get_location().begin)),
+      color(std::format(
+                "col:{}",
+                sources.get_line_column(decl.get_location().begin).column),
             CYAN) +
       " " + color(std::string(decl.get_name()), MAGENTA) + " " + "'" +
       decl.get_type()->toString() + "'\n";
@@ -524,14 +536,16 @@ void ClangStylePrintVisitor::visit(StructDeclaration &decl) {
                         reinterpret_cast<std::size_t>(std::addressof(decl))),
             YELLOW) +
       " " + formatRange(decl.get_location()) + " " +
-      color(std::format("col:{}", std::get<1>(decl.get_location().begin)),
+      color(std::format(
+                "col:{}",
+                sources.get_line_column(decl.get_location().begin).column),
             CYAN) +
       " " + color(std::string(decl.get_name()), MAGENTA) + "\n";
   depth++;
   if (const auto &fields = decl.get_fields()) {
     for (const auto &statement : *fields) {
       content += indent();
-      statement->accept(*this);
+      walk(statement);
     }
   }
   depth--;
@@ -548,7 +562,7 @@ void ClangStylePrintVisitor::visit(CompoundStmt &stmt) {
   depth++;
   for (const auto &statement : stmt.get_statements()) {
     content += indent();
-    statement->accept(*this);
+    walk(statement);
   }
   depth--;
 }
@@ -564,11 +578,20 @@ void ClangStylePrintVisitor::visit(ReturnStmt &stmt) {
   if (stmt.get_expression() != nullptr) {
     depth++;
     content += indent();
-    stmt.get_expression()->accept(*this);
+    walk(stmt.get_expression());
     depth--;
   }
 }
 
+void ClangStylePrintVisitor::visit(InvalidStatement &stmt) {
+  content +=
+      color("InvalidStatement", GREEN) + " " +
+      color(std::format("{:#x}",
+                        reinterpret_cast<std::size_t>(std::addressof(stmt))),
+            YELLOW) +
+      " " + formatRange(stmt.get_location()) + "\n";
+}
+
 void ClangStylePrintVisitor::visit(ErrorStatement &stmt) {
   content +=
       color("ErrorStatement", GREEN) + " " +
@@ -579,7 +602,7 @@ void ClangStylePrintVisitor::visit(ErrorStatement &stmt) {
 
   depth++;
   content += indent();
-  stmt.get_expr()->accept(*this);
+  walk(stmt.get_expr());
   depth--;
 }
 
@@ -594,7 +617,7 @@ void ClangStylePrintVisitor::visit(AssertStmt &stmt) {
   if (stmt.get_expression() != nullptr) {
     depth++;
     content += indent();
-    stmt.get_expression()->accept(*this);
+    walk(stmt.get_expression());
     depth--;
   }
 }
@@ -609,12 +632,12 @@ void ClangStylePrintVisitor::visit(IfStatement &stmt) {
 
   depth++;
   content += indent();
-  stmt.get_condition()->accept(*this);
+  walk(stmt.get_condition());
   content += indent();
-  stmt.get_then_branch()->accept(*this);
+  walk(stmt.get_then_branch());
   if (stmt.get_else_branch() != nullptr) {
     content += indent();
-    stmt.get_else_branch()->accept(*this);
+    walk(stmt.get_else_branch());
   }
   depth--;
 }
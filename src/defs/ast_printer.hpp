@@ -1,10 +1,14 @@
 
 #ifndef DEFS_AST_PRINTER_H
 #define DEFS_AST_PRINTER_H
+#include "../report/source_manager.hpp"
 #include "ast.hpp"
+#include "ast_walker.hpp"
 
-class ClangStylePrintVisitor : public ASTVisitor {
+class ClangStylePrintVisitor : public ASTWalker<ClangStylePrintVisitor> {
 private:
+  // Locations are stored as byte offsets, the printer resolves them
+  const SourceManager &sources;
   std::string content;
   int depth = 0;
   bool use_colors = true;
@@ -36,69 +40,75 @@ private:
     return result;
   }
 
-  static std::string formatLocation(const SourceLocation &loc) {
-    if (loc.file_name.empty()) {
+  [[nodiscard]] std::string formatLocation(const SourceLocation &loc) const {
+    if (!loc.is_valid()) {
       return "<invalid sloc>";
     }
-    return std::format("<{}>", loc.file_name);
+    return std::format("<{}>", sources.get_filename());
   }
 
-  static std::string formatRange(const SourceLocation &loc) {
-    if (loc.file_name.empty()) {
+  [[nodiscard]] std::string formatRange(const SourceLocation &loc) const {
+    if (!loc.is_valid()) {
       return "<invalid sloc>";
     }
-    return std::format("<{}:{}:{} - {}:{}:{}>", loc.file_name,
-                       std::get<0>(loc.begin), std::get<1>(loc.begin),
-                       loc.file_name, std::get<0>(loc.end),
-                       std::get<1>(loc.end));
+    const auto begin = sources.get_line_column(loc.begin);
+    const auto end = sources.get_line_column(loc.end);
+    return std::format("<{}:{}:{} - {}:{}:{}>", sources.get_filename(),
+                       begin.line, begin.column, sources.get_filename(),
+                       end.line, end.column);
   }
 
 public:
-  explicit ClangStylePrintVisitor(bool colored = true) : use_colors(colored) {}
+  explicit ClangStylePrintVisitor(const SourceManager &sources,
+                                  bool colored = true)
+      : sources(sources), use_colors(colored) {}
 
   [[nodiscard]] std::string_view get_content() const { return content; }
 
-  void visit(Typedef &typedef_) override;
-  void visit(TranslationUnit &unit) override;
-  void visit(FunctionDeclaration &decl) override;
-  void visit(ParameterDeclaration &decl) override;
-  void visit(StructDeclaration &decl) override;
-  void visit(CompoundStmt &stmt) override;
-  void visit(ReturnStmt &stmt) override;
-  void visit(ErrorStatement &stmt) override;
-  void visit(AssertStmt &stmt) override;
-  void visit(IfStatement &stmt) override;
-  void visit(ForStatement &stmt) override;
-  void visit(WhileStatement &stmt) override;
-  void visit(VariableDeclarationStatement &stmt) override;
-  void visit(AssignmentStatement &stmt) override;
-  void visit(UnaryMutationStatement &stmt) override;
-  void visit(ExpressionStatement &stmt) override;
-  void visit(CallExpr &expr) override;
-  void visit(NumericExpr &expr) override;
-  void visit(StringLiteralExpr &expr) override;
-  void visit(CharLiteralExpr &expr) override;
-  void visit(BoolConstExpr &expr) override;
-  void visit(NullExpr &expr) override;
-  void visit(ParenthesisExpression &expr) override;
-  void visit(VarExpr &expr) override;
-  void visit(UnaryOperatorExpression &expr) override;
-  void visit(BinaryOperatorExpression &expr) override;
-  void visit(TernaryExpression &expr) override;
-  void visit(ArrayAccessExpr &expr) override;
-  void visit(FieldAccessExpr &expr) override;
-  void visit(PointerAccessExpr &expr) override;
-  void visit(AllocExpression &expr) override;
-  void visit(AllocArrayExpression &expr) override;
-  void visit(BuiltinTypeAnnotation &type) override;
-  void visit(NamedTypeAnnotation &type) override;
-  void visit(StructTypeAnnotation &type) override;
-  void visit(PointerTypeAnnotation &type) override;
-  void visit(ArrayTypeAnnotation &type) override;
-  void visit(VariableLValue &val) override;
-  void visit(DereferenceLValue &val) override;
-  void visit(FieldAccessLValue &val) override;
-  void visit(PointerAccessLValue &val) override;
-  void visit(ArrayAccessLValue &val) override;
+  using ASTWalker<ClangStylePrintVisitor>::visit;
+  void visit(Typedef &typedef_);
+  void visit(TranslationUnit &unit);
+  void visit(FunctionDeclaration &decl);
+  void visit(ParameterDeclaration &decl);
+  void visit(StructDeclaration &decl);
+  void visit(CompoundStmt &stmt);
+  void visit(ReturnStmt &stmt);
+  void visit(ErrorStatement &stmt);
+  void visit(InvalidStatement &stmt);
+  void visit(AssertStmt &stmt);
+  void visit(IfStatement &stmt);
+  void visit(ForStatement &stmt);
+  void visit(WhileStatement &stmt);
+  void visit(VariableDeclarationStatement &stmt);
+  void visit(AssignmentStatement &stmt);
+  void visit(UnaryMutationStatement &stmt);
+  void visit(ExpressionStatement &stmt);
+  void visit(CallExpr &expr);
+  void visit(NumericExpr &expr);
+  void visit(StringLiteralExpr &expr);
+  void visit(CharLiteralExpr &expr);
+  void visit(BoolConstExpr &expr);
+  void visit(NullExpr &expr);
+  void visit(InvalidExpr &expr);
+  void visit(ParenthesisExpression &expr);
+  void visit(VarExpr &expr);
+  void visit(UnaryOperatorExpression &expr);
+  void visit(BinaryOperatorExpression &expr);
+  void visit(TernaryExpression &expr);
+  void visit(ArrayAccessExpr &expr);
+  void visit(FieldAccessExpr &expr);
+  void visit(PointerAccessExpr &expr);
+  void visit(AllocExpression &expr);
+  void visit(AllocArrayExpression &expr);
+  void visit(BuiltinTypeAnnotation &type);
+  void visit(NamedTypeAnnotation &type);
+  void visit(StructTypeAnnotation &type);
+  void visit(PointerTypeAnnotation &type);
+  void visit(ArrayTypeAnnotation &type);
+  void visit(VariableLValue &val);
+  void visit(DereferenceLValue &val);
+  void visit(FieldAccessLValue &val);
+  void visit(PointerAccessLValue &val);
+  void visit(ArrayAccessLValue &val);
 };
 #endif // !DEFS_AST_PRINTER_H
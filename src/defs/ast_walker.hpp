@@ -0,0 +1,332 @@
+#ifndef DEFS_AST_WALKER_H
+#define DEFS_AST_WALKER_H
+
+#include "ast.hpp"
+#include "flat_ast.hpp"
+#include <span>
+
+// Base of every AST pass. walk() switches on the kind tag of a node and calls
+// Derived::visit with the concrete type, so there is no virtual call per node
+// and the handlers can be inlined into the switch.
+//
+// Handlers a pass leaves out fall back to the empty ones below. A pass that
+// defines some of them has to pull the rest in with
+// `using ASTWalker<Derived>::visit;`, or name lookup stops at its own
+// overloads. Null children (else branches, empty for headers, ...) are
+// skipped.
+//
+// The walk over a flat::FlatAST works the same way on handles and calls
+// Derived::visit(ast, flat::Ref<Kind>). There the handlers a pass leaves out
+// walk the children in slot order, so a pass only handles the kinds it is
+// interested in.
+template <typename Derived> class ASTWalker {
+private:
+  Derived &self() { return static_cast<Derived &>(*this); }
+
+  template <flat::NodeKind K>
+  void dispatch(const flat::FlatAST &ast, flat::NodeRef ref) {
+    self().visit(ast, flat::Ref<K>{ref, ast.get(ref)});
+  }
+
+public:
+  void walk(TranslationUnit &unit) { self().visit(unit); }
+
+  void walk(Declaration *decl) {
+    if (decl == nullptr) {
+      return;
+    }
+    switch (decl->get_kind()) {
+    case Declaration::Kind::Function:
+      return self().visit(static_cast<FunctionDeclaration &>(*decl));
+    case Declaration::Kind::Parameter:
+      return self().visit(static_cast<ParameterDeclaration &>(*decl));
+    case Declaration::Kind::Struct:
+      return self().visit(static_cast<StructDeclaration &>(*decl));
+    case Declaration::Kind::Typedef:
+      return self().visit(static_cast<Typedef &>(*decl));
+    }
+  }
+
+  void walk(Statement *stmt) {
+    if (stmt == nullptr) {
+      return;
+    }
+    switch (stmt->get_kind()) {
+    case Statement::Kind::Compound:
+      return self().visit(static_cast<CompoundStmt &>(*stmt));
+    case Statement::Kind::Return:
+      return self().visit(static_cast<ReturnStmt &>(*stmt));
+    case Statement::Kind::Assert:
+      return self().visit(static_cast<AssertStmt &>(*stmt));
+    case Statement::Kind::VariableDeclaration:
+      return self().visit(static_cast<VariableDeclarationStatement &>(*stmt));
+    case Statement::Kind::UnaryMutation:
+      return self().visit(static_cast<UnaryMutationStatement &>(*stmt));
+    case Statement::Kind::Assignment:
+      return self().visit(static_cast<AssignmentStatement &>(*stmt));
+    case Statement::Kind::Expression:
+      return self().visit(static_cast<ExpressionStatement &>(*stmt));
+    case Statement::Kind::If:
+      return self().visit(static_cast<IfStatement &>(*stmt));
+    case Statement::Kind::For:
+      return self().visit(static_cast<ForStatement &>(*stmt));
+    case Statement::Kind::While:
+      return self().visit(static_cast<WhileStatement &>(*stmt));
+    case Statement::Kind::Error:
+      return self().visit(static_cast<ErrorStatement &>(*stmt));
+    case Statement::Kind::Invalid:
+      return self().visit(static_cast<InvalidStatement &>(*stmt));
+    }
+  }
+
+  void walk(Expression *expr) {
+    if (expr == nullptr) {
+      return;
+    }
+    switch (expr->get_kind()) {
+    case Expression::Kind::Numeric:
+      return self().visit(static_cast<NumericExpr &>(*expr));
+    case Expression::Kind::String:
+      return self().visit(static_cast<StringLiteralExpr &>(*expr));
+    case Expression::Kind::Call:
+      return self().visit(static_cast<CallExpr &>(*expr));
+    case Expression::Kind::Char:
+      return self().visit(static_cast<CharLiteralExpr &>(*expr));
+    case Expression::Kind::BoolConst:
+      return self().visit(static_cast<BoolConstExpr &>(*expr));
+    case Expression::Kind::Null:
+      return self().visit(static_cast<NullExpr &>(*expr));
+    case Expression::Kind::Var:
+      return self().visit(static_cast<VarExpr &>(*expr));
+    case Expression::Kind::Ternary:
+      return self().visit(static_cast<TernaryExpression &>(*expr));
+    case Expression::Kind::BinOp:
+      return self().visit(static_cast<BinaryOperatorExpression &>(*expr));
+    case Expression::Kind::UnOp:
+      return self().visit(static_cast<UnaryOperatorExpression &>(*expr));
+    case Expression::Kind::Paren:
+      return self().visit(static_cast<ParenthesisExpression &>(*expr));
+    case Expression::Kind::ArrayAccess:
+      return self().visit(static_cast<ArrayAccessExpr &>(*expr));
+    case Expression::Kind::FieldAccess:
+      return self().visit(static_cast<FieldAccessExpr &>(*expr));
+    case Expression::Kind::PointerAccess:
+      return self().visit(static_cast<PointerAccessExpr &>(*expr));
+    case Expression::Kind::Alloc:
+      return self().visit(static_cast<AllocExpression &>(*expr));
+    case Expression::Kind::Alloc_array:
+      return self().visit(static_cast<AllocArrayExpression &>(*expr));
+    case Expression::Kind::Invalid:
+      return self().visit(static_cast<InvalidExpr &>(*expr));
+    }
+  }
+
+  void walk(LValue *val) {
+    if (val == nullptr) {
+      return;
+    }
+    switch (val->get_kind()) {
+    case LValue::Kind::Variable:
+      return self().visit(static_cast<VariableLValue &>(*val));
+    case LValue::Kind::Pointer:
+      return self().visit(static_cast<PointerAccessLValue &>(*val));
+    case LValue::Kind::Field:
+      return self().visit(static_cast<FieldAccessLValue &>(*val));
+    case LValue::Kind::Array:
+      return self().visit(static_cast<ArrayAccessLValue &>(*val));
+    case LValue::Kind::Dereference:
+      return self().visit(static_cast<DereferenceLValue &>(*val));
+    }
+  }
+
+  void walk(TypeAnnotation *type) {
+    if (type == nullptr) {
+      return;
+    }
+    switch (type->get_kind()) {
+    case TypeAnnotation::Kind::Builtin:
+      return self().visit(static_cast<BuiltinTypeAnnotation &>(*type));
+    case TypeAnnotation::Kind::Named:
+      return self().visit(static_cast<NamedTypeAnnotation &>(*type));
+    case TypeAnnotation::Kind::Struct:
+      return self().visit(static_cast<StructTypeAnnotation &>(*type));
+    case TypeAnnotation::Kind::Pointer:
+      return self().visit(static_cast<PointerTypeAnnotation &>(*type));
+    case TypeAnnotation::Kind::Array:
+      return self().visit(static_cast<ArrayTypeAnnotation &>(*type));
+    }
+  }
+
+  void visit(TranslationUnit &unit) {}
+
+  void visit(FunctionDeclaration &decl) {}
+  void visit(ParameterDeclaration &decl) {}
+  void visit(StructDeclaration &decl) {}
+  void visit(Typedef &typedef_) {}
+
+  void visit(CompoundStmt &stmt) {}
+  void visit(ReturnStmt &stmt) {}
+  void visit(AssertStmt &stmt) {}
+  void visit(VariableDeclarationStatement &stmt) {}
+  void visit(UnaryMutationStatement &stmt) {}
+  void visit(AssignmentStatement &stmt) {}
+  void visit(ExpressionStatement &stmt) {}
+  void visit(IfStatement &stmt) {}
+  void visit(ForStatement &stmt) {}
+  void visit(WhileStatement &stmt) {}
+  void visit(ErrorStatement &stmt) {}
+  void visit(InvalidStatement &stmt) {}
+
+  void visit(NumericExpr &expr) {}
+  void visit(CallExpr &expr) {}
+  void visit(StringLiteralExpr &expr) {}
+  void visit(CharLiteralExpr &expr) {}
+  void visit(BoolConstExpr &expr) {}
+  void visit(NullExpr &expr) {}
+  void visit(VarExpr &expr) {}
+  void visit(ParenthesisExpression &expr) {}
+  void visit(BinaryOperatorExpression &expr) {}
+  void visit(UnaryOperatorExpression &expr) {}
+  void visit(ArrayAccessExpr &expr) {}
+  void visit(PointerAccessExpr &expr) {}
+  void visit(FieldAccessExpr &expr) {}
+  void visit(AllocExpression &expr) {}
+  void visit(AllocArrayExpression &expr) {}
+  void visit(TernaryExpression &expr) {}
+  void visit(InvalidExpr &expr) {}
+
+  void visit(BuiltinTypeAnnotation &type) {}
+  void visit(NamedTypeAnnotation &type) {}
+  void visit(StructTypeAnnotation &type) {}
+  void visit(PointerTypeAnnotation &type) {}
+  void visit(ArrayTypeAnnotation &type) {}
+
+  void visit(VariableLValue &val) {}
+  void visit(ArrayAccessLValue &val) {}
+  void visit(PointerAccessLValue &val) {}
+  void visit(FieldAccessLValue &val) {}
+  void visit(DereferenceLValue &val) {}
+
+  // ==== Flat form ====
+  void walk(const flat::FlatAST &ast) { walk(ast, ast.get_declarations()); }
+
+  void walk(const flat::FlatAST &ast, std::span<const flat::NodeRef> refs) {
+    for (const auto ref : refs) {
+      walk(ast, ref);
+    }
+  }
+
+  void walk(const flat::FlatAST &ast, flat::NodeRef ref) {
+    if (ref.is_null()) {
+      return;
+    }
+    using flat::NodeKind;
+    switch (ref.kind()) {
+    case NodeKind::Numeric:
+      return dispatch<NodeKind::Numeric>(ast, ref);
+    case NodeKind::String:
+      return dispatch<NodeKind::String>(ast, ref);
+    case NodeKind::Char:
+      return dispatch<NodeKind::Char>(ast, ref);
+    case NodeKind::BoolConst:
+      return dispatch<NodeKind::BoolConst>(ast, ref);
+    case NodeKind::Null:
+      return dispatch<NodeKind::Null>(ast, ref);
+    case NodeKind::Var:
+      return dispatch<NodeKind::Var>(ast, ref);
+    case NodeKind::Call:
+      return dispatch<NodeKind::Call>(ast, ref);
+    case NodeKind::Ternary:
+      return dispatch<NodeKind::Ternary>(ast, ref);
+    case NodeKind::BinOp:
+      return dispatch<NodeKind::BinOp>(ast, ref);
+    case NodeKind::UnOp:
+      return dispatch<NodeKind::UnOp>(ast, ref);
+    case NodeKind::Paren:
+      return dispatch<NodeKind::Paren>(ast, ref);
+    case NodeKind::ArrayAccess:
+      return dispatch<NodeKind::ArrayAccess>(ast, ref);
+    case NodeKind::FieldAccess:
+      return dispatch<NodeKind::FieldAccess>(ast, ref);
+    case NodeKind::PointerAccess:
+      return dispatch<NodeKind::PointerAccess>(ast, ref);
+    case NodeKind::Alloc:
+      return dispatch<NodeKind::Alloc>(ast, ref);
+    case NodeKind::AllocArray:
+      return dispatch<NodeKind::AllocArray>(ast, ref);
+    case NodeKind::InvalidExpr:
+      return dispatch<NodeKind::InvalidExpr>(ast, ref);
+    case NodeKind::VariableLValue:
+      return dispatch<NodeKind::VariableLValue>(ast, ref);
+    case NodeKind::DereferenceLValue:
+      return dispatch<NodeKind::DereferenceLValue>(ast, ref);
+    case NodeKind::FieldLValue:
+      return dispatch<NodeKind::FieldLValue>(ast, ref);
+    case NodeKind::PointerLValue:
+      return dispatch<NodeKind::PointerLValue>(ast, ref);
+    case NodeKind::ArrayLValue:
+      return dispatch<NodeKind::ArrayLValue>(ast, ref);
+    case NodeKind::Compound:
+      return dispatch<NodeKind::Compound>(ast, ref);
+    case NodeKind::Return:
+      return dispatch<NodeKind::Return>(ast, ref);
+    case NodeKind::Assert:
+      return dispatch<NodeKind::Assert>(ast, ref);
+    case NodeKind::VarDecl:
+      return dispatch<NodeKind::VarDecl>(ast, ref);
+    case NodeKind::UnaryMutation:
+      return dispatch<NodeKind::UnaryMutation>(ast, ref);
+    case NodeKind::Assignment:
+      return dispatch<NodeKind::Assignment>(ast, ref);
+    case NodeKind::ExpressionStmt:
+      return dispatch<NodeKind::ExpressionStmt>(ast, ref);
+    case NodeKind::If:
+      return dispatch<NodeKind::If>(ast, ref);
+    case NodeKind::For:
+      return dispatch<NodeKind::For>(ast, ref);
+    case NodeKind::While:
+      return dispatch<NodeKind::While>(ast, ref);
+    case NodeKind::Error:
+      return dispatch<NodeKind::Error>(ast, ref);
+    case NodeKind::InvalidStmt:
+      return dispatch<NodeKind::InvalidStmt>(ast, ref);
+    case NodeKind::Function:
+      return dispatch<NodeKind::Function>(ast, ref);
+    case NodeKind::Parameter:
+      return dispatch<NodeKind::Parameter>(ast, ref);
+    case NodeKind::Struct:
+      return dispatch<NodeKind::Struct>(ast, ref);
+    case NodeKind::Typedef:
+      return dispatch<NodeKind::Typedef>(ast, ref);
+    case NodeKind::BuiltinType:
+      return dispatch<NodeKind::BuiltinType>(ast, ref);
+    case NodeKind::NamedType:
+      return dispatch<NodeKind::NamedType>(ast, ref);
+    case NodeKind::StructType:
+      return dispatch<NodeKind::StructType>(ast, ref);
+    case NodeKind::PointerType:
+      return dispatch<NodeKind::PointerType>(ast, ref);
+    case NodeKind::ArrayType:
+      return dispatch<NodeKind::ArrayType>(ast, ref);
+    }
+  }
+
+  void walk_children(const flat::FlatAST &ast, flat::NodeRef ref) {
+    const auto &node = ast.get(ref);
+    const auto slots = ast.child_slots(ref);
+    for (std::size_t slot = 0; slot < slots.count; ++slot) {
+      if (static_cast<int>(slot) == slots.list) {
+        walk(ast, ast.list(node, slot++));
+      } else {
+        walk(ast, node.child(slot));
+      }
+    }
+  }
+
+  template <flat::NodeKind K>
+  void visit(const flat::FlatAST &ast, flat::Ref<K> node) {
+    walk_children(ast, node.ref);
+  }
+};
+
+#endif // !DEFS_AST_WALKER_H
@@ -0,0 +1,925 @@
+#include "flat_ast.hpp"
+#include "ast_walker.hpp"
+#include <format>
+#include <stdexcept>
+
+namespace flat {
+
+NodeRef FlatAST::add(NodeKind kind, const Node &node) {
+  auto &array = nodes[static_cast<std::size_t>(kind)];
+  if (array.size() > NodeRef::max_index) {
+    throw std::runtime_error("Too many AST nodes of one kind");
+  }
+  array.push_back(node);
+  return {kind, static_cast<uint32_t>(array.size() - 1)};
+}
+
+void FlatAST::set_list(Node &node, std::size_t slot,
+                       std::span<const NodeRef> items) {
+  node.slots[slot] = static_cast<uint32_t>(lists.size());
+  node.slots[slot + 1] = static_cast<uint32_t>(items.size());
+  lists.insert(lists.end(), items.begin(), items.end());
+}
+
+std::size_t FlatAST::node_count() const {
+  std::size_t count = 0;
+  for (const auto &array : nodes) {
+    count += array.size();
+  }
+  return count;
+}
+
+std::size_t FlatAST::memory_usage() const {
+  std::size_t bytes = 0;
+  for (const auto &array : nodes) {
+    bytes += array.capacity() * sizeof(Node);
+  }
+  bytes += lists.capacity() * sizeof(NodeRef);
+  bytes += literals.capacity() * sizeof(std::string_view);
+  bytes += declarations.capacity() * sizeof(NodeRef);
+  return bytes;
+}
+
+ChildSlots FlatAST::child_slots(NodeRef ref) const {
+  switch (ref.kind()) {
+  case NodeKind::Call:
+  case NodeKind::Compound:
+    return {2, 0};
+  case NodeKind::Struct:
+    return get(ref).flags & Node::HasFields ? ChildSlots{2, 0} : ChildSlots{};
+  case NodeKind::Function:
+    return {4, 1};
+  case NodeKind::UnOp:
+  case NodeKind::Paren:
+  case NodeKind::FieldAccess:
+  case NodeKind::PointerAccess:
+  case NodeKind::Alloc:
+  case NodeKind::DereferenceLValue:
+  case NodeKind::FieldLValue:
+  case NodeKind::PointerLValue:
+  case NodeKind::Return:
+  case NodeKind::Assert:
+  case NodeKind::UnaryMutation:
+  case NodeKind::ExpressionStmt:
+  case NodeKind::Error:
+  case NodeKind::Parameter:
+  case NodeKind::Typedef:
+  case NodeKind::PointerType:
+  case NodeKind::ArrayType:
+    return {1};
+  case NodeKind::BinOp:
+  case NodeKind::ArrayAccess:
+  case NodeKind::AllocArray:
+  case NodeKind::ArrayLValue:
+  case NodeKind::VarDecl:
+  case NodeKind::Assignment:
+  case NodeKind::While:
+    return {2};
+  case NodeKind::Ternary:
+  case NodeKind::If:
+    return {3};
+  case NodeKind::For:
+    return {4};
+  default:
+    return {};
+  }
+}
+
+void FlatAST::clear() {
+  for (auto &array : nodes) {
+    array = {};
+  }
+  lists = {};
+  literals = {};
+  declarations = {};
+}
+
+namespace {
+
+// Post-order walk of the pointer tree: children are added before their
+// parent, so a node's handle is known by the time the parent is written and
+// every child list is copied to the side array in one piece
+class Flattener : public ASTWalker<Flattener> {
+private:
+  FlatAST &ast;
+  NodeRef result;
+
+  template <typename T> NodeRef flatten(T *node) {
+    if (node == nullptr) {
+      return {};
+    }
+    walk(node);
+    return result;
+  }
+
+  static Node make(const ASTNode &from) {
+    Node node;
+    const auto &location = from.get_location();
+    node.begin = location.begin;
+    node.end = location.end;
+    if (!location.is_valid()) {
+      node.flags |= Node::NoLocation;
+    }
+    return node;
+  }
+
+  template <typename T>
+  void add_list(Node &node, std::size_t slot, const std::vector<T *> &items) {
+    std::vector<NodeRef> refs;
+    refs.reserve(items.size());
+    for (auto *item : items) {
+      refs.push_back(flatten(item));
+    }
+    ast.set_list(node, slot, refs);
+  }
+
+  void emit(NodeKind kind, const Node &node) { result = ast.add(kind, node); }
+
+  template <typename T>
+  void emit_unary(NodeKind kind, ASTNode &from, T *operand,
+                  uint32_t name = 0) {
+    const auto child = flatten(operand);
+    auto node = make(from);
+    node.name = name;
+    node.set_child(0, child);
+    emit(kind, node);
+  }
+
+  template <typename T, typename U>
+  void emit_binary(NodeKind kind, ASTNode &from, T *first, U *second) {
+    const auto lhs = flatten(first);
+    const auto rhs = flatten(second);
+    auto node = make(from);
+    node.set_child(0, lhs);
+    node.set_child(1, rhs);
+    emit(kind, node);
+  }
+
+  void emit_literal(NodeKind kind, ASTNode &from, std::string_view text,
+                    uint8_t op = 0) {
+    auto node = make(from);
+    node.name = ast.add_literal(text);
+    node.op = op;
+    emit(kind, node);
+  }
+
+  void emit_named(NodeKind kind, ASTNode &from, ident::Ident name) {
+    auto node = make(from);
+    node.name = name.get_id();
+    emit(kind, node);
+  }
+
+public:
+  explicit Flattener(FlatAST &ast) : ast(ast) {}
+
+  using ASTWalker<Flattener>::visit;
+
+  void visit(TranslationUnit &unit) {
+    for (auto *declaration : unit.get_declarations()) {
+      ast.add_declaration(flatten(declaration));
+    }
+  }
+
+  // ==== Declarations ====
+  void visit(FunctionDeclaration &decl) {
+    const auto ret = flatten(decl.get_return_type());
+    auto node = make(decl);
+    add_list(node, 1, decl.get_parameter_declarations());
+    const auto body = flatten(decl.get_body());
+    node.name = decl.get_ident().get_id();
+    node.set_child(0, ret);
+    node.set_child(3, body);
+    emit(NodeKind::Function, node);
+  }
+  void visit(ParameterDeclaration &decl) {
+    emit_unary(NodeKind::Parameter, decl, decl.get_type(),
+               decl.get_ident().get_id());
+  }
+  void visit(StructDeclaration &decl) {
+    auto node = make(decl);
+    node.name = decl.get_ident().get_id();
+    if (const auto fields = decl.get_fields()) {
+      node.flags |= Node::HasFields;
+      add_list(node, 0, *fields);
+    }
+    emit(NodeKind::Struct, node);
+  }
+  void visit(Typedef &typedef_) {
+    emit_unary(NodeKind::Typedef, typedef_, typedef_.get_type(),
+               typedef_.get_ident().get_id());
+  }
+
+  // ==== Statements ====
+  void visit(CompoundStmt &stmt) {
+    auto node = make(stmt);
+    add_list(node, 0, stmt.get_statements());
+    emit(NodeKind::Compound, node);
+  }
+  void visit(ReturnStmt &stmt) {
+    emit_unary(NodeKind::Return, stmt, stmt.get_expression());
+  }
+  void visit(AssertStmt &stmt) {
+    emit_unary(NodeKind::Assert, stmt, stmt.get_expression());
+  }
+  void visit(VariableDeclarationStatement &stmt) {
+    emit_binary(NodeKind::VarDecl, stmt, stmt.get_type(),
+                stmt.get_initializer());
+    ast.get(result).name = stmt.get_ident().get_id();
+    ast.get(result).set_symbol(stmt.get_symbol());
+  }
+  void visit(UnaryMutationStatement &stmt) {
+    emit_unary(NodeKind::UnaryMutation, stmt, stmt.get_target());
+    ast.get(result).op = static_cast<uint8_t>(stmt.get_operation());
+  }
+  void visit(AssignmentStatement &stmt) {
+    emit_binary(NodeKind::Assignment, stmt, stmt.get_lvalue(), stmt.get_expr());
+    ast.get(result).op = static_cast<uint8_t>(stmt.get_op());
+  }
+  void visit(ExpressionStatement &stmt) {
+    emit_unary(NodeKind::ExpressionStmt, stmt, stmt.get_expression());
+  }
+  void visit(IfStatement &stmt) {
+    const auto cond = flatten(stmt.get_condition());
+    const auto then = flatten(stmt.get_then_branch());
+    const auto else_ = flatten(stmt.get_else_branch());
+    auto node = make(stmt);
+    node.set_child(0, cond);
+    node.set_child(1, then);
+    node.set_child(2, else_);
+    emit(NodeKind::If, node);
+  }
+  void visit(ForStatement &stmt) {
+    const auto init = flatten(stmt.get_init());
+    const auto cond = flatten(stmt.get_condition());
+    const auto incr = flatten(stmt.get_increment());
+    const auto body = flatten(stmt.get_body());
+    auto node = make(stmt);
+    node.set_child(0, init);
+    node.set_child(1, cond);
+    node.set_child(2, incr);
+    node.set_child(3, body);
+    emit(NodeKind::For, node);
+  }
+  void visit(WhileStatement &stmt) {
+    emit_binary(NodeKind::While, stmt, stmt.get_condition(), stmt.get_body());
+  }
+  void visit(ErrorStatement &stmt) {
+    emit_unary(NodeKind::Error, stmt, stmt.get_expr());
+  }
+  void visit(InvalidStatement &stmt) {
+    emit(NodeKind::InvalidStmt, make(stmt));
+  }
+
+  // ==== Expressions ====
+  void visit(NumericExpr &expr) {
+    emit_literal(NodeKind::Numeric, expr, expr.get_value(),
+                 static_cast<uint8_t>(expr.get_base()));
+  }
+  void visit(StringLiteralExpr &expr) {
+    emit_literal(NodeKind::String, expr, expr.get_value());
+  }
+  void visit(CharLiteralExpr &expr) {
+    emit_literal(NodeKind::Char, expr, expr.get_value());
+  }
+  void visit(BoolConstExpr &expr) {
+    auto node = make(expr);
+    node.op = expr.get_value() ? 1 : 0;
+    emit(NodeKind::BoolConst, node);
+  }
+  void visit(NullExpr &expr) { emit(NodeKind::Null, make(expr)); }
+  void visit(VarExpr &expr) {
+    emit_named(NodeKind::Var, expr, expr.get_ident());
+    ast.get(result).set_symbol(expr.get_symbol());
+  }
+  void visit(CallExpr &expr) {
+    auto node = make(expr);
+    node.name = expr.get_function_ident().get_id();
+    add_list(node, 0, expr.get_params());
+    emit(NodeKind::Call, node);
+  }
+  void visit(TernaryExpression &expr) {
+    const auto cond = flatten(expr.get_condition());
+    const auto then = flatten(expr.get_then());
+    const auto else_ = flatten(expr.get_else());
+    auto node = make(expr);
+    node.set_child(0, cond);
+    node.set_child(1, then);
+    node.set_child(2, else_);
+    emit(NodeKind::Ternary, node);
+  }
+  void visit(BinaryOperatorExpression &expr) {
+    emit_binary(NodeKind::BinOp, expr, expr.get_left_expression(),
+                expr.get_right_expression());
+    ast.get(result).op = static_cast<uint8_t>(expr.get_operator_kind());
+  }
+  void visit(UnaryOperatorExpression &expr) {
+    emit_unary(NodeKind::UnOp, expr, expr.get_expression());
+    ast.get(result).op = static_cast<uint8_t>(expr.get_operator_kind());
+  }
+  void visit(ParenthesisExpression &expr) {
+    emit_unary(NodeKind::Paren, expr, expr.get_expression());
+  }
+  void visit(ArrayAccessExpr &expr) {
+    emit_binary(NodeKind::ArrayAccess, expr, expr.get_array(),
+                expr.get_index());
+  }
+  void visit(FieldAccessExpr &expr) {
+    emit_unary(NodeKind::FieldAccess, expr, expr.get_struct(),
+               expr.get_field_ident().get_id());
+  }
+  void visit(PointerAccessExpr &expr) {
+    emit_unary(NodeKind::PointerAccess, expr, expr.get_struct_pointer(),
+               expr.get_field_ident().get_id());
+  }
+  void visit(AllocExpression &expr) {
+    emit_unary(NodeKind::Alloc, expr, expr.get_type());
+  }
+  void visit(AllocArrayExpression &expr) {
+    emit_binary(NodeKind::AllocArray, expr, expr.get_type(), expr.get_size());
+  }
+  void visit(InvalidExpr &expr) {
+    emit(NodeKind::InvalidExpr, make(expr));
+  }
+
+  // ==== LValues ====
+  void visit(VariableLValue &val) {
+    emit_named(NodeKind::VariableLValue, val, val.get_ident());
+    ast.get(result).set_symbol(val.get_symbol());
+  }
+  void visit(DereferenceLValue &val) {
+    emit_unary(NodeKind::DereferenceLValue, val, val.get_operand());
+  }
+  void visit(FieldAccessLValue &val) {
+    emit_unary(NodeKind::FieldLValue, val, val.get_base(),
+               val.get_field_ident().get_id());
+  }
+  void visit(PointerAccessLValue &val) {
+    emit_unary(NodeKind::PointerLValue, val, val.get_base(),
+               val.get_field_ident().get_id());
+  }
+  void visit(ArrayAccessLValue &val) {
+    emit_binary(NodeKind::ArrayLValue, val, val.get_base(), val.get_index());
+  }
+
+  // ==== Types ====
+  void visit(BuiltinTypeAnnotation &type) {
+    auto node = make(type);
+    node.op = static_cast<uint8_t>(type.get_type());
+    emit(NodeKind::BuiltinType, node);
+  }
+  void visit(NamedTypeAnnotation &type) {
+    emit_named(NodeKind::NamedType, type, type.get_ident());
+  }
+  void visit(StructTypeAnnotation &type) {
+    emit_named(NodeKind::StructType, type, type.get_ident());
+  }
+  void visit(PointerTypeAnnotation &type) {
+    emit_unary(NodeKind::PointerType, type, type.get_type());
+  }
+  void visit(ArrayTypeAnnotation &type) {
+    emit_unary(NodeKind::ArrayType, type, type.get_type());
+  }
+};
+
+class Materializer {
+private:
+  const FlatAST &ast;
+  arena::Arena &arena;
+
+  [[nodiscard]] SourceLocation location(const Node &node) const {
+    return ast.location(node);
+  }
+
+  static ident::Ident name(const Node &node) { return ident::Ident{node.name}; }
+
+public:
+  Materializer(const FlatAST &ast, arena::Arena &arena)
+      : ast(ast), arena(arena) {}
+
+  TypeAnnotation *type(NodeRef ref) {
+    if (ref.is_null()) {
+      return nullptr;
+    }
+    const auto &node = ast.get(ref);
+    switch (ref.kind()) {
+    case NodeKind::BuiltinType:
+      return arena.create<BuiltinTypeAnnotation>(static_cast<Builtin>(node.op),
+                                                 location(node));
+    case NodeKind::NamedType:
+      return arena.create<NamedTypeAnnotation>(name(node), location(node));
+    case NodeKind::StructType:
+      return arena.create<StructTypeAnnotation>(name(node), location(node));
+    case NodeKind::PointerType:
+      return arena.create<PointerTypeAnnotation>(type(node.child(0)),
+                                                 location(node));
+    case NodeKind::ArrayType:
+      return arena.create<ArrayTypeAnnotation>(type(node.child(0)),
+                                               location(node));
+    default:
+      throw std::runtime_error("Flat node is not a type");
+    }
+  }
+
+  Expression *expression(NodeRef ref) {
+    if (ref.is_null()) {
+      return nullptr;
+    }
+    const auto &node = ast.get(ref);
+    const auto loc = location(node);
+    switch (ref.kind()) {
+    case NodeKind::Numeric:
+      return arena.create<NumericExpr>(
+          ast.literal(node), static_cast<NumericExpr::Base>(node.op), loc);
+    case NodeKind::String:
+      return arena.create<StringLiteralExpr>(ast.literal(node), loc);
+    case NodeKind::Char:
+      return arena.create<CharLiteralExpr>(ast.literal(node), loc);
+    case NodeKind::BoolConst:
+      return arena.create<BoolConstExpr>(node.op ? "true" : "false", loc);
+    case NodeKind::Null:
+      return arena.create<NullExpr>(loc);
+    case NodeKind::Var: {
+      auto *var = arena.create<VarExpr>(name(node), loc);
+      var->set_symbol(node.symbol());
+      return var;
+    }
+    case NodeKind::Call: {
+      auto *call = arena.create<CallExpr>(name(node), loc);
+      for (const auto arg : ast.list(node, 0)) {
+        call->add_param(expression(arg));
+      }
+      return call;
+    }
+    case NodeKind::Ternary:
+      return arena.create<TernaryExpression>(expression(node.child(0)),
+                                             expression(node.child(1)),
+                                             expression(node.child(2)), loc);
+    case NodeKind::BinOp:
+      return arena.create<BinaryOperatorExpression>(
+          expression(node.child(0)), expression(node.child(1)),
+          static_cast<BinaryOperator>(node.op), loc);
+    case NodeKind::UnOp:
+      return arena.create<UnaryOperatorExpression>(
+          expression(node.child(0)), static_cast<UnaryOperator>(node.op), loc);
+    case NodeKind::Paren:
+      return arena.create<ParenthesisExpression>(expression(node.child(0)),
+                                                 loc);
+    case NodeKind::ArrayAccess:
+      return arena.create<ArrayAccessExpr>(expression(node.child(0)),
+                                           expression(node.child(1)), loc);
+    case NodeKind::FieldAccess:
+      return arena.create<FieldAccessExpr>(expression(node.child(0)),
+                                           name(node), loc);
+    case NodeKind::PointerAccess:
+      return arena.create<PointerAccessExpr>(expression(node.child(0)),
+                                             name(node), loc);
+    case NodeKind::Alloc:
+      return arena.create<AllocExpression>(type(node.child(0)), loc);
+    case NodeKind::AllocArray:
+      return arena.create<AllocArrayExpression>(
+          type(node.child(0)), expression(node.child(1)), loc);
+    case NodeKind::InvalidExpr:
+      return arena.create<InvalidExpr>(loc);
+    default:
+      throw std::runtime_error("Flat node is not an expression");
+    }
+  }
+
+  LValue *lvalue(NodeRef ref) {
+    const auto &node = ast.get(ref);
+    const auto loc = location(node);
+    switch (ref.kind()) {
+    case NodeKind::VariableLValue: {
+      auto *var = arena.create<VariableLValue>(name(node), loc);
+      var->set_symbol(node.symbol());
+      return var;
+    }
+    case NodeKind::DereferenceLValue:
+      return arena.create<DereferenceLValue>(lvalue(node.child(0)), loc);
+    case NodeKind::FieldLValue:
+      return arena.create<FieldAccessLValue>(lvalue(node.child(0)), name(node),
+                                             loc);
+    case NodeKind::PointerLValue:
+      return arena.create<PointerAccessLValue>(lvalue(node.child(0)),
+                                               name(node), loc);
+    case NodeKind::ArrayLValue:
+      return arena.create<ArrayAccessLValue>(lvalue(node.child(0)),
+                                             expression(node.child(1)), loc);
+    default:
+      throw std::runtime_error("Flat node is not an lvalue");
+    }
+  }
+
+  VariableDeclarationStatement *variable(NodeRef ref) {
+    const auto &node = ast.get(ref);
+    auto *var = arena.create<VariableDeclarationStatement>(
+        type(node.child(0)), name(node), expression(node.child(1)),
+        location(node));
+    var->set_symbol(node.symbol());
+    return var;
+  }
+
+  CompoundStmt *compound(NodeRef ref) {
+    const auto &node = ast.get(ref);
+    std::vector<Statement *> statements;
+    statements.reserve(node.slots[1]);
+    for (const auto child : ast.list(node, 0)) {
+      statements.push_back(statement(child));
+    }
+    return arena.create<CompoundStmt>(std::move(statements), location(node));
+  }
+
+  Statement *statement(NodeRef ref) {
+    if (ref.is_null()) {
+      return nullptr;
+    }
+    const auto &node = ast.get(ref);
+    const auto loc = location(node);
+    switch (ref.kind()) {
+    case NodeKind::Compound:
+      return compound(ref);
+    case NodeKind::Return: {
+      auto *stmt = arena.create<ReturnStmt>(loc);
+      stmt->set_expression(expression(node.child(0)));
+      return stmt;
+    }
+    case NodeKind::Assert: {
+      auto *stmt = arena.create<AssertStmt>(loc);
+      stmt->set_expression(expression(node.child(0)));
+      return stmt;
+    }
+    case NodeKind::VarDecl:
+      return variable(ref);
+    case NodeKind::UnaryMutation:
+      return arena.create<UnaryMutationStatement>(
+          lvalue(node.child(0)),
+          static_cast<UnaryMutationStatement::Op>(node.op), loc);
+    case NodeKind::Assignment:
+      return arena.create<AssignmentStatement>(
+          lvalue(node.child(0)), static_cast<AssignmentOperator>(node.op),
+          expression(node.child(1)), loc);
+    case NodeKind::ExpressionStmt:
+      return arena.create<ExpressionStatement>(expression(node.child(0)), loc);
+    case NodeKind::If:
+      return arena.create<IfStatement>(expression(node.child(0)),
+                                       statement(node.child(1)),
+                                       statement(node.child(2)), loc);
+    case NodeKind::For:
+      return arena.create<ForStatement>(
+          statement(node.child(0)), expression(node.child(1)),
+          statement(node.child(2)), statement(node.child(3)), loc);
+    case NodeKind::While:
+      return arena.create<WhileStatement>(expression(node.child(0)),
+                                          statement(node.child(1)), loc);
+    case NodeKind::Error:
+      return arena.create<ErrorStatement>(expression(node.child(0)), loc);
+    case NodeKind::InvalidStmt:
+      return arena.create<InvalidStatement>(loc);
+    default:
+      throw std::runtime_error("Flat node is not a statement");
+    }
+  }
+
+  Declaration *declaration(NodeRef ref) {
+    const auto &node = ast.get(ref);
+    const auto loc = location(node);
+    switch (ref.kind()) {
+    case NodeKind::Function: {
+      auto *function = arena.create<FunctionDeclaration>(
+          name(node), type(node.child(0)), loc);
+      for (const auto param : ast.list(node, 1)) {
+        function->add_parameter_declaration(
+            static_cast<ParameterDeclaration *>(declaration(param)));
+      }
+      if (!node.child(3).is_null()) {
+        function->set_body(compound(node.child(3)));
+      }
+      return function;
+    }
+    case NodeKind::Parameter:
+      return arena.create<ParameterDeclaration>(name(node), type(node.child(0)),
+                                                loc);
+    case NodeKind::Struct: {
+      if (!(node.flags & Node::HasFields)) {
+        return arena.create<StructDeclaration>(name(node), loc);
+      }
+      std::vector<VariableDeclarationStatement *> fields;
+      for (const auto field : ast.list(node, 0)) {
+        fields.push_back(variable(field));
+      }
+      return arena.create<StructDeclaration>(name(node), std::move(fields),
+                                             loc);
+    }
+    case NodeKind::Typedef:
+      return arena.create<Typedef>(type(node.child(0)), name(node), loc);
+    default:
+      throw std::runtime_error("Flat node is not a declaration");
+    }
+  }
+};
+
+// What a walk saw of one node, for verify_round_trip
+struct TraceEntry {
+  NodeKind kind;
+  SourceLocation location;
+  // Identifier id, or the text of a literal
+  uint32_t name = 0;
+  std::string_view text;
+  SymbolId symbol;
+
+  [[nodiscard]] bool matches(const TraceEntry &other) const {
+    return kind == other.kind && location.file_id == other.location.file_id &&
+           location.begin == other.location.begin &&
+           location.end == other.location.end && name == other.name &&
+           text == other.text && symbol == other.symbol;
+  }
+};
+
+// Pre-order walk of a pointer tree, children in the order of their slots in
+// the flat form
+class PointerTrace : public ASTWalker<PointerTrace> {
+private:
+  std::vector<TraceEntry> &trace;
+
+  void record(NodeKind kind, const ASTNode &node, uint32_t name = 0,
+              std::string_view text = {}, SymbolId symbol = {}) {
+    trace.push_back({kind, node.get_location(), name, text, symbol});
+  }
+
+  template <typename T> void walk_all(const std::vector<T *> &items) {
+    for (auto *item : items) {
+      walk(item);
+    }
+  }
+
+public:
+  explicit PointerTrace(std::vector<TraceEntry> &trace) : trace(trace) {}
+
+  using ASTWalker<PointerTrace>::visit;
+
+  void visit(TranslationUnit &unit) { walk_all(unit.get_declarations()); }
+
+  // ==== Declarations ====
+  void visit(FunctionDeclaration &decl) {
+    record(NodeKind::Function, decl, decl.get_ident().get_id());
+    walk(decl.get_return_type());
+    walk_all(decl.get_parameter_declarations());
+    walk(decl.get_body());
+  }
+  void visit(ParameterDeclaration &decl) {
+    record(NodeKind::Parameter, decl, decl.get_ident().get_id());
+    walk(decl.get_type());
+  }
+  void visit(StructDeclaration &decl) {
+    record(NodeKind::Struct, decl, decl.get_ident().get_id());
+    if (const auto fields = decl.get_fields()) {
+      walk_all(*fields);
+    }
+  }
+  void visit(Typedef &typedef_) {
+    record(NodeKind::Typedef, typedef_, typedef_.get_ident().get_id());
+    walk(typedef_.get_type());
+  }
+
+  // ==== Statements ====
+  void visit(CompoundStmt &stmt) {
+    record(NodeKind::Compound, stmt);
+    walk_all(stmt.get_statements());
+  }
+  void visit(ReturnStmt &stmt) {
+    record(NodeKind::Return, stmt);
+    walk(stmt.get_expression());
+  }
+  void visit(AssertStmt &stmt) {
+    record(NodeKind::Assert, stmt);
+    walk(stmt.get_expression());
+  }
+  void visit(VariableDeclarationStatement &stmt) {
+    record(NodeKind::VarDecl, stmt, stmt.get_ident().get_id(), {},
+           stmt.get_symbol());
+    walk(stmt.get_type());
+    walk(stmt.get_initializer());
+  }
+  void visit(UnaryMutationStatement &stmt) {
+    record(NodeKind::UnaryMutation, stmt);
+    walk(stmt.get_target());
+  }
+  void visit(AssignmentStatement &stmt) {
+    record(NodeKind::Assignment, stmt);
+    walk(stmt.get_lvalue());
+    walk(stmt.get_expr());
+  }
+  void visit(ExpressionStatement &stmt) {
+    record(NodeKind::ExpressionStmt, stmt);
+    walk(stmt.get_expression());
+  }
+  void visit(IfStatement &stmt) {
+    record(NodeKind::If, stmt);
+    walk(stmt.get_condition());
+    walk(stmt.get_then_branch());
+    walk(stmt.get_else_branch());
+  }
+  void visit(ForStatement &stmt) {
+    record(NodeKind::For, stmt);
+    walk(stmt.get_init());
+    walk(stmt.get_condition());
+    walk(stmt.get_increment());
+    walk(stmt.get_body());
+  }
+  void visit(WhileStatement &stmt) {
+    record(NodeKind::While, stmt);
+    walk(stmt.get_condition());
+    walk(stmt.get_body());
+  }
+  void visit(ErrorStatement &stmt) {
+    record(NodeKind::Error, stmt);
+    walk(stmt.get_expr());
+  }
+  void visit(InvalidStatement &stmt) { record(NodeKind::InvalidStmt, stmt); }
+
+  // ==== Expressions ====
+  void visit(NumericExpr &expr) {
+    record(NodeKind::Numeric, expr, 0, expr.get_value());
+  }
+  void visit(StringLiteralExpr &expr) {
+    record(NodeKind::String, expr, 0, expr.get_value());
+  }
+  void visit(CharLiteralExpr &expr) {
+    record(NodeKind::Char, expr, 0, expr.get_value());
+  }
+  void visit(BoolConstExpr &expr) { record(NodeKind::BoolConst, expr); }
+  void visit(NullExpr &expr) { record(NodeKind::Null, expr); }
+  void visit(VarExpr &expr) {
+    record(NodeKind::Var, expr, expr.get_ident().get_id(), {},
+           expr.get_symbol());
+  }
+  void visit(CallExpr &expr) {
+    record(NodeKind::Call, expr, expr.get_function_ident().get_id());
+    walk_all(expr.get_params());
+  }
+  void visit(TernaryExpression &expr) {
+    record(NodeKind::Ternary, expr);
+    walk(expr.get_condition());
+    walk(expr.get_then());
+    walk(expr.get_else());
+  }
+  void visit(BinaryOperatorExpression &expr) {
+    record(NodeKind::BinOp, expr);
+    walk(expr.get_left_expression());
+    walk(expr.get_right_expression());
+  }
+  void visit(UnaryOperatorExpression &expr) {
+    record(NodeKind::UnOp, expr);
+    walk(expr.get_expression());
+  }
+  void visit(ParenthesisExpression &expr) {
+    record(NodeKind::Paren, expr);
+    walk(expr.get_expression());
+  }
+  void visit(ArrayAccessExpr &expr) {
+    record(NodeKind::ArrayAccess, expr);
+    walk(expr.get_array());
+    walk(expr.get_index());
+  }
+  void visit(FieldAccessExpr &expr) {
+    record(NodeKind::FieldAccess, expr, expr.get_field_ident().get_id());
+    walk(expr.get_struct());
+  }
+  void visit(PointerAccessExpr &expr) {
+    record(NodeKind::PointerAccess, expr, expr.get_field_ident().get_id());
+    walk(expr.get_struct_pointer());
+  }
+  void visit(AllocExpression &expr) {
+    record(NodeKind::Alloc, expr);
+    walk(expr.get_type());
+  }
+  void visit(AllocArrayExpression &expr) {
+    record(NodeKind::AllocArray, expr);
+    walk(expr.get_type());
+    walk(expr.get_size());
+  }
+  void visit(InvalidExpr &expr) { record(NodeKind::InvalidExpr, expr); }
+
+  // ==== LValues ====
+  void visit(VariableLValue &val) {
+    record(NodeKind::VariableLValue, val, val.get_ident().get_id(), {},
+           val.get_symbol());
+  }
+  void visit(DereferenceLValue &val) {
+    record(NodeKind::DereferenceLValue, val);
+    walk(val.get_operand());
+  }
+  void visit(FieldAccessLValue &val) {
+    record(NodeKind::FieldLValue, val, val.get_field_ident().get_id());
+    walk(val.get_base());
+  }
+  void visit(PointerAccessLValue &val) {
+    record(NodeKind::PointerLValue, val, val.get_field_ident().get_id());
+    walk(val.get_base());
+  }
+  void visit(ArrayAccessLValue &val) {
+    record(NodeKind::ArrayLValue, val);
+    walk(val.get_base());
+    walk(val.get_index());
+  }
+
+  // ==== Types ====
+  void visit(BuiltinTypeAnnotation &type) {
+    record(NodeKind::BuiltinType, type);
+  }
+  void visit(NamedTypeAnnotation &type) {
+    record(NodeKind::NamedType, type, type.get_ident().get_id());
+  }
+  void visit(StructTypeAnnotation &type) {
+    record(NodeKind::StructType, type, type.get_ident().get_id());
+  }
+  void visit(PointerTypeAnnotation &type) {
+    record(NodeKind::PointerType, type);
+    walk(type.get_type());
+  }
+  void visit(ArrayTypeAnnotation &type) {
+    record(NodeKind::ArrayType, type);
+    walk(type.get_type());
+  }
+};
+
+// The same over the flat form, through the default handlers of the walk
+class FlatTrace : public ASTWalker<FlatTrace> {
+private:
+  std::vector<TraceEntry> &trace;
+
+public:
+  explicit FlatTrace(std::vector<TraceEntry> &trace) : trace(trace) {}
+
+  template <NodeKind K> void visit(const FlatAST &ast, Ref<K> node) {
+    TraceEntry entry{K, ast.location(node.node)};
+    if constexpr (K == NodeKind::Numeric || K == NodeKind::String ||
+                  K == NodeKind::Char) {
+      entry.text = ast.literal(node.node);
+    } else {
+      entry.name = node.node.name;
+    }
+    if constexpr (K == NodeKind::Var || K == NodeKind::VariableLValue ||
+                  K == NodeKind::VarDecl) {
+      entry.symbol = node.node.symbol();
+    }
+    trace.push_back(entry);
+    walk_children(ast, node.ref);
+  }
+};
+
+void compare(std::string_view walk, const std::vector<TraceEntry> &expected,
+             const std::vector<TraceEntry> &actual,
+             std::vector<std::string> &errors) {
+  if (expected.size() != actual.size()) {
+    errors.push_back(std::format("The {} walk visits {} nodes instead of {}",
+                                 walk, actual.size(), expected.size()));
+    return;
+  }
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    if (!expected[i].matches(actual[i])) {
+      errors.push_back(std::format(
+          "Node {} of the {} walk (kind {}) differs from the pointer tree", i,
+          walk, static_cast<int>(actual[i].kind)));
+    }
+  }
+}
+
+} // namespace
+
+FlatAST flatten(TranslationUnit &unit, uint32_t file_id) {
+  FlatAST ast{file_id};
+  Flattener flattener{ast};
+  flattener.walk(unit);
+  return ast;
+}
+
+TranslationUnit *materialize(const FlatAST &ast, arena::Arena &arena) {
+  Materializer materializer{ast, arena};
+  auto *unit = arena.create<TranslationUnit>(
+      SourceLocation{ast.get_file_id(), 0, 0});
+  for (const auto declaration : ast.get_declarations()) {
+    unit->add_declaration(materializer.declaration(declaration));
+  }
+  return unit;
+}
+
+std::vector<std::string> verify_round_trip(TranslationUnit &unit,
+                                           uint32_t file_id) {
+  std::vector<TraceEntry> expected{};
+  PointerTrace{expected}.walk(unit);
+
+  std::vector<std::string> errors{};
+  const auto ast = flatten(unit, file_id);
+  std::vector<TraceEntry> flat{};
+  FlatTrace{flat}.walk(ast);
+  compare("flat", expected, flat, errors);
+
+  arena::Arena arena{};
+  std::vector<TraceEntry> materialized{};
+  PointerTrace{materialized}.walk(*materialize(ast, arena));
+  compare("materialized", expected, materialized, errors);
+  return errors;
+}
+
+} // namespace flat
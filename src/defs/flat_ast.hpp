@@ -0,0 +1,266 @@
+#ifndef DEFS_FLAT_AST_H
+#define DEFS_FLAT_AST_H
+
+#include "../alloc/arena.hpp"
+#include "ast.hpp"
+#include "source_location.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Flat, index based form of the AST. The nodes of every kind live in one
+// dense array per kind and refer to each other through 32-bit handles, lists
+// of children are contiguous ranges of a shared side array. There are no per
+// node allocations, walking all nodes of a kind is a linear scan, and the
+// whole tree is dropped or snapshotted (copied) in one go.
+//
+// The parser still builds the pointer tree and name resolution binds symbols
+// on it. flatten() converts it, ASTWalker walks the result by handle (type
+// checking runs on this form), and materialize() converts back.
+namespace flat {
+
+enum class NodeKind : uint8_t {
+  // Expressions
+  Numeric,
+  String,
+  Char,
+  BoolConst,
+  Null,
+  Var,
+  Call,
+  Ternary,
+  BinOp,
+  UnOp,
+  Paren,
+  ArrayAccess,
+  FieldAccess,
+  PointerAccess,
+  Alloc,
+  AllocArray,
+  InvalidExpr,
+  // LValues
+  VariableLValue,
+  DereferenceLValue,
+  FieldLValue,
+  PointerLValue,
+  ArrayLValue,
+  // Statements
+  Compound,
+  Return,
+  Assert,
+  VarDecl,
+  UnaryMutation,
+  Assignment,
+  ExpressionStmt,
+  If,
+  For,
+  While,
+  Error,
+  InvalidStmt,
+  // Declarations
+  Function,
+  Parameter,
+  Struct,
+  Typedef,
+  // Types
+  BuiltinType,
+  NamedType,
+  StructType,
+  PointerType,
+  ArrayType,
+};
+
+inline constexpr std::size_t node_kind_count =
+    static_cast<std::size_t>(NodeKind::ArrayType) + 1;
+
+// Kind in the top 6 bits, index into that kind's array in the low 26
+class NodeRef {
+private:
+  static constexpr unsigned index_bits = 26;
+  static constexpr uint32_t null_raw = 0xFFFFFFFF;
+
+  uint32_t raw = null_raw;
+
+public:
+  static constexpr uint32_t max_index = (1u << index_bits) - 1;
+
+  constexpr NodeRef() = default;
+  constexpr NodeRef(NodeKind kind, uint32_t index)
+      : raw((static_cast<uint32_t>(kind) << index_bits) | index) {}
+
+  static constexpr NodeRef from_raw(uint32_t raw) {
+    NodeRef ref;
+    ref.raw = raw;
+    return ref;
+  }
+
+  [[nodiscard]] constexpr NodeKind kind() const {
+    return static_cast<NodeKind>(raw >> index_bits);
+  }
+  [[nodiscard]] constexpr uint32_t index() const { return raw & max_index; }
+  [[nodiscard]] constexpr uint32_t get_raw() const { return raw; }
+  [[nodiscard]] constexpr bool is_null() const { return raw == null_raw; }
+
+  constexpr bool operator==(const NodeRef &) const = default;
+};
+
+// One record per node, 32 bytes for every kind. What the fields hold:
+//
+//   name    identifier id (Var, Call, field accesses, VariableLValue,
+//           VarDecl, declarations, Named/StructType) or the literal index
+//           (Numeric, String, Char)
+//   op      BinaryOperator, UnaryOperator, AssignmentOperator,
+//           UnaryMutationStatement::Op, Builtin, NumericExpr::Base or the
+//           value of a BoolConst
+//   slots   children, a list takes two slots (first, count), and the
+//           SymbolId of Var, VariableLValue and VarDecl in slot 3:
+//             Call           args list 0-1
+//             Ternary        cond 0, then 1, else 2
+//             BinOp          left 0, right 1
+//             UnOp, Paren    operand 0
+//             ArrayAccess    array 0, index 1
+//             Field/PointerAccess, Field/PointerLValue, DereferenceLValue
+//                            operand 0
+//             ArrayLValue    base 0, index 1
+//             Alloc          type 0
+//             AllocArray     type 0, size 1
+//             Compound       statements list 0-1
+//             Return, Assert, ExpressionStmt, Error
+//                            expression 0 (Return: may be null)
+//             VarDecl        type 0, initializer 1 (may be null)
+//             UnaryMutation  target 0
+//             Assignment     lvalue 0, expression 1
+//             If             cond 0, then 1, else 2 (may be null)
+//             For            init 0, cond 1, increment 2, body 3
+//                            (init and increment may be null)
+//             While          cond 0, body 1
+//             Function       return type 0, parameters list 1-2,
+//                            body 3 (may be null)
+//             Parameter, Typedef, Pointer/ArrayType
+//                            type 0
+//             Struct         fields list 0-1, if HasFields is set
+struct Node {
+  enum Flag : uint8_t {
+    HasFields = 1 << 0,
+    // The pointer node had no location (e.g. AssertStmt)
+    NoLocation = 1 << 1,
+  };
+
+  uint32_t begin = 0;
+  uint32_t end = 0;
+  uint32_t name = 0;
+  uint8_t op = 0;
+  uint8_t flags = 0;
+  std::array<uint32_t, 4> slots{};
+
+  [[nodiscard]] NodeRef child(std::size_t slot) const {
+    return NodeRef::from_raw(slots[slot]);
+  }
+  void set_child(std::size_t slot, NodeRef ref) { slots[slot] = ref.get_raw(); }
+
+  [[nodiscard]] SymbolId symbol() const { return SymbolId{slots[3]}; }
+  void set_symbol(SymbolId symbol) { slots[3] = symbol.get_id(); }
+};
+
+static_assert(sizeof(Node) == 32, "flat::Node should stay 32 bytes");
+
+// Which slots of a node hold children: slots [0, count), of which `list`
+// and list + 1 are a list (-1 if there is none)
+struct ChildSlots {
+  uint8_t count = 0;
+  int8_t list = -1;
+};
+
+// A handle whose kind is known at compile time, what the walk over the flat
+// form hands to a pass
+template <NodeKind K> struct Ref {
+  NodeRef ref;
+  const Node &node;
+};
+
+class FlatAST {
+private:
+  uint32_t file_id;
+  std::array<std::vector<Node>, node_kind_count> nodes{};
+  std::vector<NodeRef> lists;
+  std::vector<std::string_view> literals;
+  std::vector<NodeRef> declarations;
+
+public:
+  explicit FlatAST(uint32_t file_id = 0) : file_id(file_id) {}
+
+  [[nodiscard]] uint32_t get_file_id() const { return file_id; }
+
+  NodeRef add(NodeKind kind, const Node &node);
+
+  [[nodiscard]] const Node &get(NodeRef ref) const {
+    return nodes[static_cast<std::size_t>(ref.kind())][ref.index()];
+  }
+  [[nodiscard]] Node &get(NodeRef ref) {
+    return nodes[static_cast<std::size_t>(ref.kind())][ref.index()];
+  }
+
+  // All nodes of one kind, in creation order
+  [[nodiscard]] std::span<const Node> nodes_of(NodeKind kind) const {
+    return nodes[static_cast<std::size_t>(kind)];
+  }
+
+  // Copies `items` to the side array and stores the range in
+  // slots[slot] (first) and slots[slot + 1] (count)
+  void set_list(Node &node, std::size_t slot, std::span<const NodeRef> items);
+  [[nodiscard]] std::span<const NodeRef> list(const Node &node,
+                                              std::size_t slot) const {
+    return std::span{lists}.subspan(node.slots[slot], node.slots[slot + 1]);
+  }
+
+  uint32_t add_literal(std::string_view text) {
+    literals.push_back(text);
+    return static_cast<uint32_t>(literals.size() - 1);
+  }
+  [[nodiscard]] std::string_view literal(const Node &node) const {
+    return literals[node.name];
+  }
+
+  [[nodiscard]] SourceLocation location(const Node &node) const {
+    if (node.flags & Node::NoLocation) {
+      return {};
+    }
+    return {file_id, node.begin, node.end};
+  }
+
+  void add_declaration(NodeRef declaration) {
+    declarations.push_back(declaration);
+  }
+  [[nodiscard]] std::span<const NodeRef> get_declarations() const {
+    return declarations;
+  }
+
+  [[nodiscard]] ChildSlots child_slots(NodeRef ref) const;
+
+  [[nodiscard]] std::size_t node_count() const;
+  // Bytes held by the node arrays and side tables
+  [[nodiscard]] std::size_t memory_usage() const;
+  void clear();
+};
+
+// Flattens a tree built by the parser, together with the symbols resolved so
+// far
+FlatAST flatten(TranslationUnit &unit, uint32_t file_id);
+
+// Rebuilds pointer nodes from a flat tree in `arena`, the result can be
+// walked by any pass
+TranslationUnit *materialize(const FlatAST &ast, arena::Arena &arena);
+
+// Flattens `unit`, walks the result and its materialized copy, and checks
+// that both visit the same nodes as a walk of `unit`. Returns what differs,
+// nothing if the round trip is exact.
+std::vector<std::string> verify_round_trip(TranslationUnit &unit,
+                                           uint32_t file_id);
+
+} // namespace flat
+
+#endif // !DEFS_FLAT_AST_H
@@ -0,0 +1,149 @@
+#ifndef DEFS_IDENT_H
+#define DEFS_IDENT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace ident {
+
+// Dense id of an interned identifier. Two identifiers are the same name iff
+// their ids are equal, id 0 is reserved for "no identifier".
+class Ident {
+private:
+  uint32_t id = 0;
+
+public:
+  constexpr Ident() = default;
+  constexpr explicit Ident(uint32_t id) : id(id) {}
+
+  [[nodiscard]] constexpr uint32_t get_id() const { return id; }
+  [[nodiscard]] constexpr bool is_valid() const { return id != 0; }
+
+  constexpr auto operator<=>(const Ident &) const = default;
+};
+
+// Maps identifier text to dense ids. Text is copied into chunked storage owned
+// by the interner, so views handed out stay valid for its whole lifetime,
+// independent of the source buffer the identifier was lexed from.
+class Interner {
+private:
+  struct Slot {
+    uint32_t hash;
+    uint32_t id; // 0 marks an empty slot
+  };
+
+  static constexpr std::size_t chunk_size = 64 * 1024;
+  static constexpr std::size_t initial_slots = 1024;
+
+  std::vector<Slot> slots;
+  std::vector<std::string_view> names; // indexed by id, names[0] is empty
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char *chunk_pos = nullptr;
+  char *chunk_end = nullptr;
+
+  static uint32_t hash(std::string_view text) {
+    // FNV-1a, identifiers are short so this beats the generic string hash
+    uint32_t h = 2166136261u;
+    for (const char c : text) {
+      h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return h;
+  }
+
+  std::string_view store(std::string_view text) {
+    if (text.empty()) {
+      return {};
+    }
+    if (static_cast<std::size_t>(chunk_end - chunk_pos) < text.size()) {
+      const auto size = std::max(chunk_size, text.size());
+      chunks.push_back(std::make_unique<char[]>(size));
+      chunk_pos = chunks.back().get();
+      chunk_end = chunk_pos + size;
+    }
+    std::memcpy(chunk_pos, text.data(), text.size());
+    const std::string_view stored{chunk_pos, text.size()};
+    chunk_pos += text.size();
+    return stored;
+  }
+
+  void grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot{0, 0});
+    const std::size_t mask = slots.size() - 1;
+    for (const auto &slot : old) {
+      if (slot.id == 0) {
+        continue;
+      }
+      std::size_t i = slot.hash & mask;
+      while (slots[i].id != 0) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = slot;
+    }
+  }
+
+public:
+  Interner() : slots(initial_slots, Slot{0, 0}) { names.emplace_back(); }
+
+  Interner(const Interner &) = delete;
+  Interner &operator=(const Interner &) = delete;
+
+  // Id of `text`, assigning the next free one on first sight
+  Ident intern(std::string_view text) {
+    const uint32_t h = hash(text);
+    const std::size_t mask = slots.size() - 1;
+    std::size_t i = h & mask;
+    while (slots[i].id != 0) {
+      if (slots[i].hash == h && names[slots[i].id] == text) {
+        return Ident{slots[i].id};
+      }
+      i = (i + 1) & mask;
+    }
+
+    const auto id = static_cast<uint32_t>(names.size());
+    names.push_back(store(text));
+    slots[i] = Slot{h, id};
+    // Keep the load factor at or below 1/2
+    if (names.size() * 2 > slots.size()) {
+      grow();
+    }
+    return Ident{id};
+  }
+
+  [[nodiscard]] std::string_view name(Ident ident) const {
+    return names[ident.get_id()];
+  }
+
+  // Number of distinct identifiers, ids are always below this
+  [[nodiscard]] std::size_t size() const { return names.size(); }
+
+  // The interner shared by the lexer, parser and symbol tables
+  static Interner &global() {
+    static Interner interner;
+    return interner;
+  }
+};
+
+inline Ident intern(std::string_view text) {
+  return Interner::global().intern(text);
+}
+
+inline std::string_view name(Ident ident) {
+  return Interner::global().name(ident);
+}
+
+} // namespace ident
+
+template <> struct std::hash<ident::Ident> {
+  std::size_t operator()(ident::Ident ident) const noexcept {
+    return ident.get_id();
+  }
+};
+
+#endif // !DEFS_IDENT_H
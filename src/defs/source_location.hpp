@@ -1,22 +1,22 @@
 #ifndef DEFS_SOURCE_LOCATION_H
 #define DEFS_SOURCE_LOCATION_H
 
-#include <string_view>
-#include <tuple>
+#include <cstdint>
+
+// Half-open byte range [begin, end) in the file registered under file_id.
+// Line and column are not stored, SourceManager resolves them on demand.
+// file_id 0 marks a node without a location.
 struct SourceLocation {
-  std::string_view file_name;
-  std::tuple<int, int> begin;
-  std::tuple<int, int> end;
-  SourceLocation(std::string_view file_name = "",
-                 std::tuple<int, int> begin = {0, 0},
-                 std::tuple<int, int> end = {0, 0})
-      : file_name(file_name), begin(begin), end(end) {}
+  uint32_t file_id;
+  uint32_t begin;
+  uint32_t end;
+  constexpr SourceLocation(uint32_t file_id = 0, uint32_t begin = 0,
+                           uint32_t end = 0)
+      : file_id(file_id), begin(begin), end(end) {}
 
 public:
-  [[nodiscard]] int start_line() const { return std::get<0>(begin); }
-  [[nodiscard]] int end_line() const { return std::get<0>(end); }
-  [[nodiscard]] int start_col() const { return std::get<1>(begin); }
-  [[nodiscard]] int end_col() const { return std::get<1>(end); }
+  [[nodiscard]] constexpr bool is_valid() const { return file_id != 0; }
+  [[nodiscard]] constexpr uint32_t length() const { return end - begin; }
 };
 
 #endif // !DEFS_SOURCE_LOCATION_H
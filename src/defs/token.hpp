@@ -1,13 +1,17 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include "ident.hpp"
+#include "source_location.hpp"
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <format>
+#include <initializer_list>
 #include <string>
 #include <string_view>
-#include <tuple>
-#include <unordered_map>
-#include <unordered_set>
 
 namespace token {
 
@@ -104,7 +108,12 @@ enum class TokenKind {
   Unsupported = -1
 };
 
-const std::unordered_map<std::string_view, TokenKind> keyword_table = {
+struct Keyword {
+  std::string_view text;
+  TokenKind kind;
+};
+
+inline constexpr std::array<Keyword, 19> keyword_table = {{
     {"return", TokenKind::Return},
     {"if", TokenKind::If},
     {"else", TokenKind::Else},
@@ -123,38 +132,89 @@ const std::unordered_map<std::string_view, TokenKind> keyword_table = {
     {"bool", TokenKind::Bool},
     {"string", TokenKind::String},
     {"char", TokenKind::Char},
-    {"void", TokenKind::Void}
-};
+    {"void", TokenKind::Void},
+}};
 
-const std::unordered_set<token::TokenKind> binary_ops = {
-    token::TokenKind::Plus,
-    token::TokenKind::Minus,
-    token::TokenKind::Asterisk,
-    token::TokenKind::Slash,
-    token::TokenKind::Percent,
-    token::TokenKind::LAngleAngle,
-    token::TokenKind::RAngleAngle,
-    token::TokenKind::LAngleBracket,
-    token::TokenKind::RAngleBracket,
-    token::TokenKind::LessEqual,
-    token::TokenKind::GreaterEqual,
-    token::TokenKind::EqualEqual,
-    token::TokenKind::BangEqual,
-    token::TokenKind::And,
-    token::TokenKind::PipePipe,
-    token::TokenKind::AndAnd,
-    token::TokenKind::Pipe,
-    token::TokenKind::Caret
-};
+namespace detail {
+
+// Perfect hash over (length, first char, last char) of the keywords above.
+// The coefficients were picked so that every keyword gets its own slot, the
+// static_assert below catches collisions when keywords are added.
+inline constexpr std::size_t keyword_slot_count = 32;
+
+constexpr std::size_t keyword_hash(std::string_view text) {
+  return (text.size() * 2 + static_cast<unsigned char>(text.front()) * 13 +
+          static_cast<unsigned char>(text.back()) * 12) &
+         (keyword_slot_count - 1);
+}
+
+inline constexpr std::size_t keyword_max_length = [] {
+  std::size_t max = 0;
+  for (const auto &keyword : keyword_table)
+    max = std::max(max, keyword.text.size());
+  return max;
+}();
+
+// Slot -> index into keyword_table, -1 for empty slots
+inline constexpr std::array<int8_t, keyword_slot_count> keyword_slots = [] {
+  std::array<int8_t, keyword_slot_count> slots{};
+  slots.fill(-1);
+  for (std::size_t i = 0; i < keyword_table.size(); ++i)
+    slots[keyword_hash(keyword_table[i].text)] = static_cast<int8_t>(i);
+  return slots;
+}();
+
+static_assert(
+    [] {
+      for (std::size_t i = 0; i < keyword_table.size(); ++i)
+        if (keyword_slots[keyword_hash(keyword_table[i].text)] !=
+            static_cast<int8_t>(i))
+          return false;
+      return true;
+    }(),
+    "keyword_hash has collisions, pick new coefficients");
 
-const std::unordered_set<token::TokenKind> unary_ops = {
-    token::TokenKind::Bang,
-    token::TokenKind::Minus,
-    token::TokenKind::Tilde,
-    token::TokenKind::Asterisk
+} // namespace detail
+
+// Keyword kind for ident, TokenKind::Identifier if it is not a keyword
+constexpr TokenKind lookup_keyword(std::string_view ident) {
+  if (ident.size() < 2 || ident.size() > detail::keyword_max_length)
+    return TokenKind::Identifier;
+  const int8_t slot = detail::keyword_slots[detail::keyword_hash(ident)];
+  if (slot < 0 || keyword_table[slot].text != ident)
+    return TokenKind::Identifier;
+  return keyword_table[slot].kind;
+}
+
+// Number of valid TokenKinds, Unsupported excluded
+inline constexpr std::size_t token_kind_count =
+    static_cast<std::size_t>(TokenKind::Void) + 1;
+
+// Fixed size bit set over TokenKind, replaces hashing on every parser step
+class TokenKindSet {
+private:
+  static constexpr std::size_t capacity = 128;
+  std::array<uint64_t, capacity / 64> bits{};
+
+public:
+  constexpr TokenKindSet(std::initializer_list<TokenKind> kinds) {
+    for (const auto kind : kinds) {
+      const auto index = static_cast<std::size_t>(kind);
+      bits[index / 64] |= uint64_t{1} << (index % 64);
+    }
+  }
+
+  [[nodiscard]] constexpr bool contains(TokenKind kind) const {
+    const auto index = static_cast<std::size_t>(static_cast<int>(kind));
+    // Unsupported (-1) wraps around and lands out of range
+    return index < capacity && (bits[index / 64] >> (index % 64)) & 1;
+  }
+
+  static_assert(token_kind_count <= capacity,
+                "TokenKindSet is too small for TokenKind");
 };
 
-const std::unordered_set<token::TokenKind> assignment_ops = {
+inline constexpr TokenKindSet assignment_ops = {
     token::TokenKind::PlusEquals,
     token::TokenKind::MinusEquals,
     token::TokenKind::AsteriskEquals,
@@ -168,16 +228,12 @@ const std::unordered_set<token::TokenKind> assignment_ops = {
     token::TokenKind::PipeEquals,
 };
 
-const std::unordered_set<token::TokenKind> post_ops = {
+inline constexpr TokenKindSet post_ops = {
     token::TokenKind::PlusPlus,
     token::TokenKind::MinusMinus
 };
 
-struct Span {
-  std::string_view source_file;
-  std::tuple<int, int> start;
-  std::tuple<int, int> end;
-};
+using Span = SourceLocation;
 
 inline std::string token_kind_to_string(TokenKind kind) {
   switch (kind) {
@@ -337,12 +393,13 @@ public:
   Span span;
 
   bool invalid = false;
+  // Interned name, only set for Identifier tokens
+  ident::Ident ident{};
 
   explicit operator std::string() const {
-    return std::format("{} \'{}\' <ll. {}:{} - {}:{}> ",
-                       token_kind_to_string(kind), text,
-                       std::get<0>(span.start), std::get<1>(span.start),
-                       std::get<0>(span.end), std::get<1>(span.end));
+    return std::format("{} \'{}\' <bytes {} - {}> ",
+                       token_kind_to_string(kind), text, span.begin,
+                       span.end);
   }
 };
 
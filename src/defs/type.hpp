@@ -1,24 +1,61 @@
 #ifndef DEFS_TYPE_H
 #define DEFS_TYPE_H
 
+#include "ast.hpp"
+#include "flat_ast.hpp"
+#include "ident.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <stdexcept>
 #include <string>
-#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
-#include "ast.hpp"
 
 namespace type {
 
+// Dense id of a type in its TypeContext, 0 is reserved for "no type"
+class TypeId {
+private:
+  uint32_t id = 0;
+
+public:
+  constexpr TypeId() = default;
+  constexpr explicit TypeId(uint32_t id) : id(id) {}
+
+  [[nodiscard]] constexpr uint32_t get_id() const { return id; }
+  [[nodiscard]] constexpr bool is_valid() const { return id != 0; }
+
+  constexpr auto operator<=>(const TypeId &) const = default;
+};
+
+// Types are created by a TypeContext only, which hands out each distinct type
+// exactly once. Two types are equal iff they are the same object.
 class Type {
 public:
   enum class Kind { Builtin, Pointer, Array, Struct, Named, Function };
-  constexpr explicit Type(Kind kind) : kind(kind) {}
+
+private:
   Kind kind;
+  TypeId id;
+
+  friend class TypeContext;
+
+protected:
+  explicit Type(Kind kind) : kind(kind) {}
+
+public:
+  Type(const Type &) = delete;
+  Type &operator=(const Type &) = delete;
   virtual ~Type() = default;
-  [[nodiscard]] virtual bool equals(const Type &other) const = 0;
+
+  [[nodiscard]] Kind get_kind() const { return kind; }
+  [[nodiscard]] TypeId get_id() const { return id; }
+  [[nodiscard]] bool equals(const Type &other) const { return this == &other; }
 };
 
 class BuiltinType : public Type {
@@ -26,172 +63,269 @@ public:
   enum class BuiltinKind { Int, Char, String, Bool, Void };
 
 private:
-  BuiltinKind builtinKind;
+  BuiltinKind builtin_kind;
 
 public:
-  constexpr explicit BuiltinType(BuiltinKind k)
-      : Type(Kind::Builtin), builtinKind(k) {}
-  [[nodiscard]] BuiltinKind get_kind() const { return builtinKind; }
-  [[nodiscard]] bool equals(const Type &other) const override {
-    return other.kind == Kind::Builtin &&
-           builtinKind == dynamic_cast<const BuiltinType &>(other).builtinKind;
-  }
+  explicit BuiltinType(BuiltinKind kind)
+      : Type(Kind::Builtin), builtin_kind(kind) {}
+  [[nodiscard]] BuiltinKind get_builtin_kind() const { return builtin_kind; }
 };
 
-constexpr BuiltinType INT_T{BuiltinType::BuiltinKind::Int};
-constexpr BuiltinType BOOL_T{BuiltinType::BuiltinKind::Bool};
-constexpr BuiltinType CHAR_T{BuiltinType::BuiltinKind::Char};
-constexpr BuiltinType STRING_T{BuiltinType::BuiltinKind::String};
-constexpr BuiltinType VOID_T{BuiltinType::BuiltinKind::Void};
-
 class PointerType : public Type {
-public:
+private:
   const Type *to;
 
+public:
   explicit PointerType(const Type *to) : Type(Kind::Pointer), to(to) {}
-
-  [[nodiscard]] bool equals(const Type &other) const override {
-    return other.kind == Kind::Pointer &&
-           to->equals(*dynamic_cast<const PointerType &>(other).to);
-  }
+  [[nodiscard]] const Type *get_pointee() const { return to; }
 };
 
 class ArrayType : public Type {
-public:
-  const Type *elementType;
-  size_t length = 0;
-
-  explicit ArrayType(const Type *elem) : Type(Kind::Array), elementType(elem) {}
+private:
+  const Type *element;
 
-  [[nodiscard]] bool equals(const Type &other) const override {
-    return other.kind == Kind::Array &&
-           elementType->equals(
-               *dynamic_cast<const ArrayType &>(other).elementType);
-  }
-  void set_len(size_t len) { length = len; }
-  [[nodiscard]] size_t get_len() const { return length; }
+public:
+  explicit ArrayType(const Type *element)
+      : Type(Kind::Array), element(element) {}
+  [[nodiscard]] const Type *get_element() const { return element; }
 };
 
+// Nominal, one per struct name. The fields are filled in when the
+// definition is seen, until then the struct is incomplete.
 class StructType : public Type {
 public:
-  std::vector<std::pair<std::string, const Type *>> fields;
-  std::string name;
+  using Field = std::pair<ident::Ident, const Type *>;
 
-  explicit StructType(std::string name)
-      : Type(Kind::Struct), name(std::move(name)) {}
+private:
+  ident::Ident name;
+  std::vector<Field> fields;
+  bool defined = false;
 
-  void set_fields(std::vector<std::pair<std::string, const Type *>> f) {
-    fields = std::move(f);
-  }
+  friend class TypeContext;
 
-  [[nodiscard]] bool equals(const Type &other) const override {
-    return other.kind == Kind::Struct &&
-           name == dynamic_cast<const StructType &>(other).name;
-  }
+public:
+  explicit StructType(ident::Ident name) : Type(Kind::Struct), name(name) {}
+  [[nodiscard]] ident::Ident get_ident() const { return name; }
+  [[nodiscard]] const std::vector<Field> &get_fields() const { return fields; }
+  [[nodiscard]] bool is_defined() const { return defined; }
 };
 
+// Typedef name that had no definition yet when it was used. Defined
+// typedefs resolve to their target directly, so they never show up here.
 class NamedType : public Type {
+private:
+  ident::Ident name;
+
+public:
+  explicit NamedType(ident::Ident name) : Type(Kind::Named), name(name) {}
+  [[nodiscard]] ident::Ident get_ident() const { return name; }
+};
+
+class FunctionType : public Type {
+private:
+  const Type *return_type;
+  std::vector<const Type *> params;
+
 public:
-  std::string name;
-  Type *type{};
+  FunctionType(const Type *return_type, std::vector<const Type *> params)
+      : Type(Kind::Function), return_type(return_type),
+        params(std::move(params)) {}
+  [[nodiscard]] const Type *get_return_type() const { return return_type; }
+  [[nodiscard]] const std::vector<const Type *> &get_params() const {
+    return params;
+  }
+};
+
+// Hash-conses all types of a program: builtins, pointers, arrays, structs
+// and function signatures exist exactly once and are compared by address
+// (or TypeId). Typedefs are resolved while types are built, so `foo*` and
+// `int*` are the same type after `typedef int foo;`.
+//
+// All members lock, so the function bodies can be checked in parallel
+// against one context. Types never move once created.
+class TypeContext {
+private:
+  // Structural key of a non-function type, operands are TypeIds or ident ids
+  struct Key {
+    Type::Kind kind;
+    uint32_t operand;
+
+    bool operator==(const Key &) const = default;
+  };
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const noexcept {
+      return (static_cast<std::size_t>(key.kind) << 32) ^ key.operand;
+    }
+  };
 
-  explicit NamedType(std::string name)
-      : Type(Kind::Named), name(std::move(name)) {}
+  std::vector<std::unique_ptr<Type>> types; // indexed by TypeId, [0] empty
+  std::unordered_map<Key, Type *, KeyHash> interned;
+  // Function types bucketed by the hash of their signature
+  std::unordered_multimap<std::size_t, const FunctionType *> functions;
+  std::unordered_map<ident::Ident, const Type *> typedefs;
+  mutable std::mutex mutex;
 
-  void set_type(Type *t) {
-    type = t;
+  template <typename T, typename... Args> T *add(Args &&...args) {
+    auto type = std::make_unique<T>(std::forward<Args>(args)...);
+    auto *raw = type.get();
+    raw->id = TypeId{static_cast<uint32_t>(types.size())};
+    types.push_back(std::move(type));
+    return raw;
   }
-  [[nodiscard]] bool equals(const Type &other) const override {
-    return other.kind == Kind::Named &&
-           name == dynamic_cast<const NamedType &>(other).name;
+
+  template <typename T, typename... Args> T *intern(Key key, Args &&...args) {
+    std::lock_guard lock{mutex};
+    if (const auto it = interned.find(key); it != interned.end()) {
+      return static_cast<T *>(it->second);
+    }
+    T *type = add<T>(std::forward<Args>(args)...);
+    interned.emplace(key, type);
+    return type;
   }
-};
 
-class FunctionType : public Type {
 public:
-  std::string name;
-  const Type *returnType;
-  std::vector<const Type *> paramTypes;
+  TypeContext() {
+    types.emplace_back();
+    for (const auto kind :
+         {BuiltinType::BuiltinKind::Int, BuiltinType::BuiltinKind::Char,
+          BuiltinType::BuiltinKind::String, BuiltinType::BuiltinKind::Bool,
+          BuiltinType::BuiltinKind::Void}) {
+      intern<BuiltinType>({Type::Kind::Builtin, static_cast<uint32_t>(kind)},
+                          kind);
+    }
+  }
 
-  FunctionType(std::string name, const Type *returnType,
-               std::vector<const Type *> paramTypes)
-      : Type(Kind::Function), name(std::move(name)), returnType(returnType),
-        paramTypes(std::move(paramTypes)) {}
+  TypeContext(const TypeContext &) = delete;
+  TypeContext &operator=(const TypeContext &) = delete;
 
-  [[nodiscard]] bool equals(const Type &other) const override {
-    if (other.kind != Kind::Function)
-      return false;
-    return name == dynamic_cast<const FunctionType &>(other).name;
+  [[nodiscard]] const Type *get(TypeId id) const {
+    std::lock_guard lock{mutex};
+    return types[id.get_id()].get();
+  }
+  // Number of distinct types plus one, all ids are below this
+  [[nodiscard]] std::size_t size() const {
+    std::lock_guard lock{mutex};
+    return types.size();
+  }
+
+  [[nodiscard]] const BuiltinType *builtin(BuiltinType::BuiltinKind kind) {
+    return intern<BuiltinType>(
+        {Type::Kind::Builtin, static_cast<uint32_t>(kind)}, kind);
+  }
+
+  const PointerType *pointer_to(const Type *to) {
+    return intern<PointerType>({Type::Kind::Pointer, to->get_id().get_id()},
+                               to);
+  }
+
+  const ArrayType *array_of(const Type *element) {
+    return intern<ArrayType>({Type::Kind::Array, element->get_id().get_id()},
+                             element);
+  }
+
+  const StructType *struct_type(ident::Ident name) {
+    return intern<StructType>({Type::Kind::Struct, name.get_id()}, name);
+  }
+
+  void define_struct(ident::Ident name, std::vector<StructType::Field> fields) {
+    auto *type =
+        intern<StructType>({Type::Kind::Struct, name.get_id()}, name);
+    std::lock_guard lock{mutex};
+    type->fields = std::move(fields);
+    type->defined = true;
+  }
+
+  // Target of a defined typedef, otherwise the NamedType placeholder
+  const Type *named(ident::Ident name) {
+    {
+      std::lock_guard lock{mutex};
+      if (const auto it = typedefs.find(name); it != typedefs.end()) {
+        return it->second;
+      }
+    }
+    return intern<NamedType>({Type::Kind::Named, name.get_id()}, name);
   }
-};
 
-static std::shared_ptr<Type> from_type(const TypeAnnotation *annotation) {
-  if (auto builtin = dynamic_cast<const BuiltinTypeAnnotation *>(annotation)) {
-    return from_type(builtin);
-  } else if (auto struct_ =
-                 dynamic_cast<const StructTypeAnnotation *>(annotation)) {
-    return from_type(struct_);
-  } else if (auto named =
-                 dynamic_cast<const NamedTypeAnnotation *>(annotation)) {
-    return from_type(named);
-  } else if (auto pointer =
-                 dynamic_cast<const PointerTypeAnnotation *>(annotation)) {
-    return from_type(pointer);
-  } else if (auto array =
-                 dynamic_cast<const ArrayTypeAnnotation *>(annotation)) {
-    return from_type(array);
-  } else {
+  // Fails if `name` already names a type
+  bool define_typedef(ident::Ident name, const Type *type) {
+    std::lock_guard lock{mutex};
+    return typedefs.emplace(name, type).second;
+  }
+
+  const FunctionType *function(const Type *return_type,
+                               std::span<const Type *const> params) {
+    std::size_t hash = return_type->get_id().get_id();
+    for (const auto *param : params) {
+      hash = hash * 31 + param->get_id().get_id();
+    }
+    std::lock_guard lock{mutex};
+    const auto [first, last] = functions.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+      const auto *candidate = it->second;
+      if (candidate->get_return_type() == return_type &&
+          std::ranges::equal(candidate->get_params(), params)) {
+        return candidate;
+      }
+    }
+    const auto *type = add<FunctionType>(
+        return_type, std::vector<const Type *>(params.begin(), params.end()));
+    functions.emplace(hash, type);
+    return type;
+  }
+
+  // Type of a type annotation node of a flat tree
+  const Type *from_annotation(const flat::FlatAST &ast,
+                              flat::NodeRef annotation) {
+    const auto &node = ast.get(annotation);
+    switch (annotation.kind()) {
+    case flat::NodeKind::BuiltinType:
+      return from_builtin(static_cast<Builtin>(node.op));
+    case flat::NodeKind::StructType:
+      return struct_type(ident::Ident{node.name});
+    case flat::NodeKind::NamedType:
+      return named(ident::Ident{node.name});
+    case flat::NodeKind::PointerType:
+      return pointer_to(from_annotation(ast, node.child(0)));
+    case flat::NodeKind::ArrayType:
+      return array_of(from_annotation(ast, node.child(0)));
+    default:
+      break;
+    }
     throw std::runtime_error("Unknown type annotation");
   }
-}
-static std::shared_ptr<BuiltinType>
-from_type(const BuiltinTypeAnnotation *type_annotation) {
-  switch (type_annotation->get_type()) {
-  case Builtin::Int:
-    return std::make_shared<BuiltinType>(INT_T);
-  case Builtin::Bool:
-    return std::make_shared<BuiltinType>(BOOL_T);
-  case Builtin::String:
-    return std::make_shared<BuiltinType>(STRING_T);
-  case Builtin::Char:
-    return std::make_shared<BuiltinType>(CHAR_T);
-  case Builtin::Void:
-    return std::make_shared<BuiltinType>(VOID_T);
-  case Builtin::Unknown:
-    throw std::runtime_error("gg");
-  }
-}
-static std::shared_ptr<StructType>
-from_type(const StructTypeAnnotation *type_annotation) {
-  return std::make_shared<StructType>(
-      StructType{type_annotation->get_name().data()});
-}
-static std::shared_ptr<NamedType>
-from_type(const NamedTypeAnnotation *type_annotation) {
-  return std::make_shared<NamedType>(
-      NamedType{type_annotation->get_name().data()});
-}
-static std::shared_ptr<ArrayType>
-from_type(const ArrayTypeAnnotation *type_annotation) {
-  return std::make_shared<ArrayType>(
-      ArrayType{from_type(type_annotation->get_type()).get()});
-}
-static std::shared_ptr<PointerType>
-from_type(const PointerTypeAnnotation *type_annotation) {
-  return std::make_shared<PointerType>(
-      PointerType{from_type(type_annotation->get_type()).get()});
-}
-static std::shared_ptr<FunctionType>
-from_type(const FunctionDeclaration *func_decl) {
-  std::vector<const Type *> params{};
-  for (const auto &item : func_decl->get_parameter_declarations()) {
-    params.push_back(from_type(item->get_type()).get());
-  }
-  return std::make_shared<FunctionType>(
-      FunctionType{func_decl->get_name().data(),
-                   from_type(func_decl->get_return_type()).get(), params});
-}
+
+  // Signature of a function declaration node of a flat tree
+  const FunctionType *from_declaration(const flat::FlatAST &ast,
+                                       flat::NodeRef decl) {
+    const auto &node = ast.get(decl);
+    const auto parameters = ast.list(node, 1);
+    std::vector<const Type *> params{};
+    params.reserve(parameters.size());
+    for (const auto param : parameters) {
+      params.push_back(from_annotation(ast, ast.get(param).child(0)));
+    }
+    return function(from_annotation(ast, node.child(0)), params);
+  }
+
+  const BuiltinType *from_builtin(Builtin builtin) {
+    switch (builtin) {
+    case Builtin::Int:
+      return this->builtin(BuiltinType::BuiltinKind::Int);
+    case Builtin::Bool:
+      return this->builtin(BuiltinType::BuiltinKind::Bool);
+    case Builtin::String:
+      return this->builtin(BuiltinType::BuiltinKind::String);
+    case Builtin::Char:
+      return this->builtin(BuiltinType::BuiltinKind::Char);
+    case Builtin::Void:
+      return this->builtin(BuiltinType::BuiltinKind::Void);
+    case Builtin::Unknown:
+      break;
+    }
+    throw std::runtime_error("Unknown builtin type");
+  }
+};
 
 } // namespace type
 
-#endif // DEFS_TYPE_H
\ No newline at end of file
+#endif // DEFS_TYPE_H
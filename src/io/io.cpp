@@ -1,20 +1,104 @@
 #include "io.hpp"
-#include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
 #include <stdexcept>
+#include <utility>
 
-io::SourceFile io::read_file(const std::string &path) {
-  std::ifstream file(path);
+#if defined(__unix__) || defined(__APPLE__)
+#define IO_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void io::SourceFile::unmap() noexcept {
+#ifdef IO_HAS_MMAP
+  if (mode == Mode::Mapped && mapping) {
+    munmap(const_cast<char *>(mapping), mapping_size);
+  }
+#endif
+  mapping = nullptr;
+  mapping_size = 0;
+}
+
+io::SourceFile::SourceFile(SourceFile &&other) noexcept
+    : name(std::move(other.name)), mode(other.mode),
+      buffer(std::move(other.buffer)),
+      mapping(std::exchange(other.mapping, nullptr)),
+      mapping_size(std::exchange(other.mapping_size, 0)) {}
+
+io::SourceFile &io::SourceFile::operator=(SourceFile &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    name = std::move(other.name);
+    mode = other.mode;
+    buffer = std::move(other.buffer);
+    mapping = std::exchange(other.mapping, nullptr);
+    mapping_size = std::exchange(other.mapping_size, 0);
+  }
+  return *this;
+}
+
+namespace {
+
+io::SourceFile read_buffered(const std::string &path) {
+  if (path == "-") {
+    std::string content{std::istreambuf_iterator<char>(std::cin),
+                        std::istreambuf_iterator<char>()};
+    return io::SourceFile{path, std::move(content)};
+  }
+
+  std::ifstream file(path, std::ios::binary);
   if (!file.is_open()) {
     throw std::runtime_error("Failed to open file: " + path);
   }
 
-  // Read the file content into a string without assuming its size
-  std::stringstream buffer;
-  buffer << file.rdbuf();
+  // Pipes and character devices have no usable size, read until EOF
+  std::string content{std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>()};
+  return io::SourceFile{path, std::move(content)};
+}
 
-  return io::SourceFile{path, buffer.str()};
+#ifdef IO_HAS_MMAP
+std::optional<io::SourceFile> try_map(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: " + path);
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+    close(fd);
+    return std::nullopt;
+  }
+
+  const auto size = static_cast<std::size_t>(info.st_size);
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (data == MAP_FAILED) {
+    return std::nullopt;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  return io::SourceFile{path, static_cast<const char *>(data), size};
+}
+#endif
+
+} // namespace
+
+io::SourceFile io::read_file(const std::string &path) {
+#ifdef IO_HAS_MMAP
+  if (path != "-") {
+    if (auto mapped = try_map(path)) {
+      return std::move(*mapped);
+    }
+  }
+#endif
+  return read_buffered(path);
 }
 
 bool io::write_file(const std::string &path, const std::string &content) {
@@ -1,14 +1,59 @@
 #ifndef IO_H
 #define IO_H
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 
 namespace io {
-struct SourceFile {
+
+// Source text of one input file. Regular files are memory-mapped and handed
+// out as a view over the mapped pages, everything else (pipes, stdin, empty
+// files, platforms without mmap) falls back to a single buffered read.
+class SourceFile {
+public:
+  enum class Mode { Mapped, Buffered };
+
+private:
   std::string name;
-  std::string content;
+  Mode mode;
+  // On the heap so the content does not move with the SourceFile, short
+  // strings would otherwise live inside of it
+  std::unique_ptr<const std::string> buffer{};
+  const char *mapping = nullptr;
+  std::size_t mapping_size = 0;
+
+  void unmap() noexcept;
+
+public:
+  SourceFile(std::string name, std::string buffer)
+      : name(std::move(name)), mode(Mode::Buffered),
+        buffer(std::make_unique<const std::string>(std::move(buffer))) {}
+  SourceFile(std::string name, const char *mapping, std::size_t size)
+      : name(std::move(name)), mode(Mode::Mapped), mapping(mapping),
+        mapping_size(size) {}
+  ~SourceFile() { unmap(); }
+
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+  SourceFile(SourceFile &&other) noexcept;
+  SourceFile &operator=(SourceFile &&other) noexcept;
+
+  [[nodiscard]] const std::string &get_name() const { return name; }
+  [[nodiscard]] Mode get_mode() const { return mode; }
+
+  // Stays valid for the lifetime of this SourceFile (also across moves).
+  [[nodiscard]] std::string_view get_content() const {
+    if (mode == Mode::Mapped) {
+      return {mapping, mapping_size};
+    }
+    return buffer ? std::string_view{*buffer} : std::string_view{};
+  }
 };
 
+// Reads the given path, "-" reads from stdin.
 SourceFile read_file(const std::string &path);
 bool write_file(const std::string &path, const std::string &content);
 
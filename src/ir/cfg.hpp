@@ -2,23 +2,38 @@
 #define COMPILER_CFG_H
 
 #include "ir.hpp"
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <queue>
+#include <span>
 #include <set>
+#include <utility>
 #include <vector>
 
 struct BasicBlock {
 private:
   std::size_t block_id;
-  std::vector<IRInstruction> instructions{};
+  std::pmr::vector<IRInstruction> instructions;
+  // Operands of instructions with more than fit inline
+  std::pmr::vector<Operand> overflow_operands;
+  // In the order PHI operands refer to them
+  std::pmr::vector<BasicBlock *> predecessors;
   std::optional<BasicBlock *> successor_true;
   std::optional<BasicBlock *> successor_false;
 
 public:
-  explicit BasicBlock(std::size_t block_id)
-      : block_id(block_id), successor_false(std::nullopt),
+  // The instructions are allocated from `resource`, e.g. the IRBuilder's arena
+  explicit BasicBlock(
+      std::size_t block_id,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : block_id(block_id), instructions(resource),
+        overflow_operands(resource), predecessors(resource),
+        successor_false(std::nullopt),
         successor_true(std::nullopt) {}
-  [[nodiscard]] const std::vector<IRInstruction> &get_instructions() const {
+  [[nodiscard]] const std::pmr::vector<IRInstruction> &
+  get_instructions() const {
     return instructions;
   }
 
@@ -29,6 +44,87 @@ public:
   void add_instruction(const IRInstruction &instruction) {
     instructions.push_back(instruction);
   }
+  // Stores the operands inline if they fit, in the overflow pool otherwise
+  void add_instruction(Opcode op, std::span<const Operand> operands,
+                       std::optional<Var> result = std::nullopt) {
+    if (operands.size() <= IRInstruction::inline_operands) {
+      IRInstruction instruction{op, {}, result};
+      for (const auto &operand : operands) {
+        instruction.append_operand(operand);
+      }
+      instructions.push_back(instruction);
+      return;
+    }
+    const auto first = static_cast<std::uint32_t>(overflow_operands.size());
+    overflow_operands.insert(overflow_operands.end(), operands.begin(),
+                             operands.end());
+    instructions.push_back(IRInstruction::with_overflow(
+        op, first, static_cast<std::uint32_t>(operands.size()), result));
+  }
+  [[nodiscard]] std::span<const Operand>
+  get_operands(const IRInstruction &instruction) const {
+    return instruction.get_operands(overflow_operands);
+  }
+  [[nodiscard]] std::span<Operand>
+  get_operands_mut(IRInstruction &instruction) {
+    return instruction.get_operands_mut(overflow_operands);
+  }
+
+  // PHIs stay grouped at the top of the block
+  void add_phi(Var result, std::span<const Operand> operands) {
+    const auto position = get_phi_count();
+    add_instruction(Opcode::PHI, operands, result);
+    std::rotate(instructions.begin() + static_cast<std::ptrdiff_t>(position),
+                instructions.end() - 1, instructions.end());
+  }
+  [[nodiscard]] std::size_t get_phi_count() const {
+    return static_cast<std::size_t>(
+        std::ranges::find_if(instructions,
+                             [](const IRInstruction &instruction) {
+                               return instruction.get_opcode() != Opcode::PHI;
+                             }) -
+        instructions.begin());
+  }
+  void remove_phis() {
+    instructions.erase(instructions.begin(),
+                       instructions.begin() +
+                           static_cast<std::ptrdiff_t>(get_phi_count()));
+  }
+  // Before the closing JMP, if there is one
+  void insert_before_terminator(const IRInstruction &instruction) {
+    if (!instructions.empty() &&
+        instructions.back().get_opcode() == Opcode::JMP) {
+      instructions.insert(instructions.end() - 1, instruction);
+    } else {
+      instructions.push_back(instruction);
+    }
+  }
+
+  void add_predecessor(BasicBlock *block) { predecessors.push_back(block); }
+  // Drops the edge from `block` together with its operand in every PHI
+  void remove_predecessor(const BasicBlock *block) {
+    const auto it = std::ranges::find(predecessors, block);
+    if (it == predecessors.end()) {
+      return;
+    }
+    const auto index = it - predecessors.begin();
+    predecessors.erase(it);
+    std::vector<std::pair<Var, std::vector<Operand>>> phis{};
+    for (std::size_t i = 0; i < get_phi_count(); ++i) {
+      const auto operands = get_operands(instructions[i]);
+      auto &[result, kept] = phis.emplace_back(
+          *instructions[i].get_result(),
+          std::vector<Operand>{operands.begin(), operands.end()});
+      kept.erase(kept.begin() + index);
+    }
+    remove_phis();
+    for (const auto &[result, operands] : phis) {
+      add_phi(result, operands);
+    }
+  }
+  [[nodiscard]] std::span<BasicBlock *const> get_predecessors() const {
+    return predecessors;
+  }
   [[nodiscard]] const std::optional<BasicBlock *> &get_successor_true() const {
     return successor_true;
   }
@@ -41,15 +137,36 @@ public:
   void set_successor_false(const std::optional<BasicBlock *> &successorFalse) {
     successor_false = successorFalse;
   }
+  // The comparison ending a block with two successors, it picks the one
+  // taken. nullptr if the block does not branch on a comparison.
+  [[nodiscard]] const IRInstruction *get_branch_condition() const {
+    if (!successor_false || instructions.empty()) {
+      return nullptr;
+    }
+    switch (instructions.back().get_opcode()) {
+    case Opcode::LT:
+    case Opcode::LE:
+    case Opcode::GT:
+    case Opcode::GE:
+    case Opcode::EQ:
+    case Opcode::NE:
+      return &instructions.back();
+    default:
+      return nullptr;
+    }
+  }
   [[nodiscard]] size_t get_id() const { return block_id; }
+  [[nodiscard]] std::span<const Operand> get_overflow_operands() const {
+    return overflow_operands;
+  }
 
   [[nodiscard]] std::string to_string() const {
     std::stringstream out{};
     out << "Block id: " << block_id << std::endl; //
     out << "Instructions: " << std::endl;         //
 
-    for (const auto &inst : instructions) {         //
-      out << "  " << inst.to_string() << std::endl; //
+    for (const auto &inst : instructions) { //
+      out << "  " << inst.to_string(overflow_operands) << std::endl;
     }
 
     out << "Successors: " << std::endl; //
@@ -72,16 +189,22 @@ public:
 
   // Getter for non-const access to instructions if needed by other parts (e.g.
   // peephole)
-  std::vector<IRInstruction> &get_instructions() { //
-    return instructions;                           //
+  std::pmr::vector<IRInstruction> &get_instructions() { //
+    return instructions;                                //
   }
 };
 
+class CFGAnalysis;
+
 struct CFG {
   BasicBlock *entry_block;
   std::vector<BasicBlock *> exit_blocks;
   std::vector<std::vector<Var *>> live_vars;
 
+private:
+  // Shared by copies until one of them is invalidated
+  mutable std::shared_ptr<const CFGAnalysis> analysis{};
+
 public:
   explicit CFG(BasicBlock *entry_block) : entry_block(entry_block) {}
   [[nodiscard]] std::string to_string() const {
@@ -100,6 +223,35 @@ public:
   } //
 
   [[nodiscard]] BasicBlock *get_entry_block_mut() const { return entry_block; }
+
+  // Dominators, loops etc., computed on first use (see cfg_analysis.hpp)
+  [[nodiscard]] const CFGAnalysis &get_analysis() const;
+  // Passes that add or remove blocks or edges have to call this
+  void invalidate_analysis() { analysis.reset(); }
+  // Blocks reachable from the entry, in depth first preorder
+  [[nodiscard]] std::vector<BasicBlock *> get_blocks() const {
+    std::vector<BasicBlock *> blocks{};
+    std::set<const BasicBlock *> visited{};
+    std::vector<BasicBlock *> worklist{};
+    if (entry_block) {
+      worklist.push_back(entry_block);
+    }
+    while (!worklist.empty()) {
+      auto *block = worklist.back();
+      worklist.pop_back();
+      if (!visited.insert(block).second) {
+        continue;
+      }
+      blocks.push_back(block);
+      if (block->get_successor_false()) {
+        worklist.push_back(*block->get_successor_false());
+      }
+      if (block->get_successor_true()) {
+        worklist.push_back(*block->get_successor_true());
+      }
+    }
+    return blocks;
+  }
   [[nodiscard]] std::string to_dot_graph() const {
     std::stringstream dot_graph;
     dot_graph << "digraph CFG {\n";
@@ -123,7 +275,8 @@ public:
       dot_graph << "  \"bb_" << current_bb->get_id() << "\" [label=\""; //
       dot_graph << "Block " << current_bb->get_id() << "\\n\\n";        //
       for (const auto &instr : current_bb->get_instructions()) {        //
-        std::string instr_str = instr.to_string();                      //
+        std::string instr_str =
+            instr.to_string(current_bb->get_overflow_operands()); //
         // Escape characters for DOT label string
         std::string escaped_instr_str;
         for (char c : instr_str) {
@@ -0,0 +1,249 @@
+#include "cfg_analysis.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+CFGAnalysis::CFGAnalysis(const CFG &cfg) {
+  if (cfg.get_entry_block() == nullptr) {
+    return;
+  }
+  compute_order(cfg.get_entry_block_mut());
+  compute_dominators();
+  compute_frontiers();
+  compute_loops();
+}
+
+void CFGAnalysis::compute_order(BasicBlock *entry) {
+  // Iterative DFS, a block is finished once all its successors are
+  struct Frame {
+    BasicBlock *block;
+    int next_successor;
+  };
+  std::vector<Frame> stack{{entry, 0}};
+  order.emplace(entry, 0);
+  while (!stack.empty()) {
+    auto &frame = stack.back();
+    BasicBlock *successor = nullptr;
+    while (successor == nullptr && frame.next_successor < 2) {
+      const auto &edge = frame.next_successor++ == 0
+                             ? frame.block->get_successor_true()
+                             : frame.block->get_successor_false();
+      if (edge && order.emplace(*edge, 0).second) {
+        successor = *edge;
+      }
+    }
+    if (successor) {
+      stack.push_back({successor, 0});
+    } else {
+      reverse_postorder.push_back(frame.block);
+      stack.pop_back();
+    }
+  }
+  std::ranges::reverse(reverse_postorder);
+  for (std::uint32_t i = 0; i < reverse_postorder.size(); ++i) {
+    order[reverse_postorder[i]] = i;
+  }
+}
+
+std::vector<BasicBlock *>
+CFGAnalysis::get_predecessors(const BasicBlock *block) const {
+  std::vector<BasicBlock *> predecessors{};
+  for (auto *predecessor : block->get_predecessors()) {
+    if (is_reachable(predecessor)) {
+      predecessors.push_back(predecessor);
+    }
+  }
+  return predecessors;
+}
+
+void CFGAnalysis::compute_dominators() {
+  const auto count = static_cast<std::uint32_t>(reverse_postorder.size());
+  idom.assign(count, none);
+  idom[0] = 0;
+
+  // Walks both fingers up the current tree until they meet, the one further
+  // down in reverse postorder moves
+  const auto intersect = [this](std::uint32_t a, std::uint32_t b) {
+    while (a != b) {
+      while (a > b) {
+        a = idom[a];
+      }
+      while (b > a) {
+        b = idom[b];
+      }
+    }
+    return a;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::uint32_t b = 1; b < count; ++b) {
+      std::uint32_t new_idom = none;
+      for (const auto *predecessor :
+           reverse_postorder[b]->get_predecessors()) {
+        const auto p = number(predecessor);
+        if (p == none || idom[p] == none) {
+          continue;
+        }
+        new_idom = new_idom == none ? p : intersect(p, new_idom);
+      }
+      if (idom[b] != new_idom) {
+        idom[b] = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  dominator_children.assign(count, {});
+  for (std::uint32_t b = 1; b < count; ++b) {
+    dominator_children[idom[b]].push_back(reverse_postorder[b]);
+  }
+
+  tree_enter.assign(count, 0);
+  tree_exit.assign(count, 0);
+  std::uint32_t clock = 0;
+  std::vector<std::pair<std::uint32_t, std::size_t>> stack{{0, 0}};
+  tree_enter[0] = clock++;
+  while (!stack.empty()) {
+    auto &[node, next_child] = stack.back();
+    if (next_child < dominator_children[node].size()) {
+      const auto child = number(dominator_children[node][next_child++]);
+      tree_enter[child] = clock++;
+      stack.emplace_back(child, 0);
+    } else {
+      tree_exit[node] = clock++;
+      stack.pop_back();
+    }
+  }
+}
+
+void CFGAnalysis::compute_frontiers() {
+  frontiers.assign(reverse_postorder.size(), {});
+  for (std::uint32_t b = 0; b < reverse_postorder.size(); ++b) {
+    auto *block = reverse_postorder[b];
+    const auto predecessors = get_predecessors(block);
+    if (predecessors.size() < 2) {
+      continue;
+    }
+    for (const auto *predecessor : predecessors) {
+      for (auto runner = number(predecessor); runner != idom[b];
+           runner = idom[runner]) {
+        auto &frontier = frontiers[runner];
+        if (frontier.empty() || frontier.back() != block) {
+          frontier.push_back(block);
+        }
+        if (runner == 0) {
+          break;
+        }
+      }
+    }
+  }
+}
+
+void CFGAnalysis::compute_loops() {
+  const auto count = reverse_postorder.size();
+  // Headers in reverse postorder, so outer loops come first
+  for (std::uint32_t h = 0; h < count; ++h) {
+    auto *header = reverse_postorder[h];
+    std::vector<BasicBlock *> latches{};
+    for (auto *predecessor : get_predecessors(header)) {
+      if (dominates(header, predecessor)) {
+        latches.push_back(predecessor);
+      }
+    }
+    if (latches.empty()) {
+      continue;
+    }
+    // Everything reaching a latch backwards without passing the header
+    std::vector<bool> in_loop(count, false);
+    in_loop[h] = true;
+    std::vector<BasicBlock *> blocks{header};
+    std::vector<BasicBlock *> worklist = std::move(latches);
+    while (!worklist.empty()) {
+      auto *block = worklist.back();
+      worklist.pop_back();
+      const auto n = number(block);
+      if (in_loop[n]) {
+        continue;
+      }
+      in_loop[n] = true;
+      blocks.push_back(block);
+      for (auto *predecessor : get_predecessors(block)) {
+        worklist.push_back(predecessor);
+      }
+    }
+    loops.push_back(Loop{header, std::move(blocks), std::nullopt, 1});
+  }
+
+  // The parent is the innermost earlier loop containing the header. Loops
+  // are visited outer first, so innermost_loop holds that loop.
+  loop_depth.assign(count, 0);
+  innermost_loop.assign(count, std::nullopt);
+  for (std::size_t i = 0; i < loops.size(); ++i) {
+    auto &loop = loops[i];
+    loop.parent = innermost_loop[number(loop.header)];
+    loop.depth = loop.parent ? loops[*loop.parent].depth + 1 : 1;
+    for (const auto *block : loop.blocks) {
+      const auto n = number(block);
+      ++loop_depth[n];
+      innermost_loop[n] = i;
+    }
+  }
+}
+
+BasicBlock *CFGAnalysis::get_idom(const BasicBlock *block) const {
+  const auto n = number(block);
+  if (n == none || n == 0) {
+    return nullptr;
+  }
+  return reverse_postorder[idom[n]];
+}
+
+bool CFGAnalysis::dominates(const BasicBlock *a, const BasicBlock *b) const {
+  const auto na = number(a);
+  const auto nb = number(b);
+  if (na == none || nb == none) {
+    return false;
+  }
+  return tree_enter[na] <= tree_enter[nb] && tree_exit[nb] <= tree_exit[na];
+}
+
+std::span<BasicBlock *const>
+CFGAnalysis::get_dominator_children(const BasicBlock *block) const {
+  const auto n = number(block);
+  if (n == none) {
+    return {};
+  }
+  return dominator_children[n];
+}
+
+std::span<BasicBlock *const>
+CFGAnalysis::get_dominance_frontier(const BasicBlock *block) const {
+  const auto n = number(block);
+  if (n == none) {
+    return {};
+  }
+  return frontiers[n];
+}
+
+std::size_t CFGAnalysis::get_loop_depth(const BasicBlock *block) const {
+  const auto n = number(block);
+  return n == none ? 0 : loop_depth[n];
+}
+
+const Loop *CFGAnalysis::get_innermost_loop(const BasicBlock *block) const {
+  const auto n = number(block);
+  if (n == none || !innermost_loop[n]) {
+    return nullptr;
+  }
+  return &loops[*innermost_loop[n]];
+}
+
+const CFGAnalysis &CFG::get_analysis() const {
+  if (!analysis) {
+    analysis = std::make_shared<const CFGAnalysis>(*this);
+  }
+  return *analysis;
+}
@@ -0,0 +1,90 @@
+#ifndef IR_CFG_ANALYSIS_H
+#define IR_CFG_ANALYSIS_H
+
+#include "cfg.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Natural loop of a back edge into `header`. Back edges into the same
+// header form one loop.
+struct Loop {
+  BasicBlock *header;
+  std::vector<BasicBlock *> blocks;  // header included
+  std::optional<std::size_t> parent; // index of the enclosing loop
+  std::size_t depth;                 // 1 for outermost loops
+};
+
+// Control flow facts of one function: reverse postorder, the dominator tree
+// (Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"), dominance
+// frontiers and the loop nest. Only blocks reachable from the entry are
+// numbered, the queries treat the others as outside of everything.
+//
+// Computed once from the blocks' edges, get it through CFG::get_analysis()
+// which caches it until the CFG is invalidated.
+class CFGAnalysis {
+private:
+  static constexpr std::uint32_t none = UINT32_MAX;
+
+  std::vector<BasicBlock *> reverse_postorder;
+  std::unordered_map<const BasicBlock *, std::uint32_t> order;
+  // Indexed by reverse postorder number
+  std::vector<std::uint32_t> idom;
+  std::vector<std::vector<BasicBlock *>> dominator_children;
+  std::vector<std::vector<BasicBlock *>> frontiers;
+  // Pre/post numbers in the dominator tree, a dominates b iff a's interval
+  // contains b's
+  std::vector<std::uint32_t> tree_enter;
+  std::vector<std::uint32_t> tree_exit;
+  std::vector<Loop> loops;
+  std::vector<std::uint32_t> loop_depth;
+  std::vector<std::optional<std::size_t>> innermost_loop;
+
+  void compute_order(BasicBlock *entry);
+  void compute_dominators();
+  void compute_frontiers();
+  void compute_loops();
+
+  [[nodiscard]] std::uint32_t number(const BasicBlock *block) const {
+    const auto it = order.find(block);
+    return it == order.end() ? none : it->second;
+  }
+
+public:
+  explicit CFGAnalysis(const CFG &cfg);
+
+  [[nodiscard]] std::span<BasicBlock *const> get_reverse_postorder() const {
+    return reverse_postorder;
+  }
+  [[nodiscard]] bool is_reachable(const BasicBlock *block) const {
+    return number(block) != none;
+  }
+  // Position in reverse postorder, the entry is 0
+  [[nodiscard]] std::optional<std::uint32_t>
+  get_rpo_number(const BasicBlock *block) const {
+    const auto n = number(block);
+    return n == none ? std::nullopt : std::optional{n};
+  }
+  // Predecessors reachable from the entry
+  [[nodiscard]] std::vector<BasicBlock *>
+  get_predecessors(const BasicBlock *block) const;
+
+  // nullptr for the entry and unreachable blocks
+  [[nodiscard]] BasicBlock *get_idom(const BasicBlock *block) const;
+  [[nodiscard]] bool dominates(const BasicBlock *a, const BasicBlock *b) const;
+  [[nodiscard]] std::span<BasicBlock *const>
+  get_dominator_children(const BasicBlock *block) const;
+  [[nodiscard]] std::span<BasicBlock *const>
+  get_dominance_frontier(const BasicBlock *block) const;
+
+  // Outer loops before the loops they contain
+  [[nodiscard]] const std::vector<Loop> &get_loops() const { return loops; }
+  // Number of loops containing the block, 0 outside of loops
+  [[nodiscard]] std::size_t get_loop_depth(const BasicBlock *block) const;
+  [[nodiscard]] const Loop *get_innermost_loop(const BasicBlock *block) const;
+};
+
+#endif // !IR_CFG_ANALYSIS_H
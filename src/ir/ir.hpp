@@ -2,17 +2,25 @@
 #define COMPILER_IR_H
 
 #include "../defs/ast.hpp"
+#include <array>
+#include <cstdint>
 #include <format>
+#include <initializer_list>
+#include <limits>
 #include <optional>
+#include <ranges>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
 
 // TODO: types
 struct Var {
-  std::size_t numeral;
+  std::uint32_t numeral;
 
 public:
   [[nodiscard]] std::string to_string() const {
@@ -38,7 +46,7 @@ struct Operand {
   std::variant<Var, std::uint32_t> value;
 };
 
-enum class Opcode {
+enum class Opcode : std::uint8_t {
   // Arithmetic
   ADD,
   SUB,
@@ -173,40 +181,128 @@ static std::string opcode_to_string(Opcode opcode) {
   }
 }
 
+// Fixed size and trivially copyable, so blocks store instructions by value
+// and passes rewrite them in place. Up to three operands are stored inline.
+// Longer operand lists (PHI, call arguments) live in an overflow pool owned
+// by the basic block, the inline slots then hold their range.
 class IRInstruction {
+public:
+  static constexpr std::size_t inline_operands = 3;
+
 private:
-  const Opcode opcode;
-  const std::vector<Operand> operands;
-  const std::optional<Var> result; // aka defined var
-  std::unordered_set<Var> use{};   // used vars
+  static constexpr std::uint8_t overflow_flag = 0x80;
+  static constexpr std::uint32_t no_result =
+      std::numeric_limits<std::uint32_t>::max();
+
+  Opcode opcode;
+  // Inline operand count, or overflow_flag if operands[0..1] hold the
+  // (first, count) range in the overflow pool
+  std::uint8_t operand_count = 0;
+  std::uint32_t result = no_result; // aka defined var
+  std::array<Operand, inline_operands> operands{};
+
+  IRInstruction(Opcode op, std::optional<Var> result)
+      : opcode(op), result(result ? result->numeral : no_result) {}
 
 public:
-  IRInstruction(const Opcode op, const std::vector<Operand> &ops,
+  IRInstruction(const Opcode op, std::initializer_list<Operand> ops,
                 std::optional<Var> result = std::nullopt)
-      : opcode(op), operands(ops), result(result) {
-    // set used vars
-    for (const auto &v : ops) {
-      if (const Var *s = std::get_if<Var>(&v.value)) {
-        use.insert(*s);
-      }
+      : IRInstruction(op, result) {
+    if (ops.size() > inline_operands) {
+      throw std::runtime_error(
+          "Too many operands, use IRInstruction::with_overflow");
     }
+    for (const auto &operand : ops) {
+      operands[operand_count++] = operand;
+    }
+  }
+
+  // Operands `first` to `first + count` of the block's overflow pool
+  static IRInstruction with_overflow(Opcode op, std::uint32_t first,
+                                     std::uint32_t count,
+                                     std::optional<Var> result = std::nullopt) {
+    IRInstruction instruction{op, result};
+    instruction.operand_count = overflow_flag;
+    instruction.operands[0] = Operand{first};
+    instruction.operands[1] = Operand{count};
+    return instruction;
   }
 
   [[nodiscard]] Opcode get_opcode() const { return opcode; }
-  [[nodiscard]] const std::vector<Operand> &get_operands() const {
-    return operands;
+  void set_opcode(Opcode op) { opcode = op; }
+
+  [[nodiscard]] bool has_overflow() const {
+    return operand_count == overflow_flag;
   }
-  [[nodiscard]] const std::optional<Var> &get_result() const { return result; }
-  [[nodiscard]] const std::unordered_set<Var> &get_used() const { return use; }
-  [[nodiscard]] std::string to_string() const {
-    std::string x = std::format(
-        "{} <- {}", (result.has_value() ? result.value().to_string() : "/"),
-        opcode_to_string(opcode));
-    for (const auto &item : operands) {
+
+  // `overflow` is the pool of the block holding the instruction, only read
+  // if has_overflow()
+  [[nodiscard]] std::span<const Operand>
+  get_operands(std::span<const Operand> overflow = {}) const {
+    if (has_overflow()) {
+      return overflow.subspan(std::get<std::uint32_t>(operands[0].value),
+                              std::get<std::uint32_t>(operands[1].value));
+    }
+    return std::span{operands}.first(operand_count);
+  }
+  [[nodiscard]] std::span<Operand>
+  get_operands_mut(std::span<Operand> overflow = {}) {
+    if (has_overflow()) {
+      return overflow.subspan(std::get<std::uint32_t>(operands[0].value),
+                              std::get<std::uint32_t>(operands[1].value));
+    }
+    return std::span{operands}.first(operand_count);
+  }
+  // Inline operands only
+  void append_operand(Operand operand) {
+    if (has_overflow() || operand_count == inline_operands) {
+      throw std::runtime_error("Too many operands");
+    }
+    operands[operand_count++] = operand;
+  }
+  void set_operand(std::size_t index, Operand operand) {
+    if (has_overflow() || index >= operand_count) {
+      throw std::runtime_error("Operand index out of range");
+    }
+    operands[index] = operand;
+  }
+
+  [[nodiscard]] std::optional<Var> get_result() const {
+    if (result == no_result) {
+      return std::nullopt;
+    }
+    return Var{result};
+  }
+  void set_result(std::optional<Var> var) {
+    result = var ? var->numeral : no_result;
+  }
+
+  // Used vars, computed from the operands
+  [[nodiscard]] auto
+  get_used(std::span<const Operand> overflow = {}) const {
+    return get_operands(overflow) |
+           std::views::filter([](const Operand &operand) {
+             return std::holds_alternative<Var>(operand.value);
+           }) |
+           std::views::transform([](const Operand &operand) {
+             return std::get<Var>(operand.value);
+           });
+  }
+
+  [[nodiscard]] std::string
+  to_string(std::span<const Operand> overflow = {}) const {
+    const auto defined = get_result();
+    std::string x =
+        std::format("{} <- {}", (defined ? defined->to_string() : "/"),
+                    opcode_to_string(opcode));
+    for (const auto &item : get_operands(overflow)) {
       x += std::format(" {}", std::visit(grr(), item.value));
     }
     return x;
   }
 };
 
+static_assert(std::is_trivially_copyable_v<IRInstruction>);
+static_assert(sizeof(IRInstruction) <= 32, "IRInstruction should stay small");
+
 #endif // COMPILER_IR_H
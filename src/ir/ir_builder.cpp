@@ -3,167 +3,310 @@
 #include "ir.hpp"
 #include <optional>
 
-void IRBuilder::visit(Typedef &typedef_) { ASTVisitor::visit(typedef_); }
-void IRBuilder::visit(Declaration &decl) { ASTVisitor::visit(decl); }
+void IRBuilder::seal(BasicBlock *block) {
+  if (block->get_id() >= sealed.size()) {
+    sealed.resize(block->get_id() + 1);
+  }
+  if (const auto it = incomplete_phis.find(block->get_id());
+      it != incomplete_phis.end()) {
+    const auto pending = std::move(it->second);
+    incomplete_phis.erase(it);
+    for (const auto phi : pending) {
+      add_phi_operands(phi);
+    }
+  }
+  sealed[block->get_id()] = true;
+}
+
+void IRBuilder::link(BasicBlock *from, BasicBlock *to) {
+  to->add_predecessor(from);
+}
+
+// Ends the current block with an unconditional jump
+void IRBuilder::jump(BasicBlock *to) {
+  current_block->add_instruction(IRInstruction(
+      Opcode::JMP, {Operand{static_cast<std::uint32_t>(to->get_id())}},
+      std::nullopt));
+  current_block->set_successor_true(to);
+  current_block->set_successor_false(std::nullopt);
+  link(current_block, to);
+}
+
+// The current block ends with the condition
+void IRBuilder::branch(BasicBlock *on_true, BasicBlock *on_false) {
+  current_block->set_successor_true(on_true);
+  current_block->set_successor_false(on_false);
+  link(current_block, on_true);
+  link(current_block, on_false);
+}
+
+void IRBuilder::write_variable(SymbolId symbol, BasicBlock *block, Var var) {
+  definitions[def_key(symbol, block)] = var;
+}
+
+Var IRBuilder::read_variable(SymbolId symbol, BasicBlock *block) {
+  if (const auto it = definitions.find(def_key(symbol, block));
+      it != definitions.end()) {
+    return resolve(it->second);
+  }
+  return read_variable_recursive(symbol, block);
+}
+
+Var IRBuilder::read_variable_recursive(SymbolId symbol, BasicBlock *block) {
+  const auto predecessors = block->get_predecessors();
+  Var value{};
+  if (!is_sealed(block)) {
+    // Not all predecessors known yet, the operands follow in seal()
+    const auto phi = new_phi(symbol, block);
+    incomplete_phis[block->get_id()].push_back(phi);
+    value = phis[phi].result;
+  } else if (predecessors.empty()) {
+    // The entry block, no definition reaches the read on this path
+    value = read_uninitialized();
+  } else if (predecessors.size() == 1) {
+    value = read_variable(symbol, predecessors.front());
+  } else {
+    // Defined first to break cycles through loops
+    const auto phi = new_phi(symbol, block);
+    write_variable(symbol, block, phis[phi].result);
+    value = add_phi_operands(phi);
+  }
+  write_variable(symbol, block, value);
+  return value;
+}
+
+std::size_t IRBuilder::new_phi(SymbolId symbol, BasicBlock *block) {
+  phis.push_back(Phi{block, gen_temp(), symbol, {}});
+  return phis.size() - 1;
+}
+
+Var IRBuilder::add_phi_operands(std::size_t phi) {
+  // Reading may add PHIs, so no references into `phis` are held
+  for (auto *predecessor : phis[phi].block->get_predecessors()) {
+    const auto value = read_variable(phis[phi].symbol, predecessor);
+    phis[phi].operands.push_back(value);
+  }
+  return try_remove_trivial_phi(phi);
+}
+
+// A PHI is trivial if it merges at most one value besides itself, it is then
+// replaced by that value
+Var IRBuilder::try_remove_trivial_phi(std::size_t phi) {
+  if (phis[phi].removed) {
+    return resolve(phis[phi].result);
+  }
+  const auto result = phis[phi].result;
+  std::optional<Var> same{};
+  for (const auto operand : phis[phi].operands) {
+    const auto value = resolve(operand);
+    if (value == result || (same && value == *same)) {
+      continue;
+    }
+    if (same) {
+      return result;
+    }
+    same = value;
+  }
+  if (!same) {
+    // Only merges itself, the variable is never defined
+    same = read_uninitialized();
+  }
+  phis[phi].removed = true;
+  replaced.emplace(result.numeral, *same);
+  return *same;
+}
+
+// Name analysis only checks that a variable is assigned somewhere before it
+// is read, e.g. `int x; if (c) { x = 1; } return x;` passes it. The read is
+// reported here and gets a placeholder, the IR is not used after an error.
+Var IRBuilder::read_uninitialized() {
+  diagnostics->emit_error(read_location,
+                          "Variable {} may be used before it is initialized",
+                          ident::name(read_name));
+  diagnostics->add_source_context(source_manager->get_snippet(read_location));
+  return gen_temp();
+}
+
+Var IRBuilder::resolve(Var var) const {
+  for (auto it = replaced.find(var.numeral); it != replaced.end();
+       it = replaced.find(var.numeral)) {
+    var = it->second;
+  }
+  return var;
+}
+
+void IRBuilder::finish_function() {
+  // Braun et al. recheck the users of a removed PHI, as they may have become
+  // trivial. Without use lists this repeats the check until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t phi = 0; phi < phis.size(); ++phi) {
+      if (!phis[phi].removed) {
+        try_remove_trivial_phi(phi);
+        changed |= phis[phi].removed;
+      }
+    }
+  }
+
+  for (auto *block : function_blocks) {
+    for (auto &instruction : block->get_instructions()) {
+      for (auto &operand : block->get_operands_mut(instruction)) {
+        if (const auto *var = std::get_if<Var>(&operand.value)) {
+          operand.value = resolve(*var);
+        }
+      }
+    }
+  }
+  std::vector<Operand> operands{};
+  for (const auto &phi : phis) {
+    if (phi.removed) {
+      continue;
+    }
+    operands.clear();
+    for (const auto operand : phi.operands) {
+      operands.push_back(Operand{resolve(operand)});
+    }
+    phi.block->add_phi(phi.result, operands);
+  }
+
+  function_blocks.clear();
+  definitions.clear();
+  phis.clear();
+  incomplete_phis.clear();
+  replaced.clear();
+}
+
 void IRBuilder::visit(FunctionDeclaration &decl) {
   if (decl.get_body()) {
     auto cfg = CFG{push_new_block()};
     representation.add_cfg(cfg);
-    decl.get_body()->accept(*this);
+    seal(current_block);
+    walk(decl.get_body());
+    finish_function();
   }
 }
-void IRBuilder::visit(ParameterDeclaration &decl) { ASTVisitor::visit(decl); }
-void IRBuilder::visit(StructDeclaration &decl) { ASTVisitor::visit(decl); }
-void IRBuilder::visit(Statement &stmt) { ASTVisitor::visit(stmt); }
 void IRBuilder::visit(CompoundStmt &stmt) {
   for (const auto &statement : stmt.get_statements()) {
-    statement->accept(*this);
+    walk(statement);
   }
 }
 void IRBuilder::visit(ReturnStmt &stmt) {
   if (stmt.get_expression() == nullptr) {
     current_block->add_instruction(IRInstruction{Opcode::RET, {}});
   } else {
-    stmt.get_expression()->accept(*this);
+    walk(stmt.get_expression());
     auto var = temp_var_stack.top();
     temp_var_stack.pop();
     current_block->add_instruction(IRInstruction{Opcode::RET, {Operand{var}}});
   }
 }
-void IRBuilder::visit(AssertStmt &stmt) { ASTVisitor::visit(stmt); }
 void IRBuilder::visit(VariableDeclarationStatement &stmt) {
   if (stmt.get_initializer() == nullptr)
     return;
-  stmt.get_initializer()->accept(*this);
+  walk(stmt.get_initializer());
   auto var = gen_temp();
   auto init = temp_var_stack.top();
-  symbol_to_var.emplace(stmt.get_symbol()->get_id(), init); /*/*/
+  bind(stmt.get_symbol(), init);
   temp_var_stack.pop();
 }
-void IRBuilder::visit(UnaryMutationStatement &stmt) { ASTVisitor::visit(stmt); }
 void IRBuilder::visit(AssignmentStatement &stmt) {
-  stmt.get_expr()->accept(*this);
+  walk(stmt.get_expr());
   auto from = temp_var_stack.top(); // var of expr result
   temp_var_stack.pop();
   if (stmt.get_lvalue()->get_kind() == LValue::Kind::Variable) {
-    const auto var_l_val = dynamic_cast<VariableLValue *>(stmt.get_lvalue());
+    const auto var_l_val = static_cast<VariableLValue *>(stmt.get_lvalue());
     if (stmt.get_op() == AssignmentOperator::Equals) {
-      symbol_to_var.insert_or_assign(var_l_val->get_symbol()->get_id(), from);
+      bind(var_l_val->get_symbol(), from);
     } else {
       auto op = from_assmt_op(stmt.get_op());
-      const auto var_it = symbol_to_var.find(var_l_val->get_symbol()->get_id());
-      if (var_it == symbol_to_var.end()) {
-        throw std::runtime_error("namensanalyse goes brrrrr. Variable ist "
-                                 "nicht init, wird aber verwendet...");
-      } else {
-        const auto new_var = gen_temp();
-
-        auto old_var = var_it->second;
-        current_block->add_instruction(
-            IRInstruction{op, {Operand{old_var}, Operand{from}}, new_var});
-        symbol_to_var.insert_or_assign(var_l_val->get_symbol()->get_id(),
-                                       new_var);
-      }
+      const auto old_var =
+          lookup(var_l_val->get_symbol(), var_l_val->get_ident(),
+                 var_l_val->get_location());
+      const auto new_var = gen_temp();
+
+      current_block->add_instruction(
+          IRInstruction{op, {Operand{old_var}, Operand{from}}, new_var});
+      bind(var_l_val->get_symbol(), new_var);
     }
   } else {
     throw std::runtime_error(
         "Was auch immer du gemacht hast, bei L1 geht das noch nicht.");
   }
 }
-void IRBuilder::visit(ExpressionStatement &stmt) { ASTVisitor::visit(stmt); }
 void IRBuilder::visit(IfStatement &stmt) {
-  BasicBlock *condition_eval = current_block;
-
-  auto *then_block = arena.create<BasicBlock>(block_counter++);
-  BasicBlock *else_block = nullptr; // Will be created if an else branch exists.
-  auto *merge_block = arena.create<BasicBlock>(block_counter++);
-  stmt.get_condition()->accept(*this);
-
-  const auto condition_temp = temp_var_stack.top();
+  walk(stmt.get_condition());
   temp_var_stack.pop();
 
-  condition_eval->set_successor_true(then_block);
-  if (stmt.get_else_branch()) {
-    else_block = arena.create<BasicBlock>(block_counter++);
-    condition_eval->set_successor_false(else_block);
-  } else {
-    condition_eval->set_successor_false(merge_block);
-  }
+  auto *then_block = new_block();
+  // Empty without an else branch, keeps the edge to the merge block from
+  // being critical
+  auto *else_block = new_block();
+  auto *merge_block = new_block();
+  branch(then_block, else_block);
+  seal(then_block);
+  seal(else_block);
 
   current_block = then_block;
-  stmt.get_then_branch()->accept(*this);
-
-  if (current_block) {
-    Operand merge_operand;
-
-    merge_operand.value = static_cast<std::uint32_t>(merge_block->get_id());
-    current_block->add_instruction(
-        IRInstruction(Opcode::JMP, {merge_operand}, std::nullopt));
-    current_block->set_successor_true(merge_block);
-    current_block->set_successor_false(std::nullopt);
-  }
+  walk(stmt.get_then_branch());
+  jump(merge_block);
 
+  current_block = else_block;
   if (stmt.get_else_branch()) {
-    current_block = else_block;
-    stmt.get_else_branch()->accept(*this);
-    if (current_block) {
-      Operand merge_operand;
-
-      merge_operand.value = static_cast<std::uint32_t>(merge_block->get_id());
-      current_block->add_instruction(
-          IRInstruction(Opcode::JMP, {merge_operand}, std::nullopt));
-      current_block->set_successor_true(merge_block);
-      current_block->set_successor_false(std::nullopt);
-    }
+    walk(stmt.get_else_branch());
   }
+  jump(merge_block);
 
+  seal(merge_block);
   current_block = merge_block;
 }
 void IRBuilder::visit(ForStatement &stmt) {
-  auto *condition_block = arena.create<BasicBlock>(block_counter++);
-  auto *body_block = arena.create<BasicBlock>(block_counter++);
-  auto *increment_block = stmt.get_increment()
-                              ? arena.create<BasicBlock>(block_counter++)
-                              : nullptr;
-  auto *exit_loop_block = arena.create<BasicBlock>(block_counter++);
-  current_block->set_successor_true(condition_block);
-  stmt.get_init()->accept(*this);
-
-  current_block->add_instruction(IRInstruction(
-      Opcode::JMP,
-      {Operand{static_cast<std::uint32_t>(condition_block->get_id())}},
-      std::nullopt));
+  auto *condition_block = new_block();
+  auto *body_block = new_block();
+  auto *increment_block = stmt.get_increment() ? new_block() : nullptr;
+  auto *exit_loop_block = new_block();
+  walk(stmt.get_init());
+  jump(condition_block);
 
+  // Sealed once the back edge exists
   current_block = condition_block;
-  stmt.get_condition()->accept(*this);
-  auto condition = temp_var_stack.top();
+  walk(stmt.get_condition());
   temp_var_stack.pop();
-
-  condition_block->set_successor_true(body_block);
-  condition_block->set_successor_false(exit_loop_block);
+  branch(body_block, exit_loop_block);
+  seal(body_block);
+  seal(exit_loop_block);
 
   current_block = body_block;
-  stmt.get_body()->accept(*this);
-  auto next_block = increment_block ? increment_block : condition_block;
-  current_block->add_instruction(IRInstruction(
-      Opcode::JMP, {Operand{static_cast<std::uint32_t>(next_block->get_id())}},
-      std::nullopt));
-  current_block->set_successor_true(next_block);
+  walk(stmt.get_body());
   if (increment_block) {
+    jump(increment_block);
+    seal(increment_block);
     current_block = increment_block;
-    stmt.get_increment()->accept(*this);
-
-    current_block->add_instruction(IRInstruction(
-        Opcode::JMP,
-        {Operand{static_cast<std::uint32_t>(condition_block->get_id())}},
-        std::nullopt));
-    current_block->set_successor_true(condition_block);
+    walk(stmt.get_increment());
   }
+  jump(condition_block);
+  seal(condition_block);
+  current_block = exit_loop_block;
+}
+void IRBuilder::visit(WhileStatement &stmt) {
+  auto *condition_block = new_block();
+  auto *body_block = new_block();
+  auto *exit_loop_block = new_block();
+  jump(condition_block);
+
+  current_block = condition_block;
+  walk(stmt.get_condition());
+  temp_var_stack.pop();
+  branch(body_block, exit_loop_block);
+  seal(body_block);
+  seal(exit_loop_block);
+
+  current_block = body_block;
+  walk(stmt.get_body());
+  jump(condition_block);
+  seal(condition_block);
   current_block = exit_loop_block;
 }
-void IRBuilder::visit(WhileStatement &stmt) { ASTVisitor::visit(stmt); }
-void IRBuilder::visit(ErrorStatement &stmt) { ASTVisitor::visit(stmt); }
-void IRBuilder::visit(Expression &expr) { ASTVisitor::visit(expr); }
 void IRBuilder::visit(NumericExpr &expr) {
   const auto temp = gen_temp();
   temp_var_stack.push(temp);
@@ -174,24 +317,16 @@ void IRBuilder::visit(NumericExpr &expr) {
   current_block->add_instruction(
       IRInstruction{Opcode::STORE, {Operand{num}}, temp});
 }
-void IRBuilder::visit(CallExpr &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(StringLiteralExpr &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(CharLiteralExpr &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(BoolConstExpr &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(NullExpr &expr) { ASTVisitor::visit(expr); }
 void IRBuilder::visit(VarExpr &expr) {
-  auto it = symbol_to_var.find(expr.get_symbol()->get_id());
-  if (it == symbol_to_var.end()) {
-    throw std::runtime_error("Da hat jmd Namensanalyse verkackt...");
-  }
-  temp_var_stack.push(it->second);
+  temp_var_stack.push(
+      lookup(expr.get_symbol(), expr.get_ident(), expr.get_location()));
 }
 void IRBuilder::visit(ParenthesisExpression &expr) {
-  expr.get_expression()->accept(*this);
+  walk(expr.get_expression());
 }
 void IRBuilder::visit(BinaryOperatorExpression &expr) {
-  expr.get_right_expression()->accept(*this);
-  expr.get_left_expression()->accept(*this);
+  walk(expr.get_right_expression());
+  walk(expr.get_left_expression());
   Opcode op = from_binary_op(expr.get_operator_kind());
   Var left = temp_var_stack.top();
   temp_var_stack.pop();
@@ -203,7 +338,7 @@ void IRBuilder::visit(BinaryOperatorExpression &expr) {
       IRInstruction{op, {Operand{left}, Operand{right}}, temp});
 }
 void IRBuilder::visit(UnaryOperatorExpression &expr) {
-  expr.get_expression()->accept(*this);
+  walk(expr.get_expression());
   Opcode op = from_unary_op(expr.get_operator_kind());
   Var expression = temp_var_stack.top();
   temp_var_stack.pop();
@@ -212,26 +347,8 @@ void IRBuilder::visit(UnaryOperatorExpression &expr) {
   current_block->add_instruction(
       IRInstruction{op, {Operand{expression}}, temp});
 }
-void IRBuilder::visit(ArrayAccessExpr &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(PointerAccessExpr &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(FieldAccessExpr &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(AllocExpression &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(AllocArrayExpression &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(TernaryExpression &expr) { ASTVisitor::visit(expr); }
-void IRBuilder::visit(TypeAnnotation &type) { ASTVisitor::visit(type); }
-void IRBuilder::visit(BuiltinTypeAnnotation &type) { ASTVisitor::visit(type); }
-void IRBuilder::visit(NamedTypeAnnotation &type) { ASTVisitor::visit(type); }
-void IRBuilder::visit(StructTypeAnnotation &type) { ASTVisitor::visit(type); }
-void IRBuilder::visit(PointerTypeAnnotation &type) { ASTVisitor::visit(type); }
-void IRBuilder::visit(ArrayTypeAnnotation &type) { ASTVisitor::visit(type); }
-void IRBuilder::visit(LValue &val) { ASTVisitor::visit(val); }
-void IRBuilder::visit(VariableLValue &val) { ASTVisitor::visit(val); }
-void IRBuilder::visit(ArrayAccessLValue &val) { ASTVisitor::visit(val); }
-void IRBuilder::visit(PointerAccessLValue &val) { ASTVisitor::visit(val); }
-void IRBuilder::visit(FieldAccessLValue &val) { ASTVisitor::visit(val); }
-void IRBuilder::visit(DereferenceLValue &val) { ASTVisitor::visit(val); }
 void IRBuilder::visit(TranslationUnit &unit) {
   for (const auto &decl : unit.get_declarations()) {
-    decl->accept(*this);
+    walk(decl);
   }
 }
@@ -3,22 +3,78 @@
 
 #include "../alloc/arena.hpp"
 #include "../defs/ast.hpp"
+#include "../defs/ast_walker.hpp"
 #include "../report/report_builder.hpp"
 #include "cfg.hpp"
+#include <optional>
 #include <stack>
+#include <unordered_map>
+#include <vector>
 
-class IRBuilder : public ASTVisitor {
+// Builds the IR in SSA form on the fly, after Braun et al., "Simple and
+// Efficient Construction of Static Single Assignment Form" (CC 2013).
+// Variable reads look up the definition in the current block and otherwise
+// walk the predecessors, placing PHIs at joins. A block is sealed once all
+// its predecessors are known; reads in unsealed blocks (loop headers) get an
+// incomplete PHI that is filled when the block is sealed. Trivial PHIs are
+// removed, unneeded ones are never created.
+//
+// Every if gets an else block and loops jump back from a block with a single
+// successor, so the CFG has no critical edges.
+class IRBuilder : public ASTWalker<IRBuilder> {
 private:
+  struct Phi {
+    BasicBlock *block;
+    Var result;
+    SymbolId symbol;
+    std::vector<Var> operands; // in the block's predecessor order
+    bool removed = false;
+  };
+
   IntermediateRepresentation &representation;
   BasicBlock *current_block = nullptr;
   std::shared_ptr<DiagnosticEmitter> diagnostics;
   std::shared_ptr<SourceManager> source_manager;
-  std::size_t temp_counter = 0;
+  std::uint32_t temp_counter = 0;
   std::size_t block_counter = 0;
   std::stack<Var> temp_var_stack{};
-  std::unordered_map<size_t, Var> symbol_to_var{};
+  // State of the function being built, cleared by finish_function
+  std::vector<BasicBlock *> function_blocks{};
+  // Value of a variable at the end of a block, keyed by def_key
+  std::unordered_map<std::uint64_t, Var> definitions{};
+  std::vector<bool> sealed{}; // indexed by block id
+  std::vector<Phi> phis{};
+  std::unordered_map<std::size_t, std::vector<std::size_t>> incomplete_phis{};
+  // Results of removed PHIs to the value that replaces them
+  std::unordered_map<std::uint32_t, Var> replaced{};
+  // Variable use being looked up, for diagnostics
+  ident::Ident read_name{};
+  SourceLocation read_location{};
   arena::Arena arena;
 
+  static std::uint64_t def_key(SymbolId symbol, const BasicBlock *block) {
+    return (static_cast<std::uint64_t>(block->get_id()) << 32) |
+           symbol.get_id();
+  }
+
+  [[nodiscard]] bool is_sealed(const BasicBlock *block) const {
+    return block->get_id() < sealed.size() && sealed[block->get_id()];
+  }
+  void seal(BasicBlock *block);
+  void link(BasicBlock *from, BasicBlock *to);
+  void jump(BasicBlock *to);
+  void branch(BasicBlock *on_true, BasicBlock *on_false);
+
+  void write_variable(SymbolId symbol, BasicBlock *block, Var var);
+  Var read_variable(SymbolId symbol, BasicBlock *block);
+  Var read_variable_recursive(SymbolId symbol, BasicBlock *block);
+  std::size_t new_phi(SymbolId symbol, BasicBlock *block);
+  Var add_phi_operands(std::size_t phi);
+  Var try_remove_trivial_phi(std::size_t phi);
+  Var read_uninitialized();
+  [[nodiscard]] Var resolve(Var var) const;
+  void finish_function();
+
 public:
   explicit IRBuilder(IntermediateRepresentation &representation,
                      std::shared_ptr<DiagnosticEmitter> diagnostics,
@@ -26,57 +82,46 @@ public:
       : representation(representation), diagnostics(std::move(diagnostics)),
         source_manager(std::move(source_manager)), arena(arena::Arena{}) {}
   Var gen_temp() { return Var{temp_counter++}; }
+  // Blocks and their instruction lists live in the builder's arena
+  BasicBlock *new_block() {
+    auto *block = arena.create<BasicBlock>(block_counter++, arena.resource());
+    function_blocks.push_back(block);
+    return block;
+  }
   BasicBlock *push_new_block() {
-    current_block = arena.create<BasicBlock>(block_counter++);
+    current_block = new_block();
     return current_block;
   }
-  void visit(Typedef &typedef_) override;
-  void visit(Declaration &decl) override;
-  void visit(FunctionDeclaration &decl) override;
-  void visit(ParameterDeclaration &decl) override;
-  void visit(StructDeclaration &decl) override;
-  void visit(Statement &stmt) override;
-  void visit(CompoundStmt &stmt) override;
-  void visit(ReturnStmt &stmt) override;
-  void visit(AssertStmt &stmt) override;
-  void visit(VariableDeclarationStatement &stmt) override;
-  void visit(UnaryMutationStatement &stmt) override;
-  void visit(AssignmentStatement &stmt) override;
-  void visit(ExpressionStatement &stmt) override;
-  void visit(IfStatement &stmt) override;
-  void visit(ForStatement &stmt) override;
-  void visit(WhileStatement &stmt) override;
-  void visit(ErrorStatement &stmt) override;
-  void visit(Expression &expr) override;
-  void visit(NumericExpr &expr) override;
-  void visit(CallExpr &expr) override;
-  void visit(StringLiteralExpr &expr) override;
-  void visit(CharLiteralExpr &expr) override;
-  void visit(BoolConstExpr &expr) override;
-  void visit(NullExpr &expr) override;
-  void visit(VarExpr &expr) override;
-  void visit(ParenthesisExpression &expr) override;
-  void visit(BinaryOperatorExpression &expr) override;
-  void visit(UnaryOperatorExpression &expr) override;
-  void visit(ArrayAccessExpr &expr) override;
-  void visit(PointerAccessExpr &expr) override;
-  void visit(FieldAccessExpr &expr) override;
-  void visit(AllocExpression &expr) override;
-  void visit(AllocArrayExpression &expr) override;
-  void visit(TernaryExpression &expr) override;
-  void visit(TypeAnnotation &type) override;
-  void visit(BuiltinTypeAnnotation &type) override;
-  void visit(NamedTypeAnnotation &type) override;
-  void visit(StructTypeAnnotation &type) override;
-  void visit(PointerTypeAnnotation &type) override;
-  void visit(ArrayTypeAnnotation &type) override;
-  void visit(LValue &val) override;
-  void visit(VariableLValue &val) override;
-  void visit(ArrayAccessLValue &val) override;
-  void visit(PointerAccessLValue &val) override;
-  void visit(FieldAccessLValue &val) override;
-  void visit(DereferenceLValue &val) override;
-  void visit(TranslationUnit &unit) override;
+  void bind(SymbolId symbol, Var var) {
+    if (!symbol.is_valid()) {
+      throw std::runtime_error("Binding an unresolved variable");
+    }
+    write_variable(symbol, current_block, var);
+  }
+  [[nodiscard]] Var lookup(SymbolId symbol, ident::Ident name,
+                         const SourceLocation &location) {
+    if (!symbol.is_valid()) {
+      throw std::runtime_error("Da hat jmd Namensanalyse verkackt...");
+    }
+    read_name = name;
+    read_location = location;
+    return read_variable(symbol, current_block);
+  }
+  using ASTWalker<IRBuilder>::visit;
+  void visit(FunctionDeclaration &decl);
+  void visit(CompoundStmt &stmt);
+  void visit(ReturnStmt &stmt);
+  void visit(VariableDeclarationStatement &stmt);
+  void visit(AssignmentStatement &stmt);
+  void visit(IfStatement &stmt);
+  void visit(ForStatement &stmt);
+  void visit(WhileStatement &stmt);
+  void visit(NumericExpr &expr);
+  void visit(VarExpr &expr);
+  void visit(ParenthesisExpression &expr);
+  void visit(BinaryOperatorExpression &expr);
+  void visit(UnaryOperatorExpression &expr);
+  void visit(TranslationUnit &unit);
 };
 
 #endif // COMPILER_IR_BUILDER_H
@@ -0,0 +1,193 @@
+#include "ssa.hpp"
+#include "cfg_analysis.hpp"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+struct Definition {
+  const BasicBlock *block;
+  std::size_t index;
+};
+
+bool has_successor(const BasicBlock *block, const BasicBlock *successor) {
+  return block->get_successor_true() == successor ||
+         block->get_successor_false() == successor;
+}
+
+} // namespace
+
+std::vector<std::string> ssa::verify(const CFG &cfg) {
+  std::vector<std::string> errors{};
+  const auto blocks = cfg.get_blocks();
+  const auto &analysis = cfg.get_analysis();
+
+  std::unordered_map<std::uint32_t, Definition> definitions{};
+  for (const auto *block : blocks) {
+    const auto &instructions = block->get_instructions();
+    for (std::size_t i = 0; i < instructions.size(); ++i) {
+      const auto result = instructions[i].get_result();
+      if (result && !definitions.emplace(result->numeral, Definition{block, i})
+                         .second) {
+        errors.push_back(std::format("bb_{}: {} is defined more than once",
+                                     block->get_id(), result->to_string()));
+      }
+    }
+  }
+
+  for (const auto *block : blocks) {
+    for (const auto &successor :
+         {block->get_successor_true(), block->get_successor_false()}) {
+      if (successor && std::ranges::count((*successor)->get_predecessors(),
+                                          block) == 0) {
+        errors.push_back(
+            std::format("bb_{}: missing from the predecessors of bb_{}",
+                        block->get_id(), (*successor)->get_id()));
+      }
+    }
+    for (const auto *predecessor : block->get_predecessors()) {
+      if (analysis.is_reachable(predecessor) &&
+          !has_successor(predecessor, block)) {
+        errors.push_back(
+            std::format("bb_{}: predecessor bb_{} does not branch here",
+                        block->get_id(), predecessor->get_id()));
+      }
+    }
+  }
+
+  const auto check_use = [&](const BasicBlock *block, std::size_t index,
+                             const BasicBlock *at, Var var) {
+    const auto it = definitions.find(var.numeral);
+    if (it == definitions.end()) {
+      errors.push_back(std::format("bb_{}: {} is used but never defined",
+                                   block->get_id(), var.to_string()));
+      return;
+    }
+    const auto &[def_block, def_index] = it->second;
+    // `at` is the block itself, or the predecessor for PHI operands
+    const bool defined_before = def_block == at
+                                    ? at != block || def_index < index
+                                    : analysis.dominates(def_block, at);
+    if (!defined_before) {
+      errors.push_back(
+          std::format("bb_{}: use of {} is not dominated by its definition",
+                      block->get_id(), var.to_string()));
+    }
+  };
+
+  for (const auto *block : blocks) {
+    const auto &instructions = block->get_instructions();
+    const auto phi_count = block->get_phi_count();
+    const auto predecessors = block->get_predecessors();
+    for (std::size_t i = 0; i < instructions.size(); ++i) {
+      const auto &instruction = instructions[i];
+      const auto operands = block->get_operands(instruction);
+      if (instruction.get_opcode() != Opcode::PHI) {
+        for (const auto var : instruction.get_used(
+                 block->get_overflow_operands())) {
+          check_use(block, i, block, var);
+        }
+        continue;
+      }
+      if (i >= phi_count) {
+        errors.push_back(std::format("bb_{}: PHI below a non-PHI instruction",
+                                     block->get_id()));
+      }
+      if (operands.size() != predecessors.size()) {
+        errors.push_back(std::format(
+            "bb_{}: PHI has {} operands for {} predecessors", block->get_id(),
+            operands.size(), predecessors.size()));
+        continue;
+      }
+      for (std::size_t k = 0; k < operands.size(); ++k) {
+        const auto *var = std::get_if<Var>(&operands[k].value);
+        if (var && analysis.is_reachable(predecessors[k])) {
+          check_use(block, i, predecessors[k], *var);
+        }
+      }
+    }
+  }
+  return errors;
+}
+
+void ssa::destruct(CFG &cfg) {
+  const auto blocks = cfg.get_blocks();
+
+  std::uint32_t next_var = 0;
+  for (const auto *block : blocks) {
+    for (const auto &instruction : block->get_instructions()) {
+      if (const auto result = instruction.get_result()) {
+        next_var = std::max(next_var, result->numeral + 1);
+      }
+    }
+  }
+
+  for (auto *block : blocks) {
+    const auto phi_count = block->get_phi_count();
+    if (phi_count == 0) {
+      continue;
+    }
+    // Copied first, the predecessor may be the block itself
+    std::vector<std::pair<Var, std::vector<Operand>>> phis{};
+    for (std::size_t i = 0; i < phi_count; ++i) {
+      const auto &phi = block->get_instructions()[i];
+      const auto operands = block->get_operands(phi);
+      phis.emplace_back(*phi.get_result(),
+                        std::vector<Operand>(operands.begin(), operands.end()));
+    }
+
+    const auto predecessors = block->get_predecessors();
+    for (std::size_t k = 0; k < predecessors.size(); ++k) {
+      auto *predecessor = predecessors[k];
+      if (predecessor->get_successor_false()) {
+        throw std::runtime_error(
+            std::format("Critical edge bb_{} -> bb_{} into a PHI block",
+                        predecessor->get_id(), block->get_id()));
+      }
+
+      std::vector<std::pair<Var, Operand>> copies{};
+      for (const auto &[result, operands] : phis) {
+        const auto *var = std::get_if<Var>(&operands[k].value);
+        if (!var || *var != result) {
+          copies.emplace_back(result, operands[k]);
+        }
+      }
+      const auto reads = [&](Var var) {
+        return std::ranges::any_of(copies, [var](const auto &copy) {
+          const auto *source = std::get_if<Var>(&copy.second.value);
+          return source && *source == var;
+        });
+      };
+      const auto emit = [&](Var to, Operand from) {
+        predecessor->insert_before_terminator(
+            IRInstruction{Opcode::STORE, {from}, to});
+      };
+      while (!copies.empty()) {
+        // A copy whose target no other copy reads can go first
+        const auto ready = std::ranges::find_if(
+            copies, [&](const auto &copy) { return !reads(copy.first); });
+        if (ready != copies.end()) {
+          emit(ready->first, ready->second);
+          copies.erase(ready);
+          continue;
+        }
+        // Only cycles left, move one target out of the way
+        const Var saved = copies.front().first;
+        const Var temp{next_var++};
+        emit(temp, Operand{saved});
+        for (auto &[to, from] : copies) {
+          if (const auto *source = std::get_if<Var>(&from.value);
+              source && *source == saved) {
+            from = Operand{temp};
+          }
+        }
+      }
+    }
+    block->remove_phis();
+  }
+}
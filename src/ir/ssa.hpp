@@ -0,0 +1,27 @@
+#ifndef IR_SSA_H
+#define IR_SSA_H
+
+#include "cfg.hpp"
+#include <string>
+#include <vector>
+
+namespace ssa {
+
+// Checks the SSA properties of a function:
+//   - every var is defined once
+//   - PHIs are at the top of their block, one operand per predecessor
+//   - every use is dominated by its definition, a PHI operand by the end of
+//     the matching predecessor
+//   - successor and predecessor lists agree
+// Returns one message per violation, empty if the function is fine.
+std::vector<std::string> verify(const CFG &cfg);
+
+// Leaves SSA for MIR lowering: every PHI becomes a copy (STORE) at the end of
+// each predecessor. The copies of one edge execute in parallel, so they are
+// ordered and cycles broken with a temp. Expects no critical edges into
+// blocks with PHIs, which IRBuilder guarantees.
+void destruct(CFG &cfg);
+
+} // namespace ssa
+
+#endif // !IR_SSA_H
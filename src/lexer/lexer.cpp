@@ -1,11 +1,190 @@
 #include "lexer.hpp"
-#include <cctype>
+#include "scan.hpp"
+#include <algorithm>
+#include <future>
+#include <memory>
 #include <string_view>
-#include <tuple>
 #include <iostream>
+#include <vector>
 
-Lexer::Lexer(std::string_view file_name, std::string_view source)
-    : file_name(file_name), source(source) {}
+Lexer::Lexer(uint32_t file_id, std::string_view source,
+             ident::Interner &interner)
+    : file_id(file_id), source(source), interner(&interner) {}
+
+TokenStream Lexer::tokenize_all() {
+  TokenStream stream{file_id, source};
+  // Real code averages well above four bytes per token
+  stream.reserve(source.size() / 4 + 1);
+  while (true) {
+    const auto token = next_token();
+    stream.push_back(token);
+    if (token.kind == token::TokenKind::Eof) {
+      return stream;
+    }
+  }
+}
+
+TokenStream Lexer::tokenize_range(std::size_t end) {
+  TokenStream stream{file_id, source};
+  stream.reserve((end - std::min(index, end)) / 4 + 1);
+  while (true) {
+    skip_trivia();
+    if (index >= end || eof()) {
+      return stream;
+    }
+    stream.push_back(next_token());
+  }
+}
+
+namespace {
+
+// Below this size splitting the input costs more than it saves
+constexpr std::size_t parallel_min_size = 1 << 20;
+constexpr std::size_t parallel_min_chunk = 256 * 1024;
+
+struct Chunk {
+  std::size_t begin;
+  std::size_t end;
+  // Chunks are lexed concurrently, each interns into its own table and the
+  // ids are moved into the shared one while stitching
+  std::unique_ptr<ident::Interner> interner;
+  TokenStream tokens;
+  // Position after the last token with trivia skipped, where the next
+  // chunk would have to start lexing
+  std::size_t stop = 0;
+  // First token that survives stitching and its index in the result
+  std::size_t first = 0;
+  std::size_t at = 0;
+  // Local to shared identifier ids, and the local ids in order of their first
+  // use among the surviving tokens
+  std::vector<ident::Ident> remap{};
+  std::vector<ident::Ident> first_use{};
+};
+
+} // namespace
+
+// Each chunk is lexed speculatively as if it started between two tokens. That
+// holds unless the previous chunk ends inside a block comment or a string
+// literal, which is detected while stitching: the true lexer position after
+// the previous chunk is compared against the chunk start. Since the lexer
+// state is nothing but the position, the speculative tokens are still correct
+// from the first one that starts at the true position onwards, only if there
+// is none the chunk is lexed again.
+TokenStream Lexer::tokenize_parallel(ThreadPool &pool) {
+  const std::size_t remaining = source.size() - index;
+  if (pool.size() < 2 || remaining < parallel_min_size) {
+    return tokenize_all();
+  }
+
+  // Split at newlines, a few chunks per worker to even out the load
+  const std::size_t count =
+      std::min(pool.size() * 4, remaining / parallel_min_chunk);
+  std::vector<Chunk> chunks;
+  std::size_t begin = index;
+  for (std::size_t i = 1; i <= count && begin < source.size(); ++i) {
+    std::size_t end = source.size();
+    if (i < count) {
+      const auto newline = source.find('\n', index + remaining / count * i);
+      end = newline == std::string_view::npos
+                ? source.size()
+                : std::max(begin, newline + 1);
+    }
+    if (end == begin) {
+      continue;
+    }
+    chunks.push_back(Chunk{begin, end, std::make_unique<ident::Interner>(),
+                           TokenStream{file_id, source}});
+    begin = end;
+  }
+
+  std::vector<std::future<void>> pending;
+  pending.reserve(chunks.size());
+  const auto wait_all = [&pending] {
+    for (auto &result : pending) {
+      result.get();
+    }
+    pending.clear();
+  };
+  for (auto &chunk : chunks) {
+    pending.push_back(pool.submit([this, &chunk] {
+      Lexer lexer{file_id, source, *chunk.interner};
+      lexer.index = chunk.begin;
+      chunk.tokens = lexer.tokenize_range(chunk.end);
+      chunk.stop = lexer.index;
+    }));
+  }
+  wait_all();
+
+  // Find where each chunk really starts, this is serial but only re-lexes
+  // in the rare case that a chunk has no token at its true start
+  std::size_t position = index;
+  std::size_t total = 0;
+  for (auto &chunk : chunks) {
+    chunk.first = 0;
+    if (position != chunk.begin) {
+      chunk.first = chunk.tokens.lower_bound(static_cast<uint32_t>(position));
+      if (position >= chunk.stop) {
+        // Swallowed whole by a comment or literal from an earlier chunk
+        chunk.stop = position;
+      } else if (chunk.first == chunk.tokens.size() ||
+                 chunk.tokens.offset(chunk.first) != position) {
+        Lexer lexer{file_id, source, *chunk.interner};
+        lexer.index = position;
+        chunk.tokens = lexer.tokenize_range(chunk.end);
+        chunk.stop = lexer.index;
+        chunk.first = 0;
+      }
+    }
+    chunk.at = total;
+    total += chunk.tokens.size() - chunk.first;
+    position = chunk.stop;
+  }
+
+  // Collect the identifiers each chunk actually keeps ...
+  for (auto &chunk : chunks) {
+    pending.push_back(pool.submit([&chunk] {
+      std::vector<bool> seen(chunk.interner->size());
+      for (auto i = chunk.first; i < chunk.tokens.size(); ++i) {
+        const auto id = chunk.tokens.ident(i);
+        if (id.is_valid() && !seen[id.get_id()]) {
+          seen[id.get_id()] = true;
+          chunk.first_use.push_back(id);
+        }
+      }
+    }));
+  }
+  wait_all();
+
+  // ... intern them into the shared table in order of first use, which
+  // hands out the same ids as a serial run would ...
+  for (auto &chunk : chunks) {
+    chunk.remap.resize(chunk.interner->size());
+    for (const auto id : chunk.first_use) {
+      chunk.remap[id.get_id()] = interner->intern(chunk.interner->name(id));
+    }
+  }
+
+  // ... and copy the chunks into their final place
+  TokenStream stream{file_id, source};
+  stream.resize(total);
+  for (auto &chunk : chunks) {
+    pending.push_back(pool.submit([&stream, &chunk] {
+      stream.copy_range(chunk.at, chunk.tokens, chunk.first,
+                        [&chunk](ident::Ident local) {
+                          return chunk.remap[local.get_id()];
+                        });
+    }));
+  }
+  wait_all();
+  for (const auto &chunk : chunks) {
+    stream.copy_long_lengths(chunk.at, chunk.tokens, chunk.first);
+  }
+
+  index = source.size();
+  stream.push_back(
+      token::Token{token::TokenKind::Eof, "EOF", span_from(index)});
+  return stream;
+}
 
 char Lexer::peek(int lookahead) const {
   return index + lookahead < source.size() ? source[index + lookahead] : '\0';
@@ -15,75 +194,78 @@ char Lexer::get() {
   if (index >= source.size())
     return '\0';
 
-  char c = source[index++];
-  if (c == '\n') {
-    line++;
-    column = 1;
-  } else {
-    column++;
-  }
+  return source[index++];
+}
 
-  return c;
+void Lexer::advance_to(const char *stop) {
+  index = static_cast<std::size_t>(stop - source.data());
+}
+
+token::Span Lexer::span_from(std::size_t start_index) const {
+  return {file_id, static_cast<uint32_t>(start_index),
+          static_cast<uint32_t>(index)};
 }
 
 bool Lexer::eof() const { return index >= source.size(); }
 
+void Lexer::skip_trivia() {
+  while (true) {
+    skip_whitespace();
+    if (peek() != '/') {
+      return;
+    }
+    if (peek(1) == '/') {
+      skip_oneline_comment();
+    } else if (peek(1) == '*') {
+      skip_multiline_comment();
+    } else {
+      return;
+    }
+  }
+}
+
 void Lexer::skip_whitespace() {
-  while (std::isspace(peek()))
-    get();
+  advance_to(scan::skip_space(source.data() + index,
+                              source.data() + source.size()));
 }
 
 void Lexer::skip_oneline_comment() {
-  while (peek() != '\n' && peek() != '\0')
-    get();
+  advance_to(scan::find_byte(source.data() + index,
+                             source.data() + source.size(), '\n'));
 }
 
 // TODO: fix for nested multiline comments...
 void Lexer::skip_multiline_comment() {
+  const char *end = source.data() + source.size();
+  // Skip the opening "/*" so that "/*/" does not close the comment
+  const char *cursor = source.data() + index + 2;
   while (true) {
-    if (peek() == '\0') {
-      break;
+    const char *star = scan::find_byte(cursor, end, '*');
+    if (star == end) {
+      advance_to(end);
+      return;
     }
-    if (peek() == '*') {
-      get();
-      if (peek() == '/') {
-        get();
-        break;
-      }
-    } else {
-      get();
+    if (star + 1 < end && star[1] == '/') {
+      advance_to(star + 2);
+      return;
     }
+    cursor = star + 1;
   }
 }
 
 token::Token Lexer::next_token() {
-  skip_whitespace();
+  skip_trivia();
 
   if (eof()) {
-    return {token::TokenKind::Eof, "EOF",
-            token::Span{file_name, std::make_tuple(line, column),
-                        std::make_tuple(line, column)}};
+    return {token::TokenKind::Eof, "EOF", span_from(index)};
   }
 
   char c = peek();
 
-  // remove comments
-  if (c == '/') {
-    if (peek(1) == '/') {
-      skip_oneline_comment();
-      // there could be whitespace again after comment...
-      return next_token();
-    } else if (peek(1) == '*') {
-      skip_multiline_comment();
-      // there could be whitespace again after comment...
-      return next_token();
-    }
-  }
-
-  if (std::isalpha(c) || c == '_') {
+  if (scan::is_ident_start(c)) {
     return lex_identifier_or_keyword();
   }
-  if (std::isdigit(c)) {
+  if (scan::is_digit(c)) {
     return lex_number();
   }
   if (c == '"') {
@@ -98,56 +280,51 @@ token::Token Lexer::next_token() {
 
 token::Token Lexer::lex_identifier_or_keyword() {
   size_t start_index = index;
-  const auto start{std::make_tuple(line, column)};
-
-  while (std::isalnum(peek()) || peek() == '_')
-    get();
 
-  std::string_view ident = source.substr(start_index, index - start_index);
+  advance_to(
+      scan::skip_ident(source.data() + index, source.data() + source.size()));
 
-  const auto end{std::make_tuple(line, column)};
-  token::Span span{file_name, start, end};
+  std::string_view text = source.substr(start_index, index - start_index);
+  token::Span span = span_from(start_index);
 
-  // check if identifier is keyword
-  if (token::keyword_table.contains(ident)) {
-    return token::Token{token::keyword_table.at(ident), ident, span};
+  // keywords resolve to their own kind, everything else is an Identifier and
+  // gets interned here, once, so later phases compare names by id
+  const auto kind = token::lookup_keyword(text);
+  if (kind != token::TokenKind::Identifier) {
+    return token::Token{kind, text, span};
   }
-  return token::Token{token::TokenKind::Identifier, ident, span};
+  return token::Token{kind, text, span, false, interner->intern(text)};
 }
 
 token::Token Lexer::lex_number() {
   size_t start_index = index;
-  const auto start = std::make_tuple(line, column);
 
   if (peek(0) == '0' && (peek(1) == 'x' || peek(1) == 'X') &&
-      std::isxdigit(peek(2))) {
+      scan::is_hex_digit(peek(2))) {
     get();
     get();
-    while (std::isxdigit(peek()))
+    while (scan::is_hex_digit(peek()))
       get();
     std::string_view text = source.substr(start_index, index - start_index);
-    const auto end = std::make_tuple(line, column);
-    token::Span span{file_name, start, end};
+    token::Span span = span_from(start_index);
     return token::Token{token::TokenKind::NumberLiteralHex, text, span};
   }
 
-  while (std::isdigit(peek()))
+  while (scan::is_digit(peek()))
     get();
 
   std::string_view text = source.substr(start_index, index - start_index);
-  const auto end = std::make_tuple(line, column);
-  token::Span span{file_name, start, end};
+  token::Span span = span_from(start_index);
   return token::Token{token::TokenKind::NumberLiteralDec, text, span};
 }
 
 // TODO: add escape literals
 token::Token Lexer::lex_string_literal() {
   size_t start_index = index;
-  const auto start{std::make_tuple(line, column)};
   // Consume "
   get();
 
-  while (peek() != '\"')
+  while (!eof() && peek() != '\"')
     get();
 
   // Consume "
@@ -155,14 +332,12 @@ token::Token Lexer::lex_string_literal() {
 
   std::string_view text = source.substr(start_index, index - start_index);
 
-  const auto end{std::make_tuple(line, column)};
-  token::Span span{file_name, start, end};
+  token::Span span = span_from(start_index);
   return token::Token{token::TokenKind::StringLiteral, text, span};
 }
 
 token::Token Lexer::lex_char_literal() {
   size_t start_index = index;
-  const auto start = std::make_tuple(line, column);
   bool is_invalid = false;
 
   get(); // consume opening '
@@ -198,14 +373,12 @@ token::Token Lexer::lex_char_literal() {
   }
 
   std::string_view text = source.substr(start_index, index - start_index);
-  const auto end = std::make_tuple(line, column);
-  token::Span span{file_name, start, end};
+  token::Span span = span_from(start_index);
   return token::Token{token::TokenKind::CharLiteral, text, span, is_invalid};
 }
 
 token::Token Lexer::lex_operator_or_punctuation() {
   auto i = index;
-  const auto start{std::make_tuple(line, column)};
   token::TokenKind tokenKind;
 
   char c = get();
@@ -384,7 +557,6 @@ token::Token Lexer::lex_operator_or_punctuation() {
     break;
   };
   std::string_view text = source.substr(i, index - i);
-  const auto end{std::make_tuple(line, column)};
-  const token::Span span{file_name, start, end};
+  const token::Span span = span_from(i);
   return token::Token{tokenKind, text, span};
 }
@@ -1,27 +1,45 @@
 #ifndef LEXER_LEXER_H
 #define LEXER_LEXER_H
 
+#include "../defs/ident.hpp"
 #include "../defs/token.hpp"
+#include "../util/thread_pool.hpp"
+#include "token_stream.hpp"
 #include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 class Lexer {
 public:
-  Lexer(std::string_view file_name, std::string_view source);
+  // Identifiers are interned into `interner`, the process wide one by default
+  Lexer(uint32_t file_id, std::string_view source,
+        ident::Interner &interner = ident::Interner::global());
 
   token::Token next_token();
+  // Lexes the whole input up front, the stream ends with the Eof token
+  TokenStream tokenize_all();
+  // Same result as tokenize_all, but large inputs are split at newlines and
+  // the pieces are lexed concurrently on `pool`
+  TokenStream tokenize_parallel(ThreadPool &pool);
   [[nodiscard]] bool eof() const;
-  [[nodiscard]] std::string_view get_file_name() const { return file_name; }
+  [[nodiscard]] uint32_t get_file_id() const { return file_id; }
 
 private:
-  std::string_view file_name;
+  uint32_t file_id;
   std::string_view source;
   std::size_t index = 0;
-  int line = 1;
-  int column = 1;
+  ident::Interner *interner;
 
   [[nodiscard]] char peek(int lookahead = 0) const;
   char get();
+  void advance_to(const char *stop);
+  // Byte range from start_index up to the current position
+  [[nodiscard]] token::Span span_from(std::size_t start_index) const;
+
+  // Skips whitespace and comments up to the start of the next token
+  void skip_trivia();
+  // Lexes the tokens starting before `end`, Eof is not included
+  TokenStream tokenize_range(std::size_t end);
 
   void skip_whitespace();
   void skip_oneline_comment();
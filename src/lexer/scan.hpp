@@ -0,0 +1,220 @@
+#ifndef LEXER_SCAN_H
+#define LEXER_SCAN_H
+
+// Bulk character scanning for the lexer. On x86 CPUs with AVX2, long runs of
+// whitespace, identifier characters and comment bodies are classified 32
+// bytes at a time and finished off byte by byte. The AVX2 loops are compiled
+// with a target attribute and picked at runtime, so the compiler binary does
+// not need -mavx2. Other CPUs use the scalar loops only, a 16 byte SSE2
+// version measured slower than them on typical C0 sources.
+// Define SCAN_FORCE_SCALAR to compile only the scalar fallback.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// GCC and Clang both define __GNUC__
+#if !defined(SCAN_FORCE_SCALAR) && defined(__GNUC__) &&                        \
+    (defined(__x86_64__) || defined(__i386__))
+#define SCAN_AVX2
+#define SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+namespace scan {
+
+// Locale independent replacements for the <cctype> predicates
+enum CharClass : uint8_t {
+  Space = 1 << 0,
+  Alpha = 1 << 1,
+  Digit = 1 << 2,
+  HexDigit = 1 << 3,
+  Underscore = 1 << 4,
+};
+
+inline constexpr std::array<uint8_t, 256> char_class = [] {
+  std::array<uint8_t, 256> table{};
+  for (const unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'})
+    table[c] |= Space;
+  for (unsigned char c = 'a'; c <= 'z'; ++c)
+    table[c] |= Alpha;
+  for (unsigned char c = 'A'; c <= 'Z'; ++c)
+    table[c] |= Alpha;
+  for (unsigned char c = '0'; c <= '9'; ++c)
+    table[c] |= Digit | HexDigit;
+  for (unsigned char c = 'a'; c <= 'f'; ++c)
+    table[c] |= HexDigit;
+  for (unsigned char c = 'A'; c <= 'F'; ++c)
+    table[c] |= HexDigit;
+  table['_'] |= Underscore;
+  return table;
+}();
+
+constexpr bool has_class(char c, uint8_t classes) {
+  return (char_class[static_cast<unsigned char>(c)] & classes) != 0;
+}
+constexpr bool is_space(char c) { return has_class(c, Space); }
+constexpr bool is_digit(char c) { return has_class(c, Digit); }
+constexpr bool is_hex_digit(char c) { return has_class(c, HexDigit); }
+constexpr bool is_ident_start(char c) { return has_class(c, Alpha | Underscore); }
+constexpr bool is_ident(char c) {
+  return has_class(c, Alpha | Digit | Underscore);
+}
+
+namespace detail {
+
+inline const char *skip_space_scalar(const char *p, const char *end) {
+  while (p < end && is_space(*p))
+    ++p;
+  return p;
+}
+
+inline const char *skip_ident_scalar(const char *p, const char *end) {
+  while (p < end && is_ident(*p))
+    ++p;
+  return p;
+}
+
+inline const char *find_byte_scalar(const char *p, const char *end, char c) {
+  while (p < end && *p != c)
+    ++p;
+  return p;
+}
+
+#if defined(SCAN_AVX2)
+// Checked once at startup, or known at compile time with -mavx2
+#if defined(__AVX2__)
+inline constexpr bool has_avx2 = true;
+#else
+inline const bool has_avx2 = [] {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+}();
+#endif
+
+using Block = __m256i;
+constexpr std::ptrdiff_t width = 32;
+
+// Most runs in real code are a few bytes long (single spaces, short names),
+// these are checked byte by byte before paying for a vector load.
+constexpr std::ptrdiff_t scalar_prefix = 16;
+
+constexpr uint32_t all_bits = 0xFFFFFFFFu;
+
+SCAN_TARGET_AVX2 inline Block load(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+SCAN_TARGET_AVX2 inline Block splat(char c) { return _mm256_set1_epi8(c); }
+SCAN_TARGET_AVX2 inline Block eq(Block a, Block b) {
+  return _mm256_cmpeq_epi8(a, b);
+}
+SCAN_TARGET_AVX2 inline Block either(Block a, Block b) {
+  return _mm256_or_si256(a, b);
+}
+SCAN_TARGET_AVX2 inline Block sub(Block a, Block b) {
+  return _mm256_sub_epi8(a, b);
+}
+// Unsigned a <= b per byte
+SCAN_TARGET_AVX2 inline Block at_most(Block a, Block b) {
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a);
+}
+SCAN_TARGET_AVX2 inline uint32_t bits(Block a) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(a));
+}
+
+// ' ' or '\t'..'\r'
+SCAN_TARGET_AVX2 inline uint32_t space_bits(Block v) {
+  const Block control = sub(v, splat('\t'));
+  return bits(either(eq(v, splat(' ')), at_most(control, splat(4))));
+}
+
+// [A-Za-z0-9_]
+SCAN_TARGET_AVX2 inline uint32_t ident_bits(Block v) {
+  const Block lower = either(v, splat(0x20));
+  const Block alpha = at_most(sub(lower, splat('a')), splat(25));
+  const Block digit = at_most(sub(v, splat('0')), splat(9));
+  return bits(either(either(alpha, digit), eq(v, splat('_'))));
+}
+
+SCAN_TARGET_AVX2 inline uint32_t byte_bits(Block v, char c) {
+  return bits(eq(v, splat(c)));
+}
+
+SCAN_TARGET_AVX2 inline const char *skip_space_avx2(const char *p,
+                                                    const char *end) {
+  for (const char *prefix_end = p + std::min(end - p, scalar_prefix);
+       p < prefix_end; ++p) {
+    if (!is_space(*p))
+      return p;
+  }
+  while (end - p >= width) {
+    const uint32_t stop = ~space_bits(load(p)) & all_bits;
+    if (stop)
+      return p + std::countr_zero(stop);
+    p += width;
+  }
+  return skip_space_scalar(p, end);
+}
+
+SCAN_TARGET_AVX2 inline const char *skip_ident_avx2(const char *p,
+                                                    const char *end) {
+  for (const char *prefix_end = p + std::min(end - p, scalar_prefix);
+       p < prefix_end; ++p) {
+    if (!is_ident(*p))
+      return p;
+  }
+  while (end - p >= width) {
+    const uint32_t stop = ~ident_bits(load(p)) & all_bits;
+    if (stop)
+      return p + std::countr_zero(stop);
+    p += width;
+  }
+  return skip_ident_scalar(p, end);
+}
+
+SCAN_TARGET_AVX2 inline const char *find_byte_avx2(const char *p,
+                                                   const char *end, char c) {
+  while (end - p >= width) {
+    const uint32_t hit = byte_bits(load(p), c);
+    if (hit)
+      return p + std::countr_zero(hit);
+    p += width;
+  }
+  return find_byte_scalar(p, end, c);
+}
+#endif
+
+} // namespace detail
+
+// First position in [p, end) that is not whitespace
+inline const char *skip_space(const char *p, const char *end) {
+#ifdef SCAN_AVX2
+  if (detail::has_avx2)
+    return detail::skip_space_avx2(p, end);
+#endif
+  return detail::skip_space_scalar(p, end);
+}
+
+// First position in [p, end) that cannot continue an identifier
+inline const char *skip_ident(const char *p, const char *end) {
+#ifdef SCAN_AVX2
+  if (detail::has_avx2)
+    return detail::skip_ident_avx2(p, end);
+#endif
+  return detail::skip_ident_scalar(p, end);
+}
+
+// First occurrence of c in [p, end), end if there is none
+inline const char *find_byte(const char *p, const char *end, char c) {
+#ifdef SCAN_AVX2
+  if (detail::has_avx2)
+    return detail::find_byte_avx2(p, end, c);
+#endif
+  return detail::find_byte_scalar(p, end, c);
+}
+
+} // namespace scan
+
+#endif // !LEXER_SCAN_H
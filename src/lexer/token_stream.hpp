@@ -0,0 +1,183 @@
+#ifndef LEXER_TOKEN_STREAM_H
+#define LEXER_TOKEN_STREAM_H
+
+#include "../defs/token.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// All tokens of one file, stored column-wise: kinds, byte offsets and lengths
+// live in their own dense arrays, the text is recovered from the source view.
+// Built once by Lexer::tokenize_all (or stitched together from chunks by
+// Lexer::tokenize_parallel) and never modified afterwards, so it can be handed
+// between threads freely. The last token is always Eof.
+class TokenStream {
+public:
+  enum Flag : uint8_t { Invalid = 1 << 0 };
+
+private:
+  // Default-initializes instead of value-initializing, so resize() leaves the
+  // new slots untouched and copy_range fills them (and faults their pages in)
+  // on the worker threads instead of one serial memset
+  template <typename T> struct DefaultInitAllocator : std::allocator<T> {
+    template <typename U> struct rebind {
+      using other = DefaultInitAllocator<U>;
+    };
+    DefaultInitAllocator() = default;
+    template <typename U>
+    DefaultInitAllocator(const DefaultInitAllocator<U> &) noexcept {}
+
+    template <typename U> void construct(U *p) noexcept {
+      ::new (static_cast<void *>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) {
+      ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+  };
+  template <typename T> using Column = std::vector<T, DefaultInitAllocator<T>>;
+
+  static constexpr uint8_t unsupported_kind = 0xFF;
+  static constexpr uint16_t long_length = 0xFFFF;
+
+  std::string_view source;
+  uint32_t file_id;
+
+  Column<uint8_t> kinds;
+  Column<uint32_t> offsets;
+  Column<uint16_t> lengths;
+  Column<uint8_t> flags;
+  Column<uint32_t> idents; // ident::Ident ids, 0 for all but identifiers
+  // (index, length) of tokens too long for lengths[], ordered by index
+  std::vector<std::pair<uint32_t, uint32_t>> long_lengths;
+
+  static_assert(static_cast<int>(token::TokenKind::Void) < unsupported_kind,
+                "TokenKind does not fit into uint8_t");
+
+public:
+  TokenStream(uint32_t file_id, std::string_view source)
+      : source(source), file_id(file_id) {}
+
+  void reserve(std::size_t count) {
+    kinds.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    flags.reserve(count);
+    idents.reserve(count);
+  }
+
+  void push_back(const token::Token &token) {
+    const auto index = static_cast<uint32_t>(kinds.size());
+    kinds.push_back(token.kind == token::TokenKind::Unsupported
+                        ? unsupported_kind
+                        : static_cast<uint8_t>(token.kind));
+    offsets.push_back(token.span.begin);
+
+    const uint32_t length = token.span.length();
+    if (length >= long_length) {
+      lengths.push_back(long_length);
+      long_lengths.emplace_back(index, length);
+    } else {
+      lengths.push_back(static_cast<uint16_t>(length));
+    }
+    flags.push_back(token.invalid ? Invalid : 0);
+    idents.push_back(token.ident.get_id());
+  }
+
+  // Grows the stream to `count` tokens, the new slots are filled in by
+  // copy_range before the stream is used
+  void resize(std::size_t count) {
+    kinds.resize(count);
+    offsets.resize(count);
+    lengths.resize(count);
+    flags.resize(count);
+    idents.resize(count);
+  }
+
+  // Copies tokens [first, other.size()) of `other`, which must be lexed from
+  // the same source, to the slots starting at `at`. Identifier ids are passed
+  // through `map_ident`, e.g. to move them into another interner. Disjoint
+  // ranges may be filled concurrently, the lengths of overlong tokens are
+  // added afterwards with copy_long_lengths.
+  template <typename MapIdent>
+  void copy_range(std::size_t at, const TokenStream &other, std::size_t first,
+                  MapIdent &&map_ident) {
+    const auto count = other.size() - first;
+    std::copy_n(other.kinds.begin() + first, count, kinds.begin() + at);
+    std::copy_n(other.offsets.begin() + first, count, offsets.begin() + at);
+    std::copy_n(other.lengths.begin() + first, count, lengths.begin() + at);
+    std::copy_n(other.flags.begin() + first, count, flags.begin() + at);
+    for (std::size_t i = 0; i < count; ++i) {
+      const ident::Ident id{other.idents[first + i]};
+      idents[at + i] = id.is_valid() ? map_ident(id).get_id() : 0;
+    }
+  }
+
+  // Second half of copy_range, ranges have to be passed in ascending order
+  void copy_long_lengths(std::size_t at, const TokenStream &other,
+                         std::size_t first) {
+    for (const auto &[index, length] : other.long_lengths) {
+      if (index >= first) {
+        long_lengths.emplace_back(
+            static_cast<uint32_t>(index - first + at), length);
+      }
+    }
+  }
+
+  // Index of the first token starting at or after `offset`, size() if none
+  [[nodiscard]] std::size_t lower_bound(uint32_t offset) const {
+    return static_cast<std::size_t>(
+        std::lower_bound(offsets.begin(), offsets.end(), offset) -
+        offsets.begin());
+  }
+
+  [[nodiscard]] std::size_t size() const { return kinds.size(); }
+  [[nodiscard]] uint32_t get_file_id() const { return file_id; }
+
+  [[nodiscard]] token::TokenKind kind(std::size_t i) const {
+    return kinds[i] == unsupported_kind ? token::TokenKind::Unsupported
+                                        : static_cast<token::TokenKind>(kinds[i]);
+  }
+
+  [[nodiscard]] uint32_t offset(std::size_t i) const { return offsets[i]; }
+
+  [[nodiscard]] uint32_t length(std::size_t i) const {
+    if (lengths[i] != long_length) {
+      return lengths[i];
+    }
+    const auto it = std::lower_bound(
+        long_lengths.begin(), long_lengths.end(), static_cast<uint32_t>(i),
+        [](const auto &entry, uint32_t index) { return entry.first < index; });
+    return it->second;
+  }
+
+  [[nodiscard]] bool is_invalid(std::size_t i) const {
+    return flags[i] & Invalid;
+  }
+
+  [[nodiscard]] ident::Ident ident(std::size_t i) const {
+    return ident::Ident{idents[i]};
+  }
+
+  [[nodiscard]] std::string_view text(std::size_t i) const {
+    if (kind(i) == token::TokenKind::Eof) {
+      return "EOF";
+    }
+    return source.substr(offsets[i], length(i));
+  }
+
+  [[nodiscard]] token::Span span(std::size_t i) const {
+    return {file_id, offsets[i], offsets[i] + length(i)};
+  }
+
+  // Materializes the i-th token, for code that wants the full record
+  [[nodiscard]] token::Token token(std::size_t i) const {
+    return {kind(i), text(i), span(i), is_invalid(i), ident(i)};
+  }
+};
+
+#endif // !LEXER_TOKEN_STREAM_H
@@ -1,3 +1,4 @@
+#include "alloc/allocation_stats.hpp"
 #include "analysis/liveness.hpp"
 #include "analysis/semantics.hpp"
 #include "code_gen/interference_graph.hpp"
@@ -8,54 +9,122 @@
 #include "code_gen/target/x86/generator.hpp"
 #include "defs/ast.hpp"
 #include "defs/ast_printer.hpp"
+#include "defs/flat_ast.hpp"
 #include "io/io.hpp"
 #include "ir/ir_builder.hpp"
+#include "ir/ssa.hpp"
 #include "lexer/lexer.hpp"
 #include "mir/mir_generator.hpp"
+#include "opt/ir/ir_optimization_pass.hpp"
+#include "opt/ir/passes/constant_folding.hpp"
+#include "opt/ir/passes/constant_propagation.hpp"
 #include "opt/mir/mir_optimization_pass.hpp"
 #include "opt/mir/peephole_pass.hpp"
 #include "parser/parser.hpp"
+#include "report/diagnostic_writer.hpp"
 #include "report/report_builder.hpp"
+#include "util/thread_pool.hpp"
+#include <charconv>
+#include <exception>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::string_view input;
+  std::string_view output;
+  DiagnosticsFormat diagnostics_format = DiagnosticsFormat::Text;
+  std::size_t max_errors = 0;
+  bool alloc_stats = false;
+};
+
+// compiler <input> <output> [--diagnostics-format=text|jsonl|sarif]
+//          [--max-errors=N] [--alloc-stats]
+std::optional<Options> parse_options(int argc, char *argv[]) {
+  Options options{};
+  std::vector<std::string_view> positional{};
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (arg.starts_with("--diagnostics-format=")) {
+      const auto format =
+          parse_diagnostics_format(arg.substr(arg.find('=') + 1));
+      if (!format) {
+        return std::nullopt;
+      }
+      options.diagnostics_format = *format;
+    } else if (arg.starts_with("--max-errors=")) {
+      const auto value = arg.substr(arg.find('=') + 1);
+      const auto *const end = value.data() + value.size();
+      const auto result =
+          std::from_chars(value.data(), end, options.max_errors);
+      if (result.ec != std::errc{} || result.ptr != end) {
+        return std::nullopt;
+      }
+    } else if (arg == "--alloc-stats") {
+      options.alloc_stats = true;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 2) {
+    return std::nullopt;
+  }
+  options.input = positional[0];
+  options.output = positional[1];
+  return options;
+}
 
-int main(int argc, char *argv[]) {
+int compile(const Options &options, const io::SourceFile &file,
+            const std::shared_ptr<DiagnosticEmitter> &diagnostics,
+            const std::shared_ptr<SourceManager> &source_manager,
+            arena::AllocationReport &allocations) {
   const auto target =
       create_compiler_target<X86_64Target>(CompilerTarget::X86_64);
 
-  const auto file = io::read_file(argv[1]);
-  // std::cout << file.content << std::endl;
-
-  const auto diagnostics = std::make_shared<DiagnosticEmitter>();
-  const auto source_manager =
-      std::make_shared<SourceManager>(file.content, file.name);
-  auto *lexer = new Lexer{file.name, file.content};
-  auto *parser = new Parser{*lexer, diagnostics, source_manager};
+  ThreadPool pool{};
+  allocations.enter("lex");
+  auto *lexer = new Lexer{source_manager->get_file_id(), file.get_content()};
+  auto tokens = lexer->tokenize_parallel(pool);
+  allocations.enter("parse");
+  auto *parser = new Parser{std::move(tokens), diagnostics, source_manager};
 
   const auto unit{parser->parse_translation_unit()};
 
-  // ClangStylePrintVisitor visitor{};
-  //  unit->accept(visitor);
+  // ClangStylePrintVisitor visitor{*source_manager};
+  //  visitor.walk(*unit);
   //  std::cout << visitor.get_content() << std::endl;
 
   if (diagnostics->has_errors()) {
-    diagnostics->print_all();
+    diagnostics->print_all(*source_manager);
     return 42;
   }
-  semantic::SemanticVisitor semantic_visitor{diagnostics, source_manager};
-  unit->accept(semantic_visitor);
+  allocations.enter("semantics");
+  semantic::analyze(*unit, diagnostics, source_manager, pool);
   if (diagnostics->has_errors()) {
-    diagnostics->print_all();
+    diagnostics->print_all(*source_manager);
     return 7;
   }
+#ifndef NDEBUG
+  // The flat form has to describe the same tree, resolved symbols included
+  if (const auto errors =
+          flat::verify_round_trip(*unit, source_manager->get_file_id());
+      !errors.empty()) {
+    throw std::runtime_error("Broken flat AST: " + errors.front());
+  }
+#endif
+  allocations.enter("ir");
   IntermediateRepresentation representation{};
   IRBuilder builder{representation, diagnostics, source_manager};
-  unit->accept(builder);
+  builder.walk(*unit);
 
   // std::cout << representation.to_string() << std::endl;
 
   if (diagnostics->has_errors()) {
-    diagnostics->print_all();
+    diagnostics->print_all(*source_manager);
     system("pause");
     return 7;
   }
@@ -63,17 +132,35 @@ int main(int argc, char *argv[]) {
   delete parser;
   delete lexer;
 
+  allocations.enter("ir-opt");
+  // Local folding first, so SCCP starts from fewer instructions
+  IROptPhase ir_opt_phase{
+      {new IRConstantFoldingPass{}, new IRConstantPropagationPass{}}};
+  ir_opt_phase.perform_passes(representation);
+
+  for (auto &cfg : representation.get_cfgs()) {
+#ifndef NDEBUG
+    if (const auto errors = ssa::verify(cfg); !errors.empty()) {
+      throw std::runtime_error("Broken SSA: " + errors.front());
+    }
+#endif
+    ssa::destruct(cfg);
+  }
+
+  allocations.enter("mir");
   mir::MIRProgram program{};
   MIRGenerator mir_generator{representation, program};
   mir_generator.generate();
   // std::cout << mir::to_string(program) << std::endl;
 
+  allocations.enter("liveness");
   MIRRegisterMap m{};
   Liveness liveness{program, m};
   liveness.analyse();
 
   // std::cout << liveness.to_string_block_to_live() << std::endl;
 
+  allocations.enter("regalloc");
   RegisterAllocation reg_alloc{liveness, m,
                                program.get_functions().begin()->second, target};
   reg_alloc.allocate();
@@ -81,10 +168,12 @@ int main(int argc, char *argv[]) {
   // std::cout << mir::to_string(program) << std::endl;
 
   // Opt passes
+  allocations.enter("mir-opt");
   MIROptPhase mir_opt_phase{{new MIRPeepholePass{}}};
   mir_opt_phase.perform_passes(program);
   // std::cout << mir::to_string(program) << std::endl;
 
+  allocations.enter("codegen");
   X86Generator gen{};
   const auto asm_string = gen.generate_program(program);
 
@@ -92,7 +181,57 @@ int main(int argc, char *argv[]) {
   // std::cout << asm_string << std::endl;
   std::cout << "Writing file" << std::endl;
   io::write_file("🤣.s", asm_string);
-  system(std::format("gcc 🤣.s -o {}", argv[2]).c_str());
+  system(std::format("gcc 🤣.s -o {}", options.output).c_str());
   std::remove("🤣.s");
   return 0;
 }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const auto options = parse_options(argc, argv);
+  if (!options) {
+    std::cerr << "usage: " << argv[0]
+              << " <input> <output> [--diagnostics-format=text|jsonl|sarif]"
+                 " [--max-errors=N] [--alloc-stats]"
+              << std::endl;
+    return 1;
+  }
+
+  const auto file = io::read_file(std::string(options->input));
+  // std::cout << file.get_content() << std::endl;
+
+  const auto diagnostics = std::make_shared<DiagnosticEmitter>();
+  const auto source_manager =
+      std::make_shared<SourceManager>(file.get_content(), file.get_name());
+  diagnostics->set_writer(make_diagnostic_writer(
+      options->diagnostics_format, std::cerr, *source_manager));
+  diagnostics->set_max_errors(options->max_errors);
+
+  arena::set_allocation_counting(options->alloc_stats);
+  arena::AllocationReport allocations{};
+  int status = 0;
+  try {
+    status = compile(*options, file, diagnostics, source_manager, allocations);
+  } catch (const std::exception &e) {
+    // A failed internal check is reported in the requested format too
+    diagnostics->emit_error(SourceLocation{}, "Internal compiler error: {}",
+                            std::string(e.what()));
+    diagnostics->print_all(*source_manager);
+    status = 70;
+  }
+  allocations.finish();
+  // Streamed formats are closed here, on every exit path
+  diagnostics->finish();
+
+  if (options->alloc_stats) {
+    std::cerr << "heap traffic per phase:" << std::endl;
+    for (const auto &[phase, counters] : allocations.get_phases()) {
+      std::cerr << std::format("  {:<10} {:>8} allocs {:>8} frees {:>10} bytes",
+                               phase, counters.allocations,
+                               counters.deallocations, counters.bytes)
+                << std::endl;
+    }
+  }
+  return status;
+}
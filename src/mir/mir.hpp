@@ -1,10 +1,12 @@
 #ifndef MIR_MIR_H
 #define MIR_MIR_H
 
+#include "../alloc/arena.hpp"
 #include <cstddef>
 #include <cstdint>
 #include <format>
 #include <list>
+#include <memory_resource>
 #include <optional>
 #include <sstream>
 #include <string>
@@ -201,27 +203,43 @@ private:
   std::size_t frame_size;
   std::size_t id;
   inline static std::size_t fn_id_counter = 0;
-  std::list<MachineInstruction *> instructions{};
+  std::pmr::list<MachineInstruction *> instructions;
+  // Loop nesting depth of the IR block behind each label, blocks outside of
+  // loops are not listed
+  std::pmr::unordered_map<std::size_t, std::size_t> loop_depths;
 
 public:
-  explicit MachineFunction(std::size_t frame_size = 0)
-      : frame_size(frame_size), id(fn_id_counter++) {}
+  explicit MachineFunction(
+      std::size_t frame_size = 0,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : frame_size(frame_size), id(fn_id_counter++), instructions(resource),
+        loop_depths(resource) {}
   [[nodiscard]] std::size_t get_id() const { return id; }
   bool operator==(const MachineFunction &other) const { return id == other.id; }
 
   [[nodiscard]] size_t get_frame_size() const { return frame_size; }
-  [[nodiscard]] const std::list<MachineInstruction *> &
+  [[nodiscard]] const std::pmr::list<MachineInstruction *> &
   get_instructions() const {
     return instructions;
   }
 
-  [[nodiscard]] std::list<MachineInstruction *> &get_instructions_mut() {
+  [[nodiscard]] std::pmr::list<MachineInstruction *> &get_instructions_mut() {
     return instructions;
   }
   void set_frame_size(size_t size) { frame_size = size; }
   void add_instruction(MachineInstruction *instruction) {
     instructions.push_back(instruction);
   }
+
+  void set_loop_depth(std::size_t label, std::size_t depth) {
+    if (depth > 0) {
+      loop_depths[label] = depth;
+    }
+  }
+  [[nodiscard]] std::size_t get_loop_depth(std::size_t label) const {
+    const auto it = loop_depths.find(label);
+    return it == loop_depths.end() ? 0 : it->second;
+  }
 };
 
 } // namespace mir
@@ -236,15 +254,31 @@ template <> struct hash<mir::MachineFunction> {
 
 namespace mir {
 
+// Owns the arena all machine instructions and instruction lists of the
+// program are allocated from, so they stay valid as long as the program
 struct MIRProgram {
 private:
-  std::unordered_map<size_t, MachineFunction> functions{};
+  arena::Arena arena{};
+  std::pmr::unordered_map<size_t, MachineFunction> functions{
+      arena.resource()};
 
 public:
+  MIRProgram() = default;
+  MIRProgram(const MIRProgram &) = delete;
+  MIRProgram &operator=(const MIRProgram &) = delete;
+
+  [[nodiscard]] arena::Arena &get_arena() { return arena; }
+
+  // Functions for this program should allocate from the program's arena
+  [[nodiscard]] MachineFunction create_function(std::size_t frame_size = 0) {
+    return MachineFunction{frame_size, arena.resource()};
+  }
+
   void add_function(MachineFunction func) {
-    functions.emplace(func.get_id(), func);
+    functions.emplace(func.get_id(), std::move(func));
   }
-  [[nodiscard]] std::unordered_map<size_t, MachineFunction> &get_functions() {
+  [[nodiscard]] std::pmr::unordered_map<size_t, MachineFunction> &
+  get_functions() {
     return functions;
   }
 };
@@ -1,4 +1,5 @@
 #include "mir_generator.hpp"
+#include "../ir/cfg_analysis.hpp"
 #include "mir.hpp"
 #include <vector>
 
@@ -34,14 +35,16 @@ void MIRGenerator::perform_dfs_basic_block(
 }
 
 mir::MachineFunction MIRGenerator::generate_function(const CFG &cfg) {
-  mir::MachineFunction function{};
+  auto function = mir_program.create_function();
 
   std::list<BasicBlock *> linearized_blocks{};
   std::set<BasicBlock *> visited{};
   perform_dfs_basic_block(cfg.entry_block, visited, linearized_blocks);
 
+  const auto &analysis = cfg.get_analysis();
   // TODO: Dfs over basic blocks (choosing false branch first).
   for (const auto *block : linearized_blocks) {
+    function.set_loop_depth(block->get_id(), analysis.get_loop_depth(block));
     generate_bb(function, block);
   }
   return function;
@@ -85,14 +88,13 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
         return mir::MachineOperand{mir::Immediate{var}};
       }};
   for (const auto &ir_instruction : bb->get_instructions()) {
+    const auto operands = bb->get_operands(ir_instruction);
     switch (ir_instruction.get_opcode()) {
     case Opcode::ADD: {
       const auto target_reg = mir::MachineOperand{mir::VirtualRegister{
           ir_instruction.get_result().value().numeral, 32}};
-      const auto lhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
-      const auto rhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(1).value);
+      const auto lhs = std::visit(ir_op_to_m_op, operands[0].value);
+      const auto rhs = std::visit(ir_op_to_m_op, operands[1].value);
       if (is_register(lhs) && is_immediate(rhs)) {
 
         function.add_instruction(create_mov_rr(lhs, target_reg));
@@ -117,10 +119,8 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
     case Opcode::SUB: {
       const auto target_reg = mir::MachineOperand{mir::VirtualRegister{
           ir_instruction.get_result().value().numeral, 32}};
-      const auto lhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
-      const auto rhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(1).value);
+      const auto lhs = std::visit(ir_op_to_m_op, operands[0].value);
+      const auto rhs = std::visit(ir_op_to_m_op, operands[1].value);
       if (is_register(lhs) && is_immediate(rhs)) {
         if (std::get<mir::VirtualRegister>(lhs.get_op()).get_name() !=
             std::get<mir::VirtualRegister>(rhs.get_op()).get_name()) {
@@ -165,10 +165,8 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
     case Opcode::MUL: {
       const auto target_reg = mir::MachineOperand{mir::VirtualRegister{
           ir_instruction.get_result().value().numeral, 32}};
-      const auto lhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
-      const auto rhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(1).value);
+      const auto lhs = std::visit(ir_op_to_m_op, operands[0].value);
+      const auto rhs = std::visit(ir_op_to_m_op, operands[1].value);
       if (is_register(lhs) && is_immediate(rhs)) {
         const auto move_instr = arena.create<mir::MachineInstruction>(
             mir::MachineInstruction::MachineOpcode::MOV_RR,
@@ -210,10 +208,8 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
     case Opcode::DIV: {
       const auto target_reg = mir::MachineOperand{mir::VirtualRegister{
           ir_instruction.get_result().value().numeral, 32}};
-      const auto lhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
-      const auto rhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(1).value);
+      const auto lhs = std::visit(ir_op_to_m_op, operands[0].value);
+      const auto rhs = std::visit(ir_op_to_m_op, operands[1].value);
       if (is_register(lhs) && is_immediate(rhs)) {
         const auto move_instr = arena.create<mir::MachineInstruction>(
             mir::MachineInstruction::MachineOpcode::MOV_RR,
@@ -267,10 +263,8 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
     case Opcode::MOD: {
       const auto target_reg = mir::MachineOperand{mir::VirtualRegister{
           ir_instruction.get_result().value().numeral, 32}};
-      const auto lhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
-      const auto rhs =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(1).value);
+      const auto lhs = std::visit(ir_op_to_m_op, operands[0].value);
+      const auto rhs = std::visit(ir_op_to_m_op, operands[1].value);
       if (is_register(lhs) && is_immediate(rhs)) {
         const auto move_instr = arena.create<mir::MachineInstruction>(
             mir::MachineInstruction::MachineOpcode::MOV_RR,
@@ -326,8 +320,7 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
     case Opcode::STORE: {
       const auto target_reg = mir::MachineOperand{mir::VirtualRegister{
           ir_instruction.get_result().value().numeral, 32}};
-      const auto src =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
+      const auto src = std::visit(ir_op_to_m_op, operands[0].value);
       const auto move_instr = arena.create<mir::MachineInstruction>(
           is_register(src) ? mir::MachineInstruction::MachineOpcode::MOV_RR
                            : mir::MachineInstruction::MachineOpcode::MOV_RI,
@@ -338,8 +331,7 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
     case Opcode::NEG: {
       const auto target_reg = mir::MachineOperand{mir::VirtualRegister{
           ir_instruction.get_result().value().numeral, 32}};
-      const auto src =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
+      const auto src = std::visit(ir_op_to_m_op, operands[0].value);
       const auto move_instr = arena.create<mir::MachineInstruction>(
           mir::MachineInstruction::MachineOpcode::MOV_RR,
           std::vector<mir::MachineOperand>{src},
@@ -353,8 +345,7 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
 
     } break;
     case Opcode::RET: {
-      const auto src =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
+      const auto src = std::visit(ir_op_to_m_op, operands[0].value);
       const auto mov_inst = arena.create<mir::MachineInstruction>(
           is_register(src) ? mir::MachineInstruction::MachineOpcode::MOV_RR
                            : mir::MachineInstruction::MachineOpcode::MOV_RI,
@@ -368,10 +359,8 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
       function.add_instruction(ret_inst);
     } break;
     case Opcode::LT: {
-      const auto src =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(1).value);
-      const auto dst =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
+      const auto src = std::visit(ir_op_to_m_op, operands[1].value);
+      const auto dst = std::visit(ir_op_to_m_op, operands[0].value);
       const auto cmp = arena.create<mir::MachineInstruction>(
           mir::MachineInstruction::MachineOpcode::CMP,
           std::vector<mir::MachineOperand>{dst, src});
@@ -385,8 +374,7 @@ void MIRGenerator::generate_bb(mir::MachineFunction &function,
       function.add_instruction(jl);
     } break;
     case Opcode::JMP: {
-      const auto src =
-          std::visit(ir_op_to_m_op, ir_instruction.get_operands().at(0).value);
+      const auto src = std::visit(ir_op_to_m_op, operands[0].value);
       const auto jmp = arena.create<mir::MachineInstruction>(
           mir::MachineInstruction::MachineOpcode::JMP,
           std::vector<mir::MachineOperand>{src});
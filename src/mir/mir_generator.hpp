@@ -1,6 +1,7 @@
 #ifndef MIR_MIR_GENERATOR
 #define MIR_MIR_GENERATOR
 
+#include "../alloc/arena.hpp"
 #include "../ir/cfg.hpp"
 #include "mir.hpp"
 #include <vector>
@@ -8,7 +9,8 @@ struct MIRGenerator {
 private:
   IntermediateRepresentation &representation;
   mir::MIRProgram &mir_program;
-  arena::Arena arena;
+  // The program's, instructions have to outlive the generator
+  arena::Arena &arena;
   std::unordered_map<std::size_t, std::size_t> temp_to_reg{};
 
   void perform_dfs_basic_block(BasicBlock *current_block,
@@ -45,7 +47,7 @@ public:
   explicit MIRGenerator(IntermediateRepresentation &representation,
                         mir::MIRProgram &program)
       : representation(representation), mir_program(program),
-        arena(arena::Arena{}) {}
+        arena(program.get_arena()) {}
   void generate();
 };
 
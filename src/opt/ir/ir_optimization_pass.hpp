@@ -1,5 +1,5 @@
-#ifndef OPT_MIR_MIR_OPTIMIZATION_PASS_H
-#define OPT_MIR_MIR_OPTIMIZATION_PASS_H
+#ifndef OPT_IR_IR_OPTIMIZATION_PASS_H
+#define OPT_IR_IR_OPTIMIZATION_PASS_H
 
 #include "../../ir/cfg.hpp"
 #include <iostream>
@@ -7,11 +7,13 @@
 #include <string>
 #include <utility>
 
+// Passes run on the SSA form, before it is destructed. A pass that adds or
+// removes edges has to invalidate the CFG's analysis.
 class IROptPass {
 
 private:
   std::string name;
-  virtual void transform_block(BasicBlock *block) = 0;
+  virtual void transform_function(CFG &cfg) = 0;
 
 public:
   virtual ~IROptPass() = default;
@@ -19,7 +21,7 @@ public:
 
   inline void perform_pass(IntermediateRepresentation &program) {
     for (auto &fun : program.get_cfgs()) {
-      transform_block(fun.get_entry_block_mut());
+      transform_function(fun);
     }
   }
 
@@ -45,4 +47,4 @@ struct IROptPhase {
   }
 };
 
-#endif // !COMPILER_MIR_HOPTIMIZATION_PASS_H
+#endif // !OPT_IR_IR_OPTIMIZATION_PASS_H
@@ -0,0 +1,94 @@
+#include "constant_folding.hpp"
+#include "../../../ir/cfg_analysis.hpp"
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+std::optional<std::uint32_t>
+fold_constant(Opcode op, std::span<const std::uint32_t> values) {
+  if (op == Opcode::NEG && values.size() == 1) {
+    return 0u - values[0];
+  }
+  if (values.size() != 2) {
+    return std::nullopt;
+  }
+  const auto lhs = values[0];
+  const auto rhs = values[1];
+  const auto signed_lhs = static_cast<std::int32_t>(lhs);
+  const auto signed_rhs = static_cast<std::int32_t>(rhs);
+  const auto traps = signed_rhs == 0 ||
+                     (signed_lhs == std::numeric_limits<std::int32_t>::min() &&
+                      signed_rhs == -1);
+  switch (op) {
+  case Opcode::ADD:
+    return lhs + rhs;
+  case Opcode::SUB:
+    return lhs - rhs;
+  case Opcode::MUL:
+    return lhs * rhs;
+  case Opcode::DIV:
+    if (traps) {
+      return std::nullopt;
+    }
+    return static_cast<std::uint32_t>(signed_lhs / signed_rhs);
+  case Opcode::MOD:
+    if (traps) {
+      return std::nullopt;
+    }
+    return static_cast<std::uint32_t>(signed_lhs % signed_rhs);
+  case Opcode::LT:
+    return signed_lhs < signed_rhs;
+  case Opcode::LE:
+    return signed_lhs <= signed_rhs;
+  case Opcode::GT:
+    return signed_lhs > signed_rhs;
+  case Opcode::GE:
+    return signed_lhs >= signed_rhs;
+  case Opcode::EQ:
+    return lhs == rhs;
+  case Opcode::NE:
+    return lhs != rhs;
+  default:
+    return std::nullopt;
+  }
+}
+
+void IRConstantFoldingPass::transform_function(CFG &cfg) {
+  // Definitions dominate their uses, in reverse postorder every constant is
+  // known before it is used
+  std::unordered_map<std::uint32_t, std::uint32_t> constants{};
+  std::vector<std::uint32_t> values{};
+  for (auto *block : cfg.get_analysis().get_reverse_postorder()) {
+    for (auto &instruction : block->get_instructions()) {
+      const auto result = instruction.get_result();
+      // Folding a branch condition means removing an edge, which is up to
+      // IRConstantPropagationPass
+      if (!result || instruction.get_opcode() == Opcode::PHI ||
+          &instruction == block->get_branch_condition()) {
+        continue;
+      }
+      values.clear();
+      for (const auto &operand : block->get_operands(instruction)) {
+        if (const auto *value = std::get_if<std::uint32_t>(&operand.value)) {
+          values.push_back(*value);
+        } else if (const auto it =
+                       constants.find(std::get<Var>(operand.value).numeral);
+                   it != constants.end()) {
+          values.push_back(it->second);
+        } else {
+          break;
+        }
+      }
+      if (values.size() != block->get_operands(instruction).size()) {
+        continue;
+      }
+      const auto folded = instruction.get_opcode() == Opcode::STORE
+                              ? std::optional{values.front()}
+                              : fold_constant(instruction.get_opcode(), values);
+      if (folded) {
+        constants.emplace(result->numeral, *folded);
+        instruction = IRInstruction{Opcode::STORE, {Operand{*folded}}, result};
+      }
+    }
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef OPT_IR_PASSES_CONSTANT_FOLDING_H
+#define OPT_IR_PASSES_CONSTANT_FOLDING_H
+
+#include "../ir_optimization_pass.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+
+// Evaluates `op` on constant operands with C0's semantics: 32-bit two's
+// complement wraparound, comparisons give 1 or 0. nullopt for everything
+// that is not evaluated at compile time, including the divisions that trap
+// at runtime (by zero, INT_MIN / -1), which are left in place to trap.
+std::optional<std::uint32_t>
+fold_constant(Opcode op, std::span<const std::uint32_t> values);
+
+// Replaces instructions whose operands are all constants by a STORE of their
+// value. Only looks at straight chains of constants, PHIs and branches are
+// left to IRConstantPropagationPass.
+class IRConstantFoldingPass : public IROptPass {
+private:
+  void transform_function(CFG &cfg) override;
+
+public:
+  IRConstantFoldingPass() : IROptPass("Constant folding") {}
+};
+
+#endif // !OPT_IR_PASSES_CONSTANT_FOLDING_H
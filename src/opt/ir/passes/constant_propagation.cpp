@@ -0,0 +1,258 @@
+#include "constant_propagation.hpp"
+#include "../../../ir/cfg_analysis.hpp"
+#include "constant_folding.hpp"
+
+void IRConstantPropagationPass::transform_function(CFG &cfg) {
+  propagate(cfg);
+  if (rewrite(cfg)) {
+    cfg.invalidate_analysis();
+  }
+  values.clear();
+  uses.clear();
+  executable_edges.clear();
+  executable_blocks.clear();
+}
+
+void IRConstantPropagationPass::propagate(CFG &cfg) {
+  for (auto *block : cfg.get_analysis().get_reverse_postorder()) {
+    const auto &instructions = block->get_instructions();
+    for (std::size_t i = 0; i < instructions.size(); ++i) {
+      if (const auto result = instructions[i].get_result()) {
+        values.emplace(result->numeral, Value{});
+      }
+      for (const auto var : instructions[i].get_used(
+               block->get_overflow_operands())) {
+        uses[var.numeral].push_back(Use{block, i});
+      }
+    }
+  }
+
+  executable_blocks.insert(cfg.entry_block);
+  visit_block(cfg.entry_block);
+  while (!edge_worklist.empty() || !value_worklist.empty()) {
+    if (!edge_worklist.empty()) {
+      const auto [from, to] = edge_worklist.back();
+      edge_worklist.pop_back();
+      if (!executable_edges.emplace(from, to).second) {
+        continue;
+      }
+      if (executable_blocks.insert(to).second) {
+        visit_block(to);
+      } else {
+        // Only the PHIs see the new edge
+        for (std::size_t i = 0; i < to->get_phi_count(); ++i) {
+          visit_instruction(to, i);
+        }
+      }
+      continue;
+    }
+    const auto var = value_worklist.back();
+    value_worklist.pop_back();
+    for (const auto &use : uses[var]) {
+      if (executable_blocks.contains(use.block)) {
+        visit_instruction(use.block, use.index);
+      }
+    }
+  }
+}
+
+void IRConstantPropagationPass::mark_edge(BasicBlock *from, BasicBlock *to) {
+  if (!executable_edges.contains(Edge{from, to})) {
+    edge_worklist.emplace_back(from, to);
+  }
+}
+
+void IRConstantPropagationPass::visit_block(BasicBlock *block) {
+  for (std::size_t i = 0; i < block->get_instructions().size(); ++i) {
+    visit_instruction(block, i);
+  }
+  visit_branch(block);
+}
+
+void IRConstantPropagationPass::visit_instruction(BasicBlock *block,
+                                                  std::size_t index) {
+  const auto &instruction = block->get_instructions()[index];
+  if (const auto result = instruction.get_result()) {
+    update(*result, evaluate(block, instruction));
+  }
+  if (&instruction == block->get_branch_condition()) {
+    visit_branch(block);
+  }
+}
+
+void IRConstantPropagationPass::visit_branch(BasicBlock *block) {
+  const auto &on_true = block->get_successor_true();
+  const auto &on_false = block->get_successor_false();
+  if (!on_true) {
+    return;
+  }
+  if (!on_false) {
+    mark_edge(block, *on_true);
+    return;
+  }
+  const auto *condition = block->get_branch_condition();
+  const auto value = condition ? values.at(condition->get_result()->numeral)
+                               : Value{Kind::Overdefined};
+  switch (value.kind) {
+  case Kind::Unknown:
+    break;
+  case Kind::Constant:
+    mark_edge(block, value.constant != 0 ? *on_true : *on_false);
+    break;
+  case Kind::Overdefined:
+    mark_edge(block, *on_true);
+    mark_edge(block, *on_false);
+    break;
+  }
+}
+
+// Values only move down from Unknown over Constant to Overdefined
+void IRConstantPropagationPass::update(Var var, Value value) {
+  auto &current = values.at(var.numeral);
+  if (current == value || current.kind == Kind::Overdefined ||
+      value.kind == Kind::Unknown) {
+    return;
+  }
+  current = current.kind == Kind::Constant ? Value{Kind::Overdefined} : value;
+  value_worklist.push_back(var.numeral);
+}
+
+IRConstantPropagationPass::Value
+IRConstantPropagationPass::evaluate(const BasicBlock *block,
+                                    const IRInstruction &instruction) const {
+  const auto operands = block->get_operands(instruction);
+  switch (instruction.get_opcode()) {
+  case Opcode::PHI: {
+    // Meet of the values flowing in over executable edges
+    const auto predecessors = block->get_predecessors();
+    Value result{};
+    for (std::size_t k = 0; k < operands.size(); ++k) {
+      if (!executable_edges.contains(Edge{predecessors[k], block})) {
+        continue;
+      }
+      const auto value = get_value(operands[k]);
+      if (value.kind == Kind::Unknown) {
+        continue;
+      }
+      if (result.kind == Kind::Unknown) {
+        result = value;
+      } else if (result != value) {
+        return Value{Kind::Overdefined};
+      }
+    }
+    return result;
+  }
+  case Opcode::STORE:
+    return get_value(operands[0]);
+  default:
+    break;
+  }
+
+  std::vector<std::uint32_t> constants{};
+  bool unknown = false;
+  for (const auto &operand : operands) {
+    const auto value = get_value(operand);
+    if (value.kind == Kind::Overdefined) {
+      return value;
+    }
+    unknown |= value.kind == Kind::Unknown;
+    constants.push_back(value.constant);
+  }
+  if (unknown) {
+    return Value{};
+  }
+  if (const auto folded = fold_constant(instruction.get_opcode(), constants)) {
+    return Value{Kind::Constant, *folded};
+  }
+  return Value{Kind::Overdefined};
+}
+
+IRConstantPropagationPass::Value
+IRConstantPropagationPass::get_value(const Operand &operand) const {
+  if (const auto *constant = std::get_if<std::uint32_t>(&operand.value)) {
+    return Value{Kind::Constant, *constant};
+  }
+  // Not defined in the function, e.g. a parameter
+  const auto it = values.find(std::get<Var>(operand.value).numeral);
+  return it == values.end() ? Value{Kind::Overdefined} : it->second;
+}
+
+bool IRConstantPropagationPass::rewrite(CFG &cfg) {
+  const auto reverse_postorder = cfg.get_analysis().get_reverse_postorder();
+  std::vector<BasicBlock *> blocks{};
+  for (auto *block : reverse_postorder) {
+    if (executable_blocks.contains(block)) {
+      blocks.push_back(block);
+    }
+  }
+
+  bool edges_changed = false;
+  for (auto *block : blocks) {
+    const auto &on_true = block->get_successor_true();
+    const auto &on_false = block->get_successor_false();
+    if (!on_false) {
+      continue;
+    }
+    const auto taken_true = executable_edges.contains(Edge{block, *on_true});
+    const auto taken_false = executable_edges.contains(Edge{block, *on_false});
+    if (taken_true == taken_false) {
+      continue;
+    }
+    auto *taken = taken_true ? *on_true : *on_false;
+    auto *dead = taken_true ? *on_false : *on_true;
+
+    // The condition is constant, drop it unless its value is used elsewhere
+    auto &instructions = block->get_instructions();
+    if (const auto *condition = block->get_branch_condition();
+        condition && uses[condition->get_result()->numeral].empty()) {
+      instructions.pop_back();
+    }
+    instructions.push_back(IRInstruction(
+        Opcode::JMP, {Operand{static_cast<std::uint32_t>(taken->get_id())}},
+        std::nullopt));
+    block->set_successor_true(taken);
+    block->set_successor_false(std::nullopt);
+    dead->remove_predecessor(block);
+    edges_changed = true;
+  }
+
+  for (auto *block : blocks) {
+    const auto predecessors = block->get_predecessors();
+    for (const auto *predecessor : std::vector<const BasicBlock *>{
+             predecessors.begin(), predecessors.end()}) {
+      if (!executable_edges.contains(Edge{predecessor, block})) {
+        block->remove_predecessor(predecessor);
+        edges_changed = true;
+      }
+    }
+    rewrite_block(block);
+  }
+  return edges_changed;
+}
+
+// Constant values become a STORE of the constant, for PHIs after the
+// remaining PHIs
+void IRConstantPropagationPass::rewrite_block(BasicBlock *block) {
+  auto &instructions = block->get_instructions();
+  const auto phi_count = block->get_phi_count();
+  std::vector<IRInstruction> phis{};
+  std::vector<IRInstruction> rest{};
+  for (std::size_t i = 0; i < instructions.size(); ++i) {
+    auto instruction = instructions[i];
+    const auto result = instruction.get_result();
+    const auto value =
+        result ? values.at(result->numeral) : Value{Kind::Overdefined};
+    if (value.kind == Kind::Constant &&
+        &instructions[i] != block->get_branch_condition()) {
+      instruction =
+          IRInstruction{Opcode::STORE, {Operand{value.constant}}, result};
+    }
+    if (i < phi_count && instruction.get_opcode() == Opcode::PHI) {
+      phis.push_back(instruction);
+    } else {
+      rest.push_back(instruction);
+    }
+  }
+  instructions.assign(phis.begin(), phis.end());
+  instructions.insert(instructions.end(), rest.begin(), rest.end());
+}
@@ -0,0 +1,66 @@
+#ifndef OPT_IR_PASSES_CONSTANT_PROPAGATION_H
+#define OPT_IR_PASSES_CONSTANT_PROPAGATION_H
+
+#include "../ir_optimization_pass.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Sparse conditional constant propagation (Wegman, Zadeck: "Constant
+// Propagation with Conditional Branches"). Every value is assumed constant
+// until shown otherwise and only edges found executable are followed, so
+// constants flow through the PHIs of loops and branches.
+//
+// Afterwards values found constant are turned into a STORE of the constant,
+// branches on a constant condition become jumps and the edges that are never
+// taken are removed, along with their PHI operands.
+class IRConstantPropagationPass : public IROptPass {
+private:
+  struct Value {
+    enum class Kind { Unknown, Constant, Overdefined };
+
+    Kind kind = Kind::Unknown;
+    std::uint32_t constant = 0;
+
+    bool operator==(const Value &) const = default;
+  };
+  using Kind = Value::Kind;
+  struct Use {
+    BasicBlock *block;
+    std::size_t index;
+  };
+  using Edge = std::pair<const BasicBlock *, const BasicBlock *>;
+
+  // State of the function being transformed
+  std::unordered_map<std::uint32_t, Value> values{};
+  std::unordered_map<std::uint32_t, std::vector<Use>> uses{};
+  std::set<Edge> executable_edges{};
+  std::unordered_set<const BasicBlock *> executable_blocks{};
+  std::vector<std::pair<BasicBlock *, BasicBlock *>> edge_worklist{};
+  std::vector<std::uint32_t> value_worklist{};
+
+  void transform_function(CFG &cfg) override;
+
+  void propagate(CFG &cfg);
+  void mark_edge(BasicBlock *from, BasicBlock *to);
+  void visit_block(BasicBlock *block);
+  void visit_instruction(BasicBlock *block, std::size_t index);
+  void visit_branch(BasicBlock *block);
+  void update(Var var, Value value);
+  [[nodiscard]] Value evaluate(const BasicBlock *block,
+                               const IRInstruction &instruction) const;
+  [[nodiscard]] Value get_value(const Operand &operand) const;
+
+  // Returns whether edges were removed
+  bool rewrite(CFG &cfg);
+  void rewrite_block(BasicBlock *block);
+
+public:
+  IRConstantPropagationPass() : IROptPass("Constant propagation") {}
+};
+
+#endif // !OPT_IR_PASSES_CONSTANT_PROPAGATION_H
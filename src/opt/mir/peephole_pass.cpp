@@ -5,7 +5,7 @@
 
 bool MIRPeepholePass::optimize_redundant_mov_rr(
     mir::MachineFunction &block,
-    std::list<mir::MachineInstruction *>::iterator &inst_iter) {
+    std::pmr::list<mir::MachineInstruction *>::iterator &inst_iter) {
 
   if (inst_iter == block.get_instructions().end()) {
     return false;
@@ -45,7 +45,7 @@ bool MIRPeepholePass::optimize_redundant_mov_rr(
 
 bool optimize_stack_operations(
     mir::MachineFunction &block,
-    std::list<mir::MachineInstruction *>::iterator &inst_iter) {
+    std::pmr::list<mir::MachineInstruction *>::iterator &inst_iter) {
   if (inst_iter == block.get_instructions().end()) {
     return false;
   }
@@ -15,10 +15,10 @@ private:
   // Optimizations
   static bool optimize_redundant_mov_rr(
       mir::MachineFunction &block,
-      std::list<mir::MachineInstruction *>::iterator &inst_iter);
+      std::pmr::list<mir::MachineInstruction *>::iterator &inst_iter);
   static bool optimize_mul_by_power_of_two(
       mir::MachineFunction &block,
-      std::list<mir::MachineInstruction *>::iterator &inst_iter);
+      std::pmr::list<mir::MachineInstruction *>::iterator &inst_iter);
 
 public:
   explicit MIRPeepholePass(std::uint8_t window_size = 1)
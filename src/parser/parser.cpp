@@ -9,7 +9,7 @@ LValue *Parser::parse_lvalue() {
     const auto star = expect(token::TokenKind::Asterisk);
     const auto operand = parse_lvalue();
     const auto lv = arena.create<DereferenceLValue>(
-        operand, SourceLocation{lexer.get_file_name(), star->span.start,
+        operand, SourceLocation{tokens.get_file_id(), star.span.begin,
                                 operand->get_location().end});
     return parse_lvalue_tail(lv);
   } else if (is_next(token::TokenKind::LParen)) {
@@ -20,8 +20,8 @@ LValue *Parser::parse_lvalue() {
   } else {
     const auto iden = expect(token::TokenKind::Identifier);
     const auto lv = arena.create<VariableLValue>(
-        iden->text, SourceLocation{lexer.get_file_name(), iden->span.start,
-                                   iden->span.end});
+        iden.ident, SourceLocation{tokens.get_file_id(), iden.span.begin,
+                                   iden.span.end});
     return parse_lvalue_tail(lv);
   }
 }
@@ -31,15 +31,15 @@ LValue *Parser::parse_lvalue_tail(LValue *lvalue) {
     const auto dot = expect(token::TokenKind::Dot);
     const auto fid = expect(token::TokenKind::Identifier);
     const auto lv = arena.create<FieldAccessLValue>(
-        lvalue, fid->text,
-        SourceLocation{lexer.get_file_name(), dot->span.start, fid->span.end});
+        lvalue, fid.ident,
+        SourceLocation{tokens.get_file_id(), dot.span.begin, fid.span.end});
     return parse_lvalue_tail(lv);
   } else if (is_next(token::TokenKind::Arrow)) {
     const auto dot = expect(token::TokenKind::Arrow);
     const auto fid = expect(token::TokenKind::Identifier);
     const auto lv = arena.create<PointerAccessLValue>(
-        lvalue, fid->text,
-        SourceLocation{lexer.get_file_name(), dot->span.start, fid->span.end});
+        lvalue, fid.ident,
+        SourceLocation{tokens.get_file_id(), dot.span.begin, fid.span.end});
     return parse_lvalue_tail(lv);
   } else if (is_next(token::TokenKind::LBracket)) {
     const auto lb = expect(token::TokenKind::LBracket);
@@ -47,7 +47,7 @@ LValue *Parser::parse_lvalue_tail(LValue *lvalue) {
     const auto rb = expect(token::TokenKind::RBracket);
     const auto lv = arena.create<ArrayAccessLValue>(
         lvalue, expr,
-        SourceLocation{lexer.get_file_name(), lb->span.start, rb->span.end});
+        SourceLocation{tokens.get_file_id(), lb.span.begin, rb.span.end});
     return parse_lvalue_tail(lv);
   } else {
     return lvalue;
@@ -64,21 +64,20 @@ TypeAnnotation *Parser::parse_type() {
   const auto builtin = builtinFromToken(next_token.kind);
   if (builtin != Builtin::Unknown) {
     return parse_type_tail(parse_builtin_type(next_token.kind));
-  } else {
-    throw ParseError(
-        std::format("Expected TypeAnnotation, but next token was {}",
-                    next_token.text),
-        SourceLocation{lexer.get_file_name(), next_token.span.start,
-                       next_token.span.end});
   }
+  report_error(next_token.span,
+               "Expected TypeAnnotation, but next token was {}",
+               next_token.text);
+  return arena.create<BuiltinTypeAnnotation>(Builtin::Unknown,
+                                             next_token.span);
 }
 
 BuiltinTypeAnnotation *Parser::parse_builtin_type(token::TokenKind type) {
   const auto builtin = expect(type);
   const auto tp = arena.create<BuiltinTypeAnnotation>(
-      builtinFromToken(builtin->kind),
-      SourceLocation{lexer.get_file_name(), builtin->span.start,
-                     builtin->span.end});
+      builtinFromToken(builtin.kind),
+      SourceLocation{tokens.get_file_id(), builtin.span.begin,
+                     builtin.span.end});
   return tp;
 }
 
@@ -86,16 +85,16 @@ StructTypeAnnotation *Parser::parse_struct_type() {
   const auto str = expect(token::TokenKind::Struct);
   const auto iden = expect(token::TokenKind::Identifier);
   const auto tp = arena.create<StructTypeAnnotation>(
-      iden->text,
-      SourceLocation{lexer.get_file_name(), str->span.start, iden->span.end});
+      iden.ident,
+      SourceLocation{tokens.get_file_id(), str.span.begin, iden.span.end});
   return tp;
 }
 
 NamedTypeAnnotation *Parser::parse_named_type() {
   const auto iden = expect(token::TokenKind::Identifier);
   const auto tp = arena.create<NamedTypeAnnotation>(
-      iden->text,
-      SourceLocation{lexer.get_file_name(), iden->span.start, iden->span.end});
+      iden.ident,
+      SourceLocation{tokens.get_file_id(), iden.span.begin, iden.span.end});
   return tp;
 }
 
@@ -103,15 +102,15 @@ TypeAnnotation *Parser::parse_type_tail(TypeAnnotation *type) {
   if (is_next(token::TokenKind::Asterisk)) {
     const auto star = expect(token::TokenKind::Asterisk);
     const auto tp = arena.create<PointerTypeAnnotation>(
-        type, SourceLocation{lexer.get_file_name(), star->span.start,
-                             star->span.end});
+        type, SourceLocation{tokens.get_file_id(), star.span.begin,
+                             star.span.end});
     return parse_type_tail(tp);
   } else if (is_next(token::TokenKind::LBracket)) {
     const auto first = expect(token::TokenKind::LBracket);
     const auto second = expect(token::TokenKind::RBracket);
     const auto tp = arena.create<ArrayTypeAnnotation>(
-        type, SourceLocation{lexer.get_file_name(), first->span.start,
-                             second->span.end});
+        type, SourceLocation{tokens.get_file_id(), first.span.begin,
+                             second.span.end});
     return parse_type_tail(tp);
   } else {
     return type;
@@ -121,10 +120,8 @@ TypeAnnotation *Parser::parse_type_tail(TypeAnnotation *type) {
 Expression *Parser::parse_expression() { return parse_expr_with_precedence(0); }
 
 Expression *Parser::parse_exp_head() {
-  const auto next_token = peek();
-
   // Single token
-  switch (next_token.kind) {
+  switch (peek_kind()) {
   case token::TokenKind::NumberLiteralDec:
   case token::TokenKind::NumberLiteralHex:
     return parse_integer_literal();
@@ -147,96 +144,162 @@ Expression *Parser::parse_exp_head() {
     break;
   }
 
-  if (token::unary_ops.contains(peek().kind)) {
-    return nullptr;
+  if (const auto &rule = operator_rule(peek_kind()); rule.prefix_power >= 0) {
+    return parse_unary_expr(rule);
   }
 
-  if (check_sequence(
-          {token::TokenKind::Identifier, token::TokenKind::LParen})) {
+  if (check_sequence(token::TokenKind::Identifier, token::TokenKind::LParen)) {
     return parse_call_expression();
-  } else if (is_next(token::TokenKind::Identifier)) {
+  }
+  if (is_next(token::TokenKind::Identifier)) {
     return parse_var_expr();
-  } else {
-    throw ParseError(
-        std::format("Expected Expression, but next token was {}", peek().text),
-        SourceLocation{lexer.get_file_name(), peek().span.start, peek().span.end});
   }
-}
-
-Expression *Parser::parse_expr_with_precedence(int minPrecedence) {
+  const auto next_token = peek();
+  report_error(next_token.span, "Expected Expression, but next token was {}",
+               next_token.text);
+  return arena.create<InvalidExpr>(next_token.span);
+}
+
+constexpr std::array<Parser::OperatorRule, token::token_kind_count>
+Parser::make_operator_rules() {
+  std::array<OperatorRule, token::token_kind_count> rules{};
+  const auto prefix = [&](token::TokenKind kind, UnaryOperator op) {
+    auto &rule = rules[static_cast<std::size_t>(kind)];
+    rule.prefix_power = 12;
+    rule.unary = op;
+  };
+  const auto infix = [&](token::TokenKind kind, int8_t power,
+                         InfixParser parser,
+                         BinaryOperator op = BinaryOperator::Unknown,
+                         Associativity associativity = Associativity::Left) {
+    auto &rule = rules[static_cast<std::size_t>(kind)];
+    rule.infix_power = power;
+    rule.associativity = associativity;
+    rule.infix = parser;
+    rule.binary = op;
+  };
+  const auto binary = [&](token::TokenKind kind, int8_t power,
+                          BinaryOperator op) {
+    infix(kind, power, &Parser::parse_binary_expr, op);
+  };
+
+  prefix(token::TokenKind::Bang, UnaryOperator::LogicalNot);
+  prefix(token::TokenKind::Tilde, UnaryOperator::BitwiseNot);
+  prefix(token::TokenKind::Minus, UnaryOperator::Neg);
+  prefix(token::TokenKind::Asterisk, UnaryOperator::Deref);
+
+  infix(token::TokenKind::Question, 1, &Parser::parse_ternary_expr,
+        BinaryOperator::Unknown, Associativity::Right);
+  binary(token::TokenKind::PipePipe, 2, BinaryOperator::LogicalOr);
+  binary(token::TokenKind::AndAnd, 3, BinaryOperator::LogicalAnd);
+  binary(token::TokenKind::Pipe, 4, BinaryOperator::BitwiseOr);
+  binary(token::TokenKind::Caret, 5, BinaryOperator::BitwiseXor);
+  binary(token::TokenKind::And, 6, BinaryOperator::BitwiseAnd);
+  binary(token::TokenKind::EqualEqual, 7, BinaryOperator::Equal);
+  binary(token::TokenKind::BangEqual, 7, BinaryOperator::NotEqual);
+  binary(token::TokenKind::LAngleBracket, 8, BinaryOperator::LessThan);
+  binary(token::TokenKind::LessEqual, 8, BinaryOperator::LessThanOrEqual);
+  binary(token::TokenKind::RAngleBracket, 8, BinaryOperator::GreaterThan);
+  binary(token::TokenKind::GreaterEqual, 8,
+         BinaryOperator::GreaterThanOrEqual);
+  binary(token::TokenKind::LAngleAngle, 9, BinaryOperator::ShiftLeft);
+  binary(token::TokenKind::RAngleAngle, 9, BinaryOperator::ShiftRight);
+  binary(token::TokenKind::Plus, 10, BinaryOperator::Add);
+  binary(token::TokenKind::Minus, 10, BinaryOperator::Sub);
+  binary(token::TokenKind::Asterisk, 11, BinaryOperator::Mult);
+  binary(token::TokenKind::Slash, 11, BinaryOperator::Div);
+  binary(token::TokenKind::Percent, 11, BinaryOperator::Modulo);
+  infix(token::TokenKind::Dot, 13, &Parser::parse_field_access_expr,
+        BinaryOperator::FieldAccess);
+  infix(token::TokenKind::Arrow, 13, &Parser::parse_pointer_access_expr,
+        BinaryOperator::PointerAccess);
+  infix(token::TokenKind::LBracket, 13, &Parser::parse_array_access_expr);
+  return rules;
+}
+
+constinit const std::array<Parser::OperatorRule, token::token_kind_count>
+    Parser::operator_rules = Parser::make_operator_rules();
+
+Expression *Parser::parse_expr_with_precedence(int min_binding_power) {
   Expression *left = parse_exp_head();
 
   while (true) {
-    auto next_token = peek();
-    if (left == nullptr && token::unary_ops.contains(next_token.kind)) {
-      // TODO: fix multiple negs
-      const auto op = unOpFromToken(next_token.kind);
-      const auto precedence = precedenceFromUnOp(op);
-      if (precedence < minPrecedence)
-        break;
-      expect(next_token.kind);
-      Expression *right = parse_expr_with_precedence(precedence + 1);
-      left = arena.create<UnaryOperatorExpression>(
-          right, op,
-          SourceLocation{lexer.get_file_name(), next_token.span.start,
-                         right->get_location().end});
-    } else if (token::binary_ops.contains(next_token.kind)) {
-      const auto op = binOpFromToken(next_token.kind);
-      const auto precedence = precedenceFromBinOp(op);
-      if (precedence < minPrecedence)
-        break;
-      expect(next_token.kind);
-      Expression *right = parse_expr_with_precedence(precedence + 1);
-      left = arena.create<BinaryOperatorExpression>(
-          left, right, op,
-          SourceLocation{lexer.get_file_name(), next_token.span.start,
-                         right->get_location().end});
-    } else if (is_next(token::TokenKind::Dot)) {
-      if (13 < minPrecedence) // oh
-        break;
-      expect(token::TokenKind::Dot);
-      const auto field_ident = expect(token::TokenKind::Identifier);
-      left = arena.create<FieldAccessExpr>(
-          left, field_ident->text,
-          SourceLocation{lexer.get_file_name(), next_token.span.start,
-                         field_ident->span.end});
-    } else if (is_next(token::TokenKind::LBracket)) {
-      if (13 < minPrecedence)
-        break;
-      const auto lb = expect(token::TokenKind::LBracket);
-      const auto index_expr = parse_expr_with_precedence(0);
-      expect(token::TokenKind::RBracket);
-      left = arena.create<ArrayAccessExpr>(
-          left, index_expr,
-          SourceLocation{lexer.get_file_name(), next_token.span.start,
-                         index_expr->get_location().end});
-    } else if (is_next(token::TokenKind::Arrow)) {
-      if (13 < minPrecedence)
-        break;
-      expect(token::TokenKind::Arrow);
-      const auto field_ident = expect(token::TokenKind::Identifier);
-      left = arena.create<PointerAccessExpr>(
-          left, field_ident->text,
-          SourceLocation{lexer.get_file_name(), next_token.span.start,
-                         field_ident->span.end});
-    } else if (is_next(token::TokenKind::Question)) {
-      if (1 < minPrecedence)
-        break;
-      const auto q = expect(token::TokenKind::Question);
-      Expression *then = parse_expr_with_precedence(2);
-      expect(token::TokenKind::Colon);
-      Expression *else_ = parse_expr_with_precedence(2);
-      left = arena.create<TernaryExpression>(
-          left, then, else_,
-          SourceLocation{lexer.get_file_name(), next_token.span.start,
-                         else_->get_location().end});
-    } else {
+    // One table load per operator token
+    const auto &rule = operator_rule(peek_kind());
+    if (rule.infix_power < 0 || rule.infix_power < min_binding_power)
       break;
-    }
+    left = (this->*rule.infix)(left, rule);
   }
   return left;
 }
 
+Expression *Parser::parse_unary_expr(const OperatorRule &rule) {
+  const auto op = next_token();
+  Expression *right = parse_expr_with_precedence(rule.prefix_power + 1);
+  return arena.create<UnaryOperatorExpression>(
+      right, rule.unary,
+      SourceLocation{tokens.get_file_id(), op.span.begin,
+                     right->get_location().end});
+}
+
+Expression *Parser::parse_binary_expr(Expression *left,
+                                      const OperatorRule &rule) {
+  const auto op = next_token();
+  const int right_power = rule.associativity == Associativity::Left
+                              ? rule.infix_power + 1
+                              : rule.infix_power;
+  Expression *right = parse_expr_with_precedence(right_power);
+  return arena.create<BinaryOperatorExpression>(
+      left, right, rule.binary,
+      SourceLocation{tokens.get_file_id(), op.span.begin,
+                     right->get_location().end});
+}
+
+Expression *Parser::parse_field_access_expr(Expression *left,
+                                            const OperatorRule &) {
+  const auto dot = expect(token::TokenKind::Dot);
+  const auto field_ident = expect(token::TokenKind::Identifier);
+  return arena.create<FieldAccessExpr>(
+      left, field_ident.ident,
+      SourceLocation{tokens.get_file_id(), dot.span.begin,
+                     field_ident.span.end});
+}
+
+Expression *Parser::parse_pointer_access_expr(Expression *left,
+                                              const OperatorRule &) {
+  const auto arrow = expect(token::TokenKind::Arrow);
+  const auto field_ident = expect(token::TokenKind::Identifier);
+  return arena.create<PointerAccessExpr>(
+      left, field_ident.ident,
+      SourceLocation{tokens.get_file_id(), arrow.span.begin,
+                     field_ident.span.end});
+}
+
+Expression *Parser::parse_array_access_expr(Expression *left,
+                                            const OperatorRule &) {
+  const auto lb = expect(token::TokenKind::LBracket);
+  const auto index_expr = parse_expr_with_precedence(0);
+  expect(token::TokenKind::RBracket);
+  return arena.create<ArrayAccessExpr>(
+      left, index_expr,
+      SourceLocation{tokens.get_file_id(), lb.span.begin,
+                     index_expr->get_location().end});
+}
+
+// cond ? then : else, right associative so a ? b : c ? d : e nests the
+// second conditional into the else branch
+Expression *Parser::parse_ternary_expr(Expression *left,
+                                       const OperatorRule &rule) {
+  const auto q = expect(token::TokenKind::Question);
+  Expression *then = parse_expr_with_precedence(0);
+  expect(token::TokenKind::Colon);
+  Expression *else_ = parse_expr_with_precedence(rule.infix_power);
+  return arena.create<TernaryExpression>(
+      left, then, else_,
+      SourceLocation{tokens.get_file_id(), q.span.begin,
+                     else_->get_location().end});
+}
+
 AllocExpression *Parser::parse_alloc_expr() {
   const auto alloc = expect(token::TokenKind::Alloc);
   expect(token::TokenKind::LParen);
@@ -244,7 +307,7 @@ AllocExpression *Parser::parse_alloc_expr() {
   const auto rp = expect(token::TokenKind::RParen);
   const auto expr = arena.create<AllocExpression>(
       tp,
-      SourceLocation{lexer.get_file_name(), alloc->span.start, rp->span.end});
+      SourceLocation{tokens.get_file_id(), alloc.span.begin, rp.span.end});
   return expr;
 }
 
@@ -257,7 +320,7 @@ AllocArrayExpression *Parser::parse_alloc_array_expr() {
   const auto rp = expect(token::TokenKind::RParen);
   const auto expr = arena.create<AllocArrayExpression>(
       tp, size,
-      SourceLocation{lexer.get_file_name(), alloc->span.start, rp->span.end});
+      SourceLocation{tokens.get_file_id(), alloc.span.begin, rp.span.end});
   return expr;
 }
 
@@ -267,21 +330,21 @@ ParenthesisExpression *Parser::parse_paren_expr() {
   const auto rp = expect(token::TokenKind::RParen);
   const auto parenExpr = arena.create<ParenthesisExpression>(
       expr,
-      SourceLocation{lexer.get_file_name(), lp->span.start, rp->span.end});
+      SourceLocation{tokens.get_file_id(), lp.span.begin, rp.span.end});
   return parenExpr;
 }
 
 NullExpr *Parser::parse_null_expr() {
   const auto tok = expect(token::TokenKind::Null);
   return arena.create<NullExpr>(
-      SourceLocation{lexer.get_file_name(), tok->span.start, tok->span.end});
+      SourceLocation{tokens.get_file_id(), tok.span.begin, tok.span.end});
 }
 
 VarExpr *Parser::parse_var_expr() {
   const auto var = expect(token::TokenKind::Identifier);
   const auto expr = arena.create<VarExpr>(
-      var->text,
-      SourceLocation{lexer.get_file_name(), var->span.start, var->span.end});
+      var.ident,
+      SourceLocation{tokens.get_file_id(), var.span.begin, var.span.end});
   return expr;
 }
 
@@ -295,14 +358,14 @@ BoolConstExpr *Parser::parse_bool_const() {
     throw std::runtime_error("merkste selber wa");
   }
   const auto boolConstExpr = arena.create<BoolConstExpr>(
-      next_tok.text, SourceLocation{lexer.get_file_name(), next_tok.span.start,
+      next_tok.text, SourceLocation{tokens.get_file_id(), next_tok.span.begin,
                                     next_tok.span.end});
   return boolConstExpr;
 }
 
 CallExpr *Parser::parse_call_expression() {
   const auto fn_name = expect(token::TokenKind::Identifier);
-  const auto call_expr = arena.create<CallExpr>(fn_name->text);
+  const auto call_expr = arena.create<CallExpr>(fn_name.ident);
   const auto lp = expect(token::TokenKind::LParen);
   if (!is_next(token::TokenKind::RParen)) {
     do {
@@ -311,14 +374,14 @@ CallExpr *Parser::parse_call_expression() {
     } while (match(token::TokenKind::Comma));
   }
   const auto rp = expect(token::TokenKind::RParen);
-  call_expr->set_source_location(lexer.get_file_name(), fn_name->span.start,
-                                 rp->span.end);
+  call_expr->set_source_location(tokens.get_file_id(), fn_name.span.begin,
+                                 rp.span.end);
   return call_expr;
 }
 
 NumericExpr *Parser::parse_integer_literal() {
   NumericExpr::Base base;
-  std::optional<token::Token> num;
+  token::Token num;
   if (is_next(token::TokenKind::NumberLiteralDec)) {
     base = NumericExpr::Base::Decimal;
     num = expect(token::TokenKind::NumberLiteralDec);
@@ -329,31 +392,30 @@ NumericExpr *Parser::parse_integer_literal() {
     throw std::runtime_error("du kannst nach hause gehen");
   }
   const auto numExpr = arena.create<NumericExpr>(
-      num->text, base,
-      SourceLocation{lexer.get_file_name(), num->span.start, num->span.end});
+      num.text, base,
+      SourceLocation{tokens.get_file_id(), num.span.begin, num.span.end});
   return numExpr;
 }
 
 CharLiteralExpr *Parser::parse_char_literal() {
   const auto ctok = expect(token::TokenKind::CharLiteral);
   const auto expr = arena.create<CharLiteralExpr>(
-      ctok->text,
-      SourceLocation{lexer.get_file_name(), ctok->span.start, ctok->span.end});
+      ctok.text,
+      SourceLocation{tokens.get_file_id(), ctok.span.begin, ctok.span.end});
   return expr;
 }
 
 StringLiteralExpr *Parser::parse_string_literal() {
   const auto string = expect(token::TokenKind::StringLiteral);
   const auto expr = arena.create<StringLiteralExpr>(
-      string->text, SourceLocation{lexer.get_file_name(), string->span.start,
-                                   string->span.end});
+      string.text, SourceLocation{tokens.get_file_id(), string.span.begin,
+                                   string.span.end});
 
   return expr;
 }
 
 Statement *Parser::parse_statement() {
-  const auto next_token = peek();
-  switch (next_token.kind) {
+  switch (peek_kind()) {
   case token::TokenKind::Return:
     return parse_return_statement();
   case token::TokenKind::Assert:
@@ -376,26 +438,25 @@ Statement *Parser::parse_statement() {
 }
 
 bool Parser::is_var_decl_stmt() {
-  const auto next_token = peek().kind;
+  const auto next_token = peek_kind();
   return next_token == token::TokenKind::Int ||
          next_token == token::TokenKind::Bool ||
          next_token == token::TokenKind::Void ||
          next_token == token::TokenKind::String ||
          next_token == token::TokenKind::Char ||
          next_token == token::TokenKind::Struct ||
-         check_sequence(
-             {token::TokenKind::Identifier, token::TokenKind::Identifier});
+         check_sequence(token::TokenKind::Identifier,
+                        token::TokenKind::Identifier);
 }
 
 bool Parser::is_lv() {
-  auto n_t = peek();
+  auto kind = peek_kind();
   size_t i = 1;
-  while (n_t.kind != token::TokenKind::Eof &&
-         n_t.kind != token::TokenKind::Semi) {
-    n_t = peek(i++);
-    if (n_t.kind == token::TokenKind::PlusPlus ||
-        n_t.kind == token::TokenKind::MinusMinus ||
-        token::assignment_ops.contains(n_t.kind)) {
+  while (kind != token::TokenKind::Eof && kind != token::TokenKind::Semi) {
+    kind = peek_kind(i++);
+    if (kind == token::TokenKind::PlusPlus ||
+        kind == token::TokenKind::MinusMinus ||
+        token::assignment_ops.contains(kind)) {
       return true;
     }
   }
@@ -433,13 +494,12 @@ Statement *Parser::parse_simple_stmt() {
                                                             lv->get_location());
         return stmt;
       } else {
-        throw ParseError(std::format("Expected one of <simple> ::= \n| <lv> "
-                                     "<asnop> <exp>\n| <lv> ++\n| <lv> --\n,"
-                                     " but next token was {}",
-                                     next_token.text),
-                         SourceLocation{lexer.get_file_name(),
-                                        next_token.span.start,
-                                        next_token.span.end});
+        report_error(next_token.span,
+                     "Expected one of <simple> ::= \n| <lv> "
+                     "<asnop> <exp>\n| <lv> ++\n| <lv> --\n,"
+                     " but next token was {}",
+                     next_token.text);
+        return arena.create<InvalidStatement>(lv->get_location());
       }
     }
   }
@@ -461,9 +521,9 @@ VariableDeclarationStatement *Parser::parse_var_decl_stmt() {
     expr = parse_expression();
   }
   const auto stmt = arena.create<VariableDeclarationStatement>(
-      tp, ident->text, expr,
-      SourceLocation{lexer.get_file_name(), tp->get_location().begin,
-                     expr ? expr->get_location().end : ident->span.end});
+      tp, ident.ident, expr,
+      SourceLocation{tokens.get_file_id(), tp->get_location().begin,
+                     expr ? expr->get_location().end : ident.span.end});
   return stmt;
 }
 
@@ -474,7 +534,7 @@ ErrorStatement *Parser::parse_error_stmt() {
   const auto rp = expect(token::TokenKind::RParen);
   const auto stmt = arena.create<ErrorStatement>(
       expr,
-      SourceLocation{lexer.get_file_name(), er->span.start, rp->span.end});
+      SourceLocation{tokens.get_file_id(), er.span.begin, rp.span.end});
   return stmt;
 }
 
@@ -486,7 +546,7 @@ WhileStatement *Parser::parse_while_stmt() {
   const auto body = parse_statement();
   const auto stmt = arena.create<WhileStatement>(
       cond, body,
-      SourceLocation{lexer.get_file_name(), _while->span.start,
+      SourceLocation{tokens.get_file_id(), _while.span.begin,
                      body->get_location().end});
   return stmt;
 }
@@ -509,7 +569,7 @@ ForStatement *Parser::parse_for_stmt() {
   const auto body = parse_statement();
   const auto stmt = arena.create<ForStatement>(
       init, cond, incr, body,
-      SourceLocation{lexer.get_file_name(), _for->span.start,
+      SourceLocation{tokens.get_file_id(), _for.span.begin,
                      body->get_location().end});
   return stmt;
 }
@@ -527,7 +587,7 @@ IfStatement *Parser::parse_if_stmt() {
   }
   const auto stmt = arena.create<IfStatement>(
       cond, then, _else,
-      SourceLocation{lexer.get_file_name(), _if->span.start,
+      SourceLocation{tokens.get_file_id(), _if.span.begin,
                      _else ? _else->get_location().end
                            : then->get_location().end});
   return stmt;
@@ -536,15 +596,18 @@ IfStatement *Parser::parse_if_stmt() {
 CompoundStmt *Parser::parse_compound_statement() {
   const auto l_brace = expect(token::TokenKind::LBrace);
   std::vector<Statement *> statements{};
-  // TODO:
-  do {
+  while (!is_next(token::TokenKind::RBrace) && !is_eof()) {
+    const auto start = position;
     statements.push_back(parse_statement());
-  } while (!check_sequence({token::TokenKind::RBrace}));
+    if (panic_mode) {
+      synchronize_statement(start);
+    }
+  }
 
   const auto r_brace = expect(token::TokenKind::RBrace);
   const auto compStmt = arena.create<CompoundStmt>(
-      statements, SourceLocation{lexer.get_file_name(), l_brace->span.start,
-                                 r_brace->span.end});
+      statements, SourceLocation{tokens.get_file_id(), l_brace.span.begin,
+                                 r_brace.span.end});
   return compStmt;
 }
 ReturnStmt *Parser::parse_return_statement() {
@@ -554,8 +617,8 @@ ReturnStmt *Parser::parse_return_statement() {
     retStmt->set_expression(parse_expression());
   }
   const auto semi = expect(token::TokenKind::Semi);
-  retStmt->set_source_location(lexer.get_file_name(), ret->span.start,
-                               semi->span.end);
+  retStmt->set_source_location(tokens.get_file_id(), ret.span.begin,
+                               semi.span.end);
   return retStmt;
 }
 
@@ -575,9 +638,9 @@ ParameterDeclaration *Parser::parse_parameter_declaration() {
   const auto param_type = parse_type();
   const auto ident{expect(token::TokenKind::Identifier)};
   const auto declaration = arena.create<ParameterDeclaration>(
-      ident->text, param_type,
-      SourceLocation{lexer.get_file_name(), param_type->get_location().begin,
-                     ident->span.end});
+      ident.ident, param_type,
+      SourceLocation{tokens.get_file_id(), param_type->get_location().begin,
+                     ident.span.end});
   return declaration;
 }
 
@@ -586,10 +649,10 @@ FunctionDeclaration *Parser::parse_function_declaration() {
   const auto ident{expect(token::TokenKind::Identifier)};
   expect(token::TokenKind::LParen);
   const auto declaration =
-      arena.create<FunctionDeclaration>(ident->text, ret_type);
+      arena.create<FunctionDeclaration>(ident.ident, ret_type);
   if (!is_next(token::TokenKind::RParen)) {
     declaration->add_parameter_declaration(parse_parameter_declaration());
-    while (check_sequence({token::TokenKind::Comma})) {
+    while (check_sequence(token::TokenKind::Comma)) {
       expect(token::TokenKind::Comma);
       declaration->add_parameter_declaration(parse_parameter_declaration());
     }
@@ -598,13 +661,13 @@ FunctionDeclaration *Parser::parse_function_declaration() {
   if (is_next(token::TokenKind::LBrace)) {
     const auto comp_stmt = parse_compound_statement();
     declaration->set_body(comp_stmt);
-    declaration->set_source_location(lexer.get_file_name(),
+    declaration->set_source_location(tokens.get_file_id(),
                                      ret_type->get_location().begin,
                                      comp_stmt->get_location().end);
   } else {
     const auto semi = expect(token::TokenKind::Semi);
     declaration->set_source_location(
-        lexer.get_file_name(), ret_type->get_location().begin, semi->span.end);
+        tokens.get_file_id(), ret_type->get_location().begin, semi.span.end);
   }
   return declaration;
 }
@@ -615,8 +678,8 @@ Typedef *Parser::parse_typedef() {
   const auto name = expect(token::TokenKind::Identifier);
   const auto semi = expect(token::TokenKind::Semi);
   const auto typedef_ = arena.create<Typedef>(
-      tp, name->text,
-      SourceLocation{lexer.get_file_name(), td->span.start, semi->span.end});
+      tp, name.ident,
+      SourceLocation{tokens.get_file_id(), td.span.begin, semi.span.end});
   return typedef_;
 }
 
@@ -626,25 +689,29 @@ StructDeclaration *Parser::parse_struct_decl() {
   if (is_next(token::TokenKind::Semi)) {
     const auto semi = expect(token::TokenKind::Semi);
     const auto struct_ = arena.create<StructDeclaration>(
-        name->text,
-        SourceLocation{lexer.get_file_name(), str->span.start, semi->span.end});
+        name.ident,
+        SourceLocation{tokens.get_file_id(), str.span.begin, semi.span.end});
     return struct_;
   } else {
     expect(token::TokenKind::LBrace);
     std::vector<VariableDeclarationStatement *> fields = {};
-    while (!is_next(token::TokenKind::RBrace)) {
+    while (!is_next(token::TokenKind::RBrace) && !is_eof()) {
+      const auto start = position;
       const auto tp = parse_type();
       const auto ident = expect(token::TokenKind::Identifier);
       expect(token::TokenKind::Semi);
       const auto decl = arena.create<VariableDeclarationStatement>(
-          tp, ident->text, nullptr, tp->get_location());
+          tp, ident.ident, nullptr, tp->get_location());
       fields.push_back(decl);
+      if (panic_mode) {
+        synchronize_statement(start);
+      }
     }
     expect(token::TokenKind::RBrace);
     const auto semi = expect(token::TokenKind::Semi);
     const auto struct_ = arena.create<StructDeclaration>(
-        name->text, fields,
-        SourceLocation{lexer.get_file_name(), str->span.start, semi->span.end});
+        name.ident, fields,
+        SourceLocation{tokens.get_file_id(), str.span.begin, semi.span.end});
 
     return struct_;
   }
@@ -652,21 +719,63 @@ StructDeclaration *Parser::parse_struct_decl() {
 
 TranslationUnit *Parser::parse_translation_unit() {
   auto *unit = arena.create<TranslationUnit>();
-  while (!is_eof()) {
-    try {
-      if (is_next(token::TokenKind::Struct))
-        unit->add_declaration(parse_struct_decl());
-      else if (is_next(token::TokenKind::Typedef))
-        unit->add_declaration(parse_typedef());
-      else
-        unit->add_declaration(parse_function_declaration());
-    } catch (ParseError &error) {
-      diagnostics->emit_error(error.get_loc(), error.what());
-      diagnostics->add_source_context(
-          source_manager->get_snippet(error.get_loc()));
-      synchronize();
+  while (!is_eof() && diagnostics->should_continue()) {
+    const auto start = position;
+    if (is_next(token::TokenKind::Struct))
+      unit->add_declaration(parse_struct_decl());
+    else if (is_next(token::TokenKind::Typedef))
+      unit->add_declaration(parse_typedef());
+    else
+      unit->add_declaration(parse_function_declaration());
+    if (panic_mode) {
+      synchronize_declaration(start);
     }
   }
-  unit->set_source_location(lexer.get_file_name(), {0, 0}, {0, 0});
+  unit->set_source_location(tokens.get_file_id(), 0, 0);
   return unit;
 }
+
+// Panic mode recovery. Both functions skip ahead to a point where parsing
+// can resume and leave panic mode, they always make progress so the loops
+// calling them terminate.
+
+void Parser::synchronize_statement(std::size_t start) {
+  if (!ended_cleanly(start)) {
+    if (position == start) {
+      next_token();
+    }
+    while (!is_eof()) {
+      const auto kind = peek_kind();
+      if (kind == token::TokenKind::Semi) {
+        next_token();
+        break;
+      }
+      if (kind == token::TokenKind::RBrace ||
+          kind == token::TokenKind::LBrace || kind == token::TokenKind::If ||
+          kind == token::TokenKind::While || kind == token::TokenKind::For ||
+          kind == token::TokenKind::Return ||
+          kind == token::TokenKind::Assert || kind == token::TokenKind::Error)
+        break;
+      next_token();
+    }
+  }
+  panic_mode = false;
+}
+
+void Parser::synchronize_declaration(std::size_t start) {
+  if (!ended_cleanly(start)) {
+    // Skip the rest of the declaration, including a body it may have
+    int depth = 0;
+    while (!is_eof()) {
+      const auto kind = next_token().kind;
+      if (kind == token::TokenKind::LBrace) {
+        depth++;
+      } else if (kind == token::TokenKind::RBrace && --depth <= 0) {
+        break;
+      } else if (kind == token::TokenKind::Semi && depth == 0) {
+        break;
+      }
+    }
+  }
+  panic_mode = false;
+}
@@ -4,99 +4,106 @@
 #include "../defs/ast.hpp"
 #include "../lexer/lexer.hpp"
 #include "../report/report_builder.hpp"
+#include <algorithm>
+#include <array>
+#include <concepts>
 #include <cstddef>
-#include <exception>
-#include <optional>
+#include <cstdint>
 #include <utility>
 #include <vector>
 
-class ParseError : public std::exception {
-  std::string message;
-  SourceLocation loc;
-
-public:
-  explicit ParseError(std::string message, SourceLocation loc = {})
-      : message(std::move(message)), loc(std::move(loc)) {}
-  [[nodiscard]] const char *what() const noexcept override {
-    return message.c_str();
-  }
-  [[nodiscard]] SourceLocation get_loc() const { return loc; }
-};
-
 class Parser {
 private:
-  Lexer lexer;
+  TokenStream tokens;
+  std::size_t position = 0;
   arena::Arena arena;
   std::shared_ptr<SourceManager> source_manager;
   std::shared_ptr<DiagnosticEmitter> diagnostics;
-  std::vector<token::Token> token_buffer;
+  // Set by the first error, cleared once the parser has resynchronized.
+  // Errors reported while it is set are cascades of the first and dropped.
+  bool panic_mode = false;
 
-  [[nodiscard]] token::Token peek(std::size_t n = 0) {
-    while (token_buffer.size() <= n) {
-      const auto next_token{lexer.next_token()};
-      token_buffer.push_back(next_token);
-    }
-    return token_buffer[n];
+  // Index of the n-th token ahead, lookahead past the end sticks to Eof
+  [[nodiscard]] std::size_t ahead(std::size_t n) const {
+    return std::min(position + n, tokens.size() - 1);
   }
 
-  bool check_sequence(const std::vector<token::TokenKind> &sequence) {
-    for (std::size_t i = 0; i < sequence.size(); i++) {
-      if (peek(i).kind != sequence[i]) {
-        return false;
-      }
-    }
+  [[nodiscard]] token::TokenKind peek_kind(std::size_t n = 0) const {
+    return tokens.kind(ahead(n));
+  }
 
-    return true;
+  [[nodiscard]] token::Token peek(std::size_t n = 0) const {
+    return tokens.token(ahead(n));
   }
 
-  bool is_next(const token::TokenKind token) { return peek().kind == token; }
+  template <std::same_as<token::TokenKind>... Kinds>
+  bool check_sequence(Kinds... sequence) const {
+    std::size_t i = 0;
+    return ((peek_kind(i++) == sequence) && ...);
+  }
+
+  bool is_next(const token::TokenKind token) const {
+    return peek_kind() == token;
+  }
 
   token::Token next_token() {
-    if (token_buffer.empty()) {
-      const auto token{lexer.next_token()};
-      return token;
-    } else {
-      const auto result{token_buffer.front()};
-      token_buffer.erase(token_buffer.begin());
-      return result;
+    const auto token = peek();
+    if (position + 1 < tokens.size()) {
+      ++position;
+    }
+    return token;
+  }
+
+  template <typename... Args>
+  void report_error(const SourceLocation &loc,
+                    DiagnosticFormat<Args...> format, Args &&...args) {
+    if (panic_mode) {
+      return;
     }
+    panic_mode = true;
+    diagnostics->emit_error(loc, format, std::forward<Args>(args)...);
+    diagnostics->add_source_context(source_manager->get_snippet(loc));
   }
 
-  std::optional<token::Token> expect(token::TokenKind expected) {
+  // On mismatch the error is recorded and an empty, invalid token of the
+  // expected kind is returned in place of the missing one; nothing is
+  // consumed, so the caller can carry on building its node.
+  token::Token expect(token::TokenKind expected) {
     const auto token{peek()};
     if (token.kind == expected) {
       next_token();
       return token;
     }
-    throw ParseError{std::format("Unexpected {} \'{}\'. expected {}",
-                                 token_kind_to_string(token.kind), token.text,
-                                 token::token_kind_to_string(expected)),
-                     SourceLocation{lexer.get_file_name(), token.span.start,
-                                    token.span.end}};
-    return std::nullopt;
+    report_error(token.span, "Unexpected {} \'{}\'. expected {}",
+                 token_kind_to_string(token.kind), token.text,
+                 token::token_kind_to_string(expected));
+    return token::Token{
+        expected, "",
+        token::Span{tokens.get_file_id(), token.span.begin, token.span.begin},
+        true};
   }
 
   bool match(token::TokenKind expected) noexcept {
-    const auto token{peek()};
-    if (token.kind == expected) {
+    if (peek_kind() == expected) {
       next_token();
       return true;
     }
     return false;
   }
 
-  void synchronize() {
-    next_token();
-
-    while (peek().kind != token::TokenKind::Eof) {
-      if (peek().kind == token::TokenKind::Semi) {
-        next_token();
-        return;
-      }
-      next_token();
+  // True if the construct started at `start` ran up to and including its
+  // terminator, i.e. the error inside it did not derail the parser.
+  [[nodiscard]] bool ended_cleanly(std::size_t start) const {
+    if (position == start) {
+      return false;
     }
+    const auto last = tokens.kind(position - 1);
+    return last == token::TokenKind::Semi || last == token::TokenKind::RBrace;
   }
 
+  void synchronize_statement(std::size_t start);
+  void synchronize_declaration(std::size_t start);
+
   FunctionDeclaration *parse_function_declaration();
   ParameterDeclaration *parse_parameter_declaration();
   Typedef *parse_typedef();
@@ -113,9 +120,48 @@ private:
   Statement *parse_simple_stmt();
   VariableDeclarationStatement *parse_var_decl_stmt();
 
+  // ==== Pratt expression parsing ====
+  enum class Associativity : uint8_t { Left, Right };
+
+  struct OperatorRule;
+  // Builds the node for an infix/postfix operator, the operator token is
+  // still the next token when it is called
+  using InfixParser = Expression *(Parser::*)(Expression *left,
+                                               const OperatorRule &rule);
+
+  // One entry per TokenKind, -1 binding power means "not an operator here"
+  struct OperatorRule {
+    int8_t prefix_power = -1;
+    UnaryOperator unary = UnaryOperator::Unknown;
+    int8_t infix_power = -1;
+    Associativity associativity = Associativity::Left;
+    InfixParser infix = nullptr;
+    BinaryOperator binary = BinaryOperator::Unknown;
+  };
+
+  static constexpr std::array<OperatorRule, token::token_kind_count>
+  make_operator_rules();
+  static const std::array<OperatorRule, token::token_kind_count>
+      operator_rules;
+
+  static const OperatorRule &operator_rule(token::TokenKind kind) {
+    static constexpr OperatorRule none{};
+    const auto index = static_cast<std::size_t>(static_cast<int>(kind));
+    return index < operator_rules.size() ? operator_rules[index] : none;
+  }
+
   Expression *parse_expression();
-  Expression *parse_expr_with_precedence(int minPrecedence);
+  Expression *parse_expr_with_precedence(int min_binding_power);
   Expression *parse_exp_head();
+  Expression *parse_unary_expr(const OperatorRule &rule);
+  Expression *parse_binary_expr(Expression *left, const OperatorRule &rule);
+  Expression *parse_field_access_expr(Expression *left,
+                                      const OperatorRule &rule);
+  Expression *parse_pointer_access_expr(Expression *left,
+                                        const OperatorRule &rule);
+  Expression *parse_array_access_expr(Expression *left,
+                                      const OperatorRule &rule);
+  Expression *parse_ternary_expr(Expression *left, const OperatorRule &rule);
   CallExpr *parse_call_expression();
   NumericExpr *parse_integer_literal();
   CharLiteralExpr *parse_char_literal();
@@ -141,11 +187,12 @@ private:
 
 public:
   TranslationUnit *parse_translation_unit();
-  bool is_eof() { return peek().kind == token::TokenKind::Eof; }
+  bool is_eof() const { return peek_kind() == token::TokenKind::Eof; }
 
-  explicit Parser(Lexer lexer, std::shared_ptr<DiagnosticEmitter> diagnostics,
+  explicit Parser(TokenStream tokens,
+                  std::shared_ptr<DiagnosticEmitter> diagnostics,
                   std::shared_ptr<SourceManager> source_manager)
-      : lexer(lexer), diagnostics(std::move(diagnostics)),
+      : tokens(std::move(tokens)), diagnostics(std::move(diagnostics)),
         source_manager(std::move(source_manager)), arena(arena::Arena{}) {}
 };
 
@@ -0,0 +1,193 @@
+#include "diagnostic_writer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+std::optional<DiagnosticsFormat>
+parse_diagnostics_format(std::string_view name) {
+  if (name == "text") {
+    return DiagnosticsFormat::Text;
+  }
+  if (name == "jsonl") {
+    return DiagnosticsFormat::JsonLines;
+  }
+  if (name == "sarif") {
+    return DiagnosticsFormat::Sarif;
+  }
+  return std::nullopt;
+}
+
+JsonEscapeIterator &JsonEscapeIterator::operator=(char c) {
+  switch (c) {
+  case '"':
+    *buffer += "\\\"";
+    break;
+  case '\\':
+    *buffer += "\\\\";
+    break;
+  case '\n':
+    *buffer += "\\n";
+    break;
+  case '\r':
+    *buffer += "\\r";
+    break;
+  case '\t':
+    *buffer += "\\t";
+    break;
+  default:
+    if (static_cast<unsigned char>(c) < 0x20) {
+      constexpr std::string_view hex = "0123456789abcdef";
+      *buffer += "\\u00";
+      *buffer += hex[static_cast<unsigned char>(c) >> 4];
+      *buffer += hex[c & 0xF];
+    } else {
+      *buffer += c;
+    }
+  }
+  return *this;
+}
+
+void JsonDiagnosticWriter::flush_buffer() {
+  out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  buffer.clear();
+}
+
+void JsonDiagnosticWriter::put(uint64_t number) {
+  std::array<char, 20> digits{};
+  const auto result =
+      std::to_chars(digits.data(), digits.data() + digits.size(), number);
+  buffer.append(digits.data(), result.ptr);
+}
+
+void JsonDiagnosticWriter::put_string(std::string_view text) {
+  buffer += '"';
+  std::copy(text.begin(), text.end(), JsonEscapeIterator{buffer});
+  buffer += '"';
+}
+
+void JsonDiagnosticWriter::put_string(const DiagnosticMessage &message) {
+  buffer += '"';
+  message.render_to(JsonEscapeIterator{buffer});
+  buffer += '"';
+}
+
+JsonDiagnosticWriter::~JsonDiagnosticWriter() {
+  flush_buffer();
+  out.flush();
+}
+
+void JsonDiagnosticWriter::write(const Diagnostic &diagnostic) {
+  std::lock_guard lock{mutex};
+  write_record(diagnostic);
+  if (buffer.size() >= flush_threshold) {
+    flush_buffer();
+  }
+}
+
+void JsonDiagnosticWriter::finish() {
+  std::lock_guard lock{mutex};
+  if (finished) {
+    return;
+  }
+  finished = true;
+  write_end();
+  flush_buffer();
+  out.flush();
+}
+
+void JsonLinesWriter::write_record(const Diagnostic &diagnostic) {
+  put("{\"severity\":");
+  put_string(diagnostic.severity_to_string());
+  if (diagnostic.location.is_valid()) {
+    const auto begin = sources.get_line_column(diagnostic.location.begin);
+    const auto end = sources.get_line_column(diagnostic.location.end);
+    put(",\"file\":");
+    put_string(sources.get_filename());
+    put(",\"line\":");
+    put(static_cast<uint64_t>(begin.line));
+    put(",\"column\":");
+    put(static_cast<uint64_t>(begin.column));
+    put(",\"end_line\":");
+    put(static_cast<uint64_t>(end.line));
+    put(",\"end_column\":");
+    put(static_cast<uint64_t>(end.column));
+  }
+  put(",\"message\":");
+  put_string(diagnostic.message);
+  if (diagnostic.fix_suggestion) {
+    put(",\"fix\":");
+    put_string(*diagnostic.fix_suggestion);
+  }
+  put("}\n");
+}
+
+SarifWriter::SarifWriter(std::ostream &out, const SourceManager &sources)
+    : JsonDiagnosticWriter(out, sources) {
+  put("{\"version\":\"2.1.0\",\"$schema\":"
+      "\"https://json.schemastore.org/sarif-2.1.0.json\","
+      "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"compiler\"}},"
+      "\"results\":[");
+}
+
+void SarifWriter::write_record(const Diagnostic &diagnostic) {
+  if (!first) {
+    put(",");
+  }
+  first = false;
+
+  put("\n{\"level\":");
+  switch (diagnostic.severity) {
+  case DiagnosticSeverity::Error:
+    put("\"error\"");
+    break;
+  case DiagnosticSeverity::Warning:
+    put("\"warning\"");
+    break;
+  case DiagnosticSeverity::Note:
+  case DiagnosticSeverity::Hint:
+    put("\"note\"");
+    break;
+  }
+  put(",\"message\":{\"text\":");
+  put_string(diagnostic.message);
+  put("}");
+  if (diagnostic.location.is_valid()) {
+    const auto begin = sources.get_line_column(diagnostic.location.begin);
+    const auto end = sources.get_line_column(diagnostic.location.end);
+    put(",\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{"
+        "\"uri\":");
+    put_string(sources.get_filename());
+    put("},\"region\":{\"startLine\":");
+    put(static_cast<uint64_t>(begin.line));
+    put(",\"startColumn\":");
+    put(static_cast<uint64_t>(begin.column));
+    put(",\"endLine\":");
+    put(static_cast<uint64_t>(end.line));
+    put(",\"endColumn\":");
+    put(static_cast<uint64_t>(end.column));
+    put("}}}]");
+  }
+  if (diagnostic.fix_suggestion) {
+    put(",\"properties\":{\"fix\":");
+    put_string(*diagnostic.fix_suggestion);
+    put("}");
+  }
+  put("}");
+}
+
+void SarifWriter::write_end() { put("\n]}]}\n"); }
+
+std::shared_ptr<DiagnosticWriter>
+make_diagnostic_writer(DiagnosticsFormat format, std::ostream &out,
+                       const SourceManager &sources) {
+  switch (format) {
+  case DiagnosticsFormat::Text:
+    return nullptr;
+  case DiagnosticsFormat::JsonLines:
+    return std::make_shared<JsonLinesWriter>(out, sources);
+  case DiagnosticsFormat::Sarif:
+    return std::make_shared<SarifWriter>(out, sources);
+  }
+  return nullptr;
+}
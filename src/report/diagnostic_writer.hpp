@@ -0,0 +1,101 @@
+#ifndef REPORT_DIAGNOSTIC_WRITER_H
+#define REPORT_DIAGNOSTIC_WRITER_H
+
+#include "report_builder.hpp"
+#include "source_manager.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Machine readable diagnostics for build farms: no colors, one fixed schema,
+// written while the compiler runs instead of at the end.
+enum class DiagnosticsFormat { Text, JsonLines, Sarif };
+
+std::optional<DiagnosticsFormat> parse_diagnostics_format(std::string_view name);
+
+// Output iterator appending JSON string escaped characters, lets messages
+// render into the output buffer directly
+class JsonEscapeIterator {
+private:
+  std::string *buffer;
+
+public:
+  using difference_type = std::ptrdiff_t;
+
+  explicit JsonEscapeIterator(std::string &buffer) : buffer(&buffer) {}
+
+  JsonEscapeIterator &operator=(char c);
+  JsonEscapeIterator &operator*() { return *this; }
+  JsonEscapeIterator &operator++() { return *this; }
+  JsonEscapeIterator &operator++(int) { return *this; }
+};
+
+// Serializes into one string and hands it to the stream in large blocks.
+// write() takes a lock per diagnostic, so several threads can report through
+// one writer.
+class JsonDiagnosticWriter : public DiagnosticWriter {
+private:
+  static constexpr std::size_t flush_threshold = 64 * 1024;
+
+  std::ostream &out;
+  std::mutex mutex;
+  bool finished = false;
+
+  void flush_buffer();
+
+protected:
+  const SourceManager &sources;
+  std::string buffer;
+
+  void put(std::string_view text) { buffer += text; }
+  void put(uint64_t number);
+  void put_string(std::string_view text);
+  void put_string(const DiagnosticMessage &message);
+
+  virtual void write_record(const Diagnostic &diagnostic) = 0;
+  virtual void write_end() {}
+
+public:
+  JsonDiagnosticWriter(std::ostream &out, const SourceManager &sources)
+      : out(out), sources(sources) {}
+  ~JsonDiagnosticWriter() override;
+
+  void write(const Diagnostic &diagnostic) override;
+  void finish() override;
+};
+
+// One JSON object per line
+class JsonLinesWriter final : public JsonDiagnosticWriter {
+protected:
+  void write_record(const Diagnostic &diagnostic) override;
+
+public:
+  using JsonDiagnosticWriter::JsonDiagnosticWriter;
+};
+
+// SARIF 2.1.0 log with a single run. The results array is streamed, the
+// document is closed by finish().
+class SarifWriter final : public JsonDiagnosticWriter {
+private:
+  bool first = true;
+
+protected:
+  void write_record(const Diagnostic &diagnostic) override;
+  void write_end() override;
+
+public:
+  SarifWriter(std::ostream &out, const SourceManager &sources);
+};
+
+// nullptr for Text, which print_all renders
+std::shared_ptr<DiagnosticWriter>
+make_diagnostic_writer(DiagnosticsFormat format, std::ostream &out,
+                       const SourceManager &sources);
+
+#endif // !REPORT_DIAGNOSTIC_WRITER_H
@@ -1,54 +1,28 @@
 #ifndef REPORT_ERROR_REPORT_H
 #define REPORT_ERROR_REPORT_H
-// SourceManager class for accessing source code
 #include "../defs/ast.hpp"
+#include "source_manager.hpp"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <format>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <variant>
 #include <vector>
 
-class SourceManager {
-private:
-  std::vector<std::string> source_lines;
-  std::string filename;
-
-public:
-  SourceManager(const std::string &source, std::string filename)
-      : filename(std::move(filename)) {
-    // Split source into lines
-    size_t pos = 0;
-    size_t prev = 0;
-    while ((pos = source.find('\n', prev)) != std::string::npos) {
-      source_lines.push_back(source.substr(prev, pos - prev));
-      prev = pos + 1;
-    }
-    source_lines.push_back(source.substr(prev));
-  }
-
-  [[nodiscard]] std::string get_line(int line_num) const {
-    if (line_num > 0 && line_num <= static_cast<int>(source_lines.size())) {
-      return source_lines[line_num - 1];
-    }
-    return "";
-  }
-
-  [[nodiscard]] std::string get_snippet(const SourceLocation &loc) const {
-    if (loc.start_line() == loc.end_line()) {
-      std::string line = get_line(loc.start_line());
-      if (!line.empty()) {
-        return line;
-      }
-    }
-    // For multi-line snippets, return the first line
-    return get_line(loc.start_line());
-  }
-
-  [[nodiscard]] std::string get_filename() const { return filename; }
-};
-
 enum class DiagnosticSeverity { Error, Warning, Note, Hint };
 
 // Color codes for terminal output
@@ -63,12 +37,97 @@ const std::string Cyan = "\033[36m";
 const std::string Bold = "\033[1m";
 } // namespace Color
 
+// Argument of a lazily formatted message. Views are kept as they are and
+// have to outlive the emitter, which identifier names and source text do.
+// Strings are owned.
+struct DiagnosticArgument {
+  std::variant<std::monostate, int64_t, uint64_t, std::string_view,
+               std::string>
+      value;
+
+  template <typename T> static DiagnosticArgument from(T &&argument) {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<U, std::string>) {
+      return {std::string(std::forward<T>(argument))};
+    } else if constexpr (std::is_same_v<U, char>) {
+      return {std::string(1, argument)};
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+      return {static_cast<int64_t>(argument)};
+    } else if constexpr (std::is_integral_v<U>) {
+      return {static_cast<uint64_t>(argument)};
+    } else {
+      static_assert(std::convertible_to<T, std::string_view>,
+                    "Unsupported diagnostic argument");
+      return {std::string_view(argument)};
+    }
+  }
+};
+
+// Only plain {} placeholders, the format string is checked against this at
+// compile time
+template <> struct std::formatter<DiagnosticArgument> {
+  constexpr auto parse(std::format_parse_context &ctx) { return ctx.begin(); }
+
+  auto format(const DiagnosticArgument &argument,
+              std::format_context &ctx) const {
+    return std::visit(
+        [&ctx](const auto &value) {
+          if constexpr (std::is_same_v<std::remove_cvref_t<decltype(value)>,
+                                       std::monostate>) {
+            return ctx.out();
+          } else {
+            return std::format_to(ctx.out(), "{}", value);
+          }
+        },
+        argument.value);
+  }
+};
+
+template <typename T> using diagnostic_argument_t = DiagnosticArgument;
+
+template <typename... Args>
+using DiagnosticFormat = std::format_string<diagnostic_argument_t<Args>...>;
+
+// Message text that is only rendered when it is printed: the format string,
+// a literal, and up to four arguments
+class DiagnosticMessage {
+public:
+  static constexpr std::size_t max_arguments = 4;
+
+private:
+  std::string_view format;
+  std::array<DiagnosticArgument, max_arguments> arguments{};
+
+public:
+  template <typename... Args>
+  DiagnosticMessage(DiagnosticFormat<Args...> format, Args &&...args)
+      : format(format.get()),
+        arguments{DiagnosticArgument::from(std::forward<Args>(args))...} {
+    static_assert(sizeof...(Args) <= max_arguments,
+                  "Too many diagnostic arguments");
+  }
+
+  [[nodiscard]] std::string render() const {
+    return std::vformat(format,
+                        std::make_format_args(arguments[0], arguments[1],
+                                              arguments[2], arguments[3]));
+  }
+
+  // Renders straight into `out`, without an intermediate string
+  template <typename Out> Out render_to(Out out) const {
+    return std::vformat_to(out, format,
+                           std::make_format_args(arguments[0], arguments[1],
+                                                 arguments[2], arguments[3]));
+  }
+};
+
 struct Diagnostic {
   DiagnosticSeverity severity;
   SourceLocation location;
-  std::string message;
-  std::optional<std::string> code_snippet;
-  std::optional<std::string> fix_suggestion;
+  DiagnosticMessage message;
+  // Line of the source buffer, which outlives every diagnostic
+  std::optional<std::string_view> code_snippet;
+  std::optional<DiagnosticMessage> fix_suggestion;
 
   [[nodiscard]] std::string severity_to_string() const {
     switch (severity) {
@@ -98,29 +157,33 @@ struct Diagnostic {
     return "";
   }
 
-  [[nodiscard]] std::string formatted_message() const {
+  [[nodiscard]] std::string
+  formatted_message(const SourceManager &sources) const {
     std::string result;
 
-    // Location
-    result += std::format("{}:{}:{}: ", location.file_name,
-                          location.start_line(), location.start_col());
+    // Location, resolved from the byte offsets only now
+    const auto start = sources.get_line_column(location.begin);
+    const auto end = sources.get_line_column(location.end);
+    result += std::format("{}:{}:{}: ", sources.get_filename(), start.line,
+                          start.column);
 
     // Severity with color
     result += severity_color() + Color::Bold + severity_to_string() +
               Color::Reset + ": ";
 
     // Main message
-    result += message + "\n";
+    result += message.render() + "\n";
 
     // Code snippet if available
     if (code_snippet) {
-      result += "  " + *code_snippet + "\n";
+      result += "  ";
+      result += *code_snippet;
+      result += "\n";
 
       // Generate pointer line to indicate the error position
-      int start_col = location.start_col();
-      std::string pointer_line = std::string(start_col - 1, ' ');
+      std::string pointer_line = std::string(start.column - 1, ' ');
 
-      int length = location.end_col() - location.start_col();
+      int length = end.column - start.column;
       if (length <= 0)
         length = 1;
 
@@ -131,79 +194,334 @@ struct Diagnostic {
 
     // Fix suggestion if available
     if (fix_suggestion) {
-      result +=
-          Color::Green + "  note: " + *fix_suggestion + Color::Reset + "\n";
+      result += Color::Green + "  note: " + fix_suggestion->render() +
+                Color::Reset + "\n";
     }
 
     return result;
   }
 };
 
+// Destination diagnostics are streamed to instead of being kept until
+// print_all, see diagnostic_writer.hpp
+class DiagnosticWriter {
+public:
+  virtual ~DiagnosticWriter() = default;
+
+  // Called once per complete diagnostic, possibly from several threads
+  virtual void write(const Diagnostic &diagnostic) = 0;
+  // Closes the output (e.g. the SARIF document) and flushes it
+  virtual void finish() = 0;
+};
+
+// Collects the diagnostics of all phases. Every thread appends to a buffer of
+// its own, so parallel passes report without taking a lock. The buffers are
+// merged in emission order when the diagnostics are read (get_diagnostics,
+// print_all, sort_by_location), which must not overlap with emitting.
+// Severities are counted on the fly, has_errors() is a single load.
+//
+// With a writer attached nothing is kept: a diagnostic is streamed as soon
+// as its thread emits the next one (until then a snippet or fix may still
+// be added), the rest on finish().
 class DiagnosticEmitter {
 private:
-  std::vector<Diagnostic> diagnostics;
+  struct Entry {
+    uint64_t sequence;
+    Diagnostic diagnostic;
+  };
+
+  struct Buffer {
+    std::thread::id owner;
+    std::vector<Entry> entries;
+    // The last error was over the limit, its notes are dropped as well
+    bool dropping = false;
+  };
+
+  // Buffers a thread used recently, keyed by emitter id. Ids are never
+  // reused, so entries of destroyed emitters just go stale.
+  struct BufferCache {
+    static constexpr std::size_t size = 4;
+    std::array<std::pair<uint64_t, Buffer *>, size> entries{};
+    std::size_t next = 0;
+  };
+
+  static inline std::atomic<uint64_t> next_emitter_id{1};
+
+  uint64_t id = next_emitter_id.fetch_add(1, std::memory_order_relaxed);
+  std::atomic<uint64_t> next_sequence{0};
+  std::array<std::atomic<std::size_t>, 4> counts{};
   bool continue_on_error = true;
+  std::size_t max_errors = 0; // 0 for no limit
+  std::shared_ptr<DiagnosticWriter> writer;
+
+  // Guards `buffers` itself, taken once per thread and on collect()
+  mutable std::mutex buffers_mutex;
+  mutable std::vector<std::unique_ptr<Buffer>> buffers;
+  mutable std::vector<Diagnostic> diagnostics; // collected, in order
+
+  Buffer &local_buffer() {
+    thread_local BufferCache cache{};
+    for (const auto &[emitter, buffer] : cache.entries) {
+      if (emitter == id) {
+        return *buffer;
+      }
+    }
+
+    Buffer *buffer = nullptr;
+    {
+      std::lock_guard lock{buffers_mutex};
+      const auto owner = std::this_thread::get_id();
+      const auto it = std::ranges::find(buffers, owner, &Buffer::owner);
+      if (it != buffers.end()) {
+        buffer = it->get();
+      } else {
+        buffers.push_back(std::make_unique<Buffer>(Buffer{owner, {}}));
+        buffer = buffers.back().get();
+      }
+    }
+    cache.entries[cache.next] = {id, buffer};
+    cache.next = (cache.next + 1) % BufferCache::size;
+    return *buffer;
+  }
+
+  // Counts an error unless that would exceed max_errors
+  bool reserve_error() {
+    auto &errors = counts[static_cast<std::size_t>(DiagnosticSeverity::Error)];
+    auto count = errors.load(std::memory_order_relaxed);
+    do {
+      if (max_errors != 0 && count >= max_errors) {
+        return false;
+      }
+    } while (!errors.compare_exchange_weak(count, count + 1,
+                                           std::memory_order_relaxed));
+    return true;
+  }
+
+  void append(Buffer &buffer, Diagnostic &&diagnostic) {
+    const auto severity = diagnostic.severity;
+    if (severity == DiagnosticSeverity::Error) {
+      buffer.dropping = !reserve_error();
+    } else if (severity == DiagnosticSeverity::Warning) {
+      buffer.dropping = false;
+    }
+    if (buffer.dropping) {
+      return;
+    }
+    if (severity != DiagnosticSeverity::Error) {
+      counts[static_cast<std::size_t>(severity)].fetch_add(
+          1, std::memory_order_relaxed);
+    }
+    if (writer) {
+      stream(buffer);
+    }
+    buffer.entries.push_back(
+        {next_sequence.fetch_add(1, std::memory_order_relaxed),
+         std::move(diagnostic)});
+  }
+
+  void emit(DiagnosticSeverity severity, const SourceLocation &loc,
+            DiagnosticMessage message) {
+    append(local_buffer(),
+           {severity, loc, std::move(message), std::nullopt, std::nullopt});
+  }
+
+  void stream(Buffer &buffer) const {
+    for (const auto &entry : buffer.entries) {
+      writer->write(entry.diagnostic);
+    }
+    buffer.entries.clear();
+  }
+
+  // Last diagnostic this thread emitted
+  Diagnostic *last() {
+    auto &buffer = local_buffer();
+    if (buffer.dropping || buffer.entries.empty()) {
+      return nullptr;
+    }
+    return &buffer.entries.back().diagnostic;
+  }
+
+  // Moves the buffered diagnostics to `diagnostics` in emission order. Notes
+  // and hints stay behind the diagnostic their thread emitted before them.
+  void collect() const {
+    std::lock_guard lock{buffers_mutex};
+    if (writer) {
+      for (const auto &buffer : buffers) {
+        stream(*buffer);
+      }
+      return;
+    }
+    // (sequence, buffer, first, last) of every diagnostic and its notes
+    std::vector<std::tuple<uint64_t, Buffer *, std::size_t, std::size_t>>
+        groups{};
+    std::size_t total = 0;
+    for (const auto &buffer : buffers) {
+      const auto &entries = buffer->entries;
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+        const auto severity = entries[i].diagnostic.severity;
+        if (i == 0 || severity == DiagnosticSeverity::Error ||
+            severity == DiagnosticSeverity::Warning) {
+          groups.emplace_back(entries[i].sequence, buffer.get(), i, i);
+        }
+        std::get<3>(groups.back()) = i + 1;
+      }
+      total += entries.size();
+    }
+    std::ranges::sort(groups, {},
+                      [](const auto &group) { return std::get<0>(group); });
+
+    diagnostics.reserve(diagnostics.size() + total);
+    for (const auto &[sequence, buffer, first, last] : groups) {
+      for (std::size_t i = first; i < last; ++i) {
+        diagnostics.push_back(std::move(buffer->entries[i].diagnostic));
+      }
+    }
+    for (const auto &buffer : buffers) {
+      buffer->entries.clear();
+    }
+  }
 
 public:
-  void emit_error(const SourceLocation &loc, const std::string &message) {
-    diagnostics.push_back(
-        {DiagnosticSeverity::Error, loc, message, std::nullopt, std::nullopt});
+  DiagnosticEmitter() = default;
+  DiagnosticEmitter(const DiagnosticEmitter &) = delete;
+  DiagnosticEmitter &operator=(const DiagnosticEmitter &) = delete;
+  ~DiagnosticEmitter() { finish(); }
+
+  // Streams every diagnostic to `writer` from now on. Set before anything
+  // is emitted.
+  void set_writer(std::shared_ptr<DiagnosticWriter> diagnostic_writer) {
+    writer = std::move(diagnostic_writer);
   }
 
-  void emit_warning(const SourceLocation &loc, const std::string &message) {
-    diagnostics.push_back({DiagnosticSeverity::Warning, loc, message,
-                           std::nullopt, std::nullopt});
+  // Errors past `limit` are dropped together with their notes, and
+  // should_continue() turns false once it is reached. 0 disables the limit.
+  void set_max_errors(std::size_t limit) { max_errors = limit; }
+
+  [[nodiscard]] std::size_t get_max_errors() const { return max_errors; }
+
+  [[nodiscard]] bool error_limit_reached() const {
+    return max_errors != 0 && count(DiagnosticSeverity::Error) >= max_errors;
+  }
+
+  // Streams what is still buffered and closes the writer's output. Without
+  // a writer nothing happens, the diagnostics stay for print_all.
+  void finish() {
+    if (writer) {
+      collect();
+      writer->finish();
+    }
+  }
+
+  // The message is formatted only if the diagnostic is printed. Pass views
+  // only for text that outlives the emitter, see DiagnosticArgument.
+  template <typename... Args>
+  void emit_error(const SourceLocation &loc, DiagnosticFormat<Args...> format,
+                  Args &&...args) {
+    emit(DiagnosticSeverity::Error, loc,
+         DiagnosticMessage{format, std::forward<Args>(args)...});
+  }
+
+  template <typename... Args>
+  void emit_warning(const SourceLocation &loc,
+                    DiagnosticFormat<Args...> format, Args &&...args) {
+    emit(DiagnosticSeverity::Warning, loc,
+         DiagnosticMessage{format, std::forward<Args>(args)...});
   }
 
-  void emit_note(const SourceLocation &loc, const std::string &message) {
-    diagnostics.push_back(
-        {DiagnosticSeverity::Note, loc, message, std::nullopt, std::nullopt});
+  template <typename... Args>
+  void emit_note(const SourceLocation &loc, DiagnosticFormat<Args...> format,
+                 Args &&...args) {
+    emit(DiagnosticSeverity::Note, loc,
+         DiagnosticMessage{format, std::forward<Args>(args)...});
   }
 
-  void emit_hint(const SourceLocation &loc, const std::string &message) {
-    diagnostics.push_back(
-        {DiagnosticSeverity::Hint, loc, message, std::nullopt, std::nullopt});
+  template <typename... Args>
+  void emit_hint(const SourceLocation &loc, DiagnosticFormat<Args...> format,
+                 Args &&...args) {
+    emit(DiagnosticSeverity::Hint, loc,
+         DiagnosticMessage{format, std::forward<Args>(args)...});
   }
 
-  void suggest_fix(const std::string &suggestion) {
-    if (!diagnostics.empty()) {
-      diagnostics.back().fix_suggestion = suggestion;
+  template <typename... Args>
+  void suggest_fix(DiagnosticFormat<Args...> format, Args &&...args) {
+    if (auto *diagnostic = last()) {
+      diagnostic->fix_suggestion.emplace(format, std::forward<Args>(args)...);
     }
   }
 
-  void add_source_context(const std::string &code) {
-    if (!diagnostics.empty()) {
-      diagnostics.back().code_snippet = code;
+  void add_source_context(std::string_view code) {
+    if (auto *diagnostic = last()) {
+      diagnostic->code_snippet = code;
     }
   }
 
   [[nodiscard]] const std::vector<Diagnostic> &get_diagnostics() const {
+    collect();
     return diagnostics;
   }
 
+  // Diagnostics of `severity` reported so far, without the dropped ones
+  [[nodiscard]] std::size_t count(DiagnosticSeverity severity) const {
+    return counts[static_cast<std::size_t>(severity)].load(
+        std::memory_order_relaxed);
+  }
+
   [[nodiscard]] bool has_errors() const {
-    return std::any_of(diagnostics.begin(), diagnostics.end(),
-                       [](const Diagnostic &d) {
-                         return d.severity == DiagnosticSeverity::Error;
-                       });
+    return count(DiagnosticSeverity::Error) > 0;
+  }
+
+  // Appends the diagnostics of a shard another thread reported to
+  void merge(DiagnosticEmitter &&shard) {
+    shard.collect();
+    auto &buffer = local_buffer();
+    for (auto &diagnostic : shard.diagnostics) {
+      append(buffer, std::move(diagnostic));
+    }
+    shard.clear();
+  }
+
+  // Stable sort by file and offset. Notes and hints are moved together with
+  // the error or warning they were emitted after.
+  void sort_by_location() {
+    collect();
+    std::vector<std::pair<std::size_t, std::size_t>> groups{};
+    for (std::size_t i = 0; i < diagnostics.size(); ++i) {
+      const auto severity = diagnostics[i].severity;
+      if (groups.empty() || severity == DiagnosticSeverity::Error ||
+          severity == DiagnosticSeverity::Warning) {
+        groups.emplace_back(i, i);
+      }
+      groups.back().second = i + 1;
+    }
+    std::ranges::stable_sort(groups, {}, [this](const auto &group) {
+      const auto &location = diagnostics[group.first].location;
+      return std::pair{location.file_id, location.begin};
+    });
+
+    std::vector<Diagnostic> sorted{};
+    sorted.reserve(diagnostics.size());
+    for (const auto &[first, last] : groups) {
+      std::move(diagnostics.begin() + first, diagnostics.begin() + last,
+                std::back_inserter(sorted));
+    }
+    diagnostics = std::move(sorted);
   }
 
-  void print_all(std::ostream &out = std::cerr) const {
+  // Streams the pending diagnostics instead if a writer is attached
+  void print_all(const SourceManager &sources,
+                 std::ostream &out = std::cerr) const {
+    collect();
+    if (writer) {
+      return;
+    }
     out << std::endl;
     for (const auto &diag : diagnostics) {
-      out << diag.formatted_message() << std::endl;
+      out << diag.formatted_message(sources) << std::endl;
     }
 
     // Print summary
-    size_t error_count = std::count_if(
-        diagnostics.begin(), diagnostics.end(), [](const Diagnostic &d) {
-          return d.severity == DiagnosticSeverity::Error;
-        });
-
-    size_t warning_count = std::count_if(
-        diagnostics.begin(), diagnostics.end(), [](const Diagnostic &d) {
-          return d.severity == DiagnosticSeverity::Warning;
-        });
+    const size_t error_count = count(DiagnosticSeverity::Error);
+    const size_t warning_count = count(DiagnosticSeverity::Warning);
 
     if (error_count > 0 || warning_count > 0) {
       out << Color::Bold;
@@ -229,11 +547,21 @@ public:
   void set_continue_on_error(bool value) { continue_on_error = value; }
 
   [[nodiscard]] bool should_continue() const {
-    return continue_on_error || !has_errors();
+    return (continue_on_error || !has_errors()) && !error_limit_reached();
   }
 
   // Clear all diagnostics
-  void clear() { diagnostics.clear(); }
+  void clear() {
+    std::lock_guard lock{buffers_mutex};
+    for (const auto &buffer : buffers) {
+      buffer->entries.clear();
+      buffer->dropping = false;
+    }
+    diagnostics.clear();
+    for (auto &count : counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
 };
 
 #endif
@@ -0,0 +1,102 @@
+#ifndef REPORT_SOURCE_MANAGER_H
+#define REPORT_SOURCE_MANAGER_H
+// SourceManager class for accessing source code
+#include "../defs/source_location.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct LineColumn {
+  int line;
+  int column;
+};
+
+class SourceManager {
+private:
+  // Viewed, not owned. The io::SourceFile must outlive the manager.
+  std::string_view source;
+  std::string filename;
+  uint32_t file_id;
+
+  // Byte offset of the first character of every line. Only built when the
+  // first diagnostic asks for a line, clean compiles never pay for it.
+  mutable std::vector<uint32_t> line_starts;
+  mutable std::once_flag line_starts_built;
+
+  void build_line_starts() const {
+    line_starts.push_back(0);
+    const char *const begin = source.data();
+    const char *const end = begin + source.size();
+    const char *cursor = begin;
+    // memchr is vectorized by every libc we build against
+    while (cursor < end) {
+      const auto *newline = static_cast<const char *>(
+          std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+      if (!newline) {
+        break;
+      }
+      cursor = newline + 1;
+      line_starts.push_back(static_cast<uint32_t>(cursor - begin));
+    }
+  }
+
+  const std::vector<uint32_t> &get_line_starts() const {
+    std::call_once(line_starts_built, [this] { build_line_starts(); });
+    return line_starts;
+  }
+
+public:
+  // File ids start at 1, 0 is reserved for "no location"
+  SourceManager(std::string_view source, std::string filename,
+                uint32_t file_id = 1)
+      : source(source), filename(std::move(filename)), file_id(file_id) {}
+
+  [[nodiscard]] uint32_t get_file_id() const { return file_id; }
+
+  // 1-based line and column of a byte offset, found by binary search in the
+  // line table. Columns count bytes, a tab is one column.
+  [[nodiscard]] LineColumn get_line_column(uint32_t offset) const {
+    const auto &starts = get_line_starts();
+    const auto next = std::upper_bound(starts.begin(), starts.end(), offset);
+    const auto line = static_cast<int>(next - starts.begin());
+    return {line, static_cast<int>(offset - *(next - 1)) + 1};
+  }
+
+  [[nodiscard]] std::string_view get_line(int line_num) const {
+    const auto &starts = get_line_starts();
+    if (line_num <= 0 || line_num > static_cast<int>(starts.size())) {
+      return {};
+    }
+    const size_t begin = starts[line_num - 1];
+    size_t end = line_num < static_cast<int>(starts.size())
+                     ? starts[line_num] - 1
+                     : source.size();
+    // Keep CRLF sources from printing a stray carriage return
+    if (end > begin && source[end - 1] == '\r') {
+      --end;
+    }
+    return source.substr(begin, end - begin);
+  }
+
+  [[nodiscard]] std::string_view get_snippet(const SourceLocation &loc) const {
+    if (!loc.is_valid()) {
+      return {};
+    }
+    // For multi-line snippets, return the first line
+    return get_line(get_line_column(loc.begin).line);
+  }
+
+  [[nodiscard]] size_t get_line_count() const {
+    return get_line_starts().size();
+  }
+
+  [[nodiscard]] std::string get_filename() const { return filename; }
+};
+
+#endif // !REPORT_SOURCE_MANAGER_H
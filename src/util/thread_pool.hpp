@@ -0,0 +1,84 @@
+#ifndef UTIL_THREAD_POOL_H
+#define UTIL_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads draining a FIFO of tasks. Results and
+// exceptions of a task are delivered through the future submit() returns.
+class ThreadPool {
+private:
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable available;
+  bool stopping = false;
+
+  void run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock{mutex};
+        available.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+public:
+  explicit ThreadPool(
+      std::size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([this] { run(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Finishes the queued tasks, then joins the workers
+  ~ThreadPool() {
+    {
+      std::lock_guard lock{mutex};
+      stopping = true;
+    }
+    available.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const { return workers.size(); }
+
+  template <typename F>
+  std::future<std::invoke_result_t<F>> submit(F &&function) {
+    // std::function needs a copyable target, packaged_task is move only
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(
+        std::forward<F>(function));
+    auto result = task->get_future();
+    {
+      std::lock_guard lock{mutex};
+      tasks.emplace_back([task] { (*task)(); });
+    }
+    available.notify_one();
+    return result;
+  }
+};
+
+#endif // !UTIL_THREAD_POOL_H